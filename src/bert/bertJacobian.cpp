@@ -21,6 +21,7 @@
 #include <calculateMultiThread.h>
 #include <elementmatrix.h>
 #include <memwatch.h>
+#include <meshView.h>
 #include <meshentities.h>
 #include <shape.h>
 #include <stopwatch.h>
@@ -47,8 +48,9 @@ public:
                          const std::map< long, uint >  & currPatternIdx,
                          const RVector                 & weights,
                          const RVector                 & k,
+                         const MeshView                & view,
                          bool verbose)
-    : BaseCalcMT(verbose), S_(&S), para_(&para), //cellMapIndex_ (&cellMapIndex),
+    : BaseCalcMT(verbose), S_(&S), para_(&para), view_(&view), //cellMapIndex_ (&cellMapIndex),
     data_(&data), pots_(&pots), currPatternIdx_(&currPatternIdx),
     weights_(&weights), k_(&k){
         nData_ = data.size();
@@ -70,54 +72,153 @@ public:
 //        }
     }
 
+    /*! Per cell and wavenumber, gather the cell potentials of all
+     * electrodes into a dense block P (electrodes x cell nodes) and apply
+     * the element matrix once, Q = P S^T. The data then follow from
+     * (P_m - P_n) (Q_a - Q_b)^T, or from the electrode kernel K = P Q^T
+     * if there are more data than electrode pairs. The data of all cells
+     * with the same marker are collected into one column buffer that is
+     * added to the Jacobian once. The element matrices of linear simplices
+     * are taken from the cached gradients of the mesh view. */
     virtual void calc2(Index tNr=0){
         ElementMatrix < double > S_i;
         ElementMatrix < double > S1_i;
+        std::vector < double > Sx, Su, Sk;
+
+        if (start_ >= end_) return;
+
+        std::vector < int > abmn(nData_ * 4);
+        const RVector & da = (*data_)("a");
+        const RVector & db = (*data_)("b");
+        const RVector & dm = (*data_)("m");
+        const RVector & dn = (*data_)("n");
+        for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+            abmn[dataIdx * 4 + 0] = (int)da[dataIdx];
+            abmn[dataIdx * 4 + 1] = (int)db[dataIdx];
+            abmn[dataIdx * 4 + 2] = (int)dm[dataIdx];
+            abmn[dataIdx * 4 + 3] = (int)dn[dataIdx];
+        }
 
-        Cell * cell = NULL;
-        int modelIdx = 0;
+        //** the kernel pays off if its entries are used more than once
+        bool useKernel = (Index(nElecs_) * nElecs_ <= nData_);
 
-        const Vector < ValueType > *va;
-        const Vector < ValueType > *vb;
-        const Vector < ValueType > *vm;
-        const Vector < ValueType > *vn;
-        Vector < ValueType > dummy((*pots_)[0].size(), ValueType(0));
+        std::vector < ValueType > P, Q, K;
+        std::vector < ValueType > col(nData_, ValueType(0));
+        if (useKernel) K.resize(nElecs_ * nElecs_);
 
-        const RVector *da = &(*data_)("a");
-        const RVector *db = &(*data_)("b");
-        const RVector *dm = &(*data_)("m");
-        const RVector *dn = &(*data_)("n");
+        //** cells are sorted by marker, only the first and the last marker
+        //** of this range can be shared with other threads
+        int firstMarker = (*para_)[start_]->marker();
+        int lastMarker  = (*para_)[end_ - 1]->marker();
+        int colMarker = -1;
 
         for (Index cellID = start_; cellID < end_; cellID ++) {
 
-            cell    = (*para_)[cellID];
-            modelIdx = cell->marker();
+            const Cell * cell = (*para_)[cellID];
+            int modelIdx = cell->marker();
 
             if (modelIdx < 0) continue;
 
-            S1_i.ux2uy2uz2(*cell);
+            if (modelIdx != colMarker){
+                addColumn_(col, colMarker,
+                           colMarker == firstMarker || colMarker == lastMarker);
+                colMarker = modelIdx;
+            }
 
-            for (Index kIdx = 0; kIdx < weights_->size(); kIdx ++){
+            Index nN = view_->cellNodeCount(cell->id());
+            const Index * idx = view_->cellNodes(cell->id());
+            Sx.resize(nN * nN);
+            Su.resize(nN * nN);
+            Sk.resize(nN * nN);
+
+            if (view_->stiffness(cell->id(), &Sx[0])){
+                view_->mass(cell->id(), &Su[0]);
+            } else {
+                S1_i.ux2uy2uz2(*cell);
                 S_i.u2(*cell);
-                S_i *= (*k_)[kIdx] * (*k_)[kIdx];
-                S_i += S1_i;
-                int a = 0, b = 0, m = 0, n = 0;
-                for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+                for (Index i = 0; i < nN; i ++){
+                    for (Index j = 0; j < nN; j ++){
+                        Sx[i * nN + j] = S1_i.getVal(i, j);
+                        Su[i * nN + j] = S_i.getVal(i, j);
+                    }
+                }
+            }
 
-                    a = (int)(*da)[dataIdx];
-                    b = (int)(*db)[dataIdx];
-                    m = (int)(*dm)[dataIdx];
-                    n = (int)(*dn)[dataIdx];
+            for (Index kIdx = 0; kIdx < weights_->size(); kIdx ++){
+                double k2 = (*k_)[kIdx] * (*k_)[kIdx];
+                for (Index i = 0; i < nN * nN; i ++) Sk[i] = Su[i] * k2 + Sx[i];
 
-                    if (a > -1) va = &(*pots_)[a + nElecs_ * kIdx]; else va = &dummy;
-                    if (b > -1) vb = &(*pots_)[b + nElecs_ * kIdx]; else vb = &dummy;
-                    if (m > -1) vm = &(*pots_)[m + nElecs_ * kIdx]; else vm = &dummy;
-                    if (n > -1) vn = &(*pots_)[n + nElecs_ * kIdx]; else vn = &dummy;
+                P.resize(nElecs_ * nN);
+                Q.resize(nElecs_ * nN);
 
-                    (*S_)[dataIdx][modelIdx] += S_i.mult((*va), (*vb), (*vm), (*vn)) * (*weights_)[kIdx];
+                for (Index e = 0; e < nElecs_; e ++){
+                    const Vector < ValueType > & pot = (*pots_)[e + nElecs_ * kIdx];
+                    ValueType * pe = &P[e * nN];
+                    for (Index i = 0; i < nN; i ++) pe[i] = pot[idx[i]];
+                }
+                for (Index e = 0; e < nElecs_; e ++){
+                    const ValueType * pe = &P[e * nN];
+                    ValueType * qe = &Q[e * nN];
+                    for (Index i = 0; i < nN; i ++){
+                        const double * si = &Sk[i * nN];
+                        ValueType t = ValueType(0);
+                        for (Index j = 0; j < nN; j ++) t += si[j] * pe[j];
+                        qe[i] = t;
+                    }
+                }
+
+                double w = (*weights_)[kIdx];
+
+                if (useKernel){
+                    //** K[f][e] = P_f * S * P_e
+                    for (Index f = 0; f < nElecs_; f ++){
+                        const ValueType * pf = &P[f * nN];
+                        ValueType * kf = &K[f * nElecs_];
+                        for (Index e = 0; e < nElecs_; e ++){
+                            const ValueType * qe = &Q[e * nN];
+                            ValueType t = ValueType(0);
+                            for (Index i = 0; i < nN; i ++) t += pf[i] * qe[i];
+                            kf[e] = t;
+                        }
+                    }
+                    for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+                        const int * el = &abmn[dataIdx * 4];
+                        ValueType v = ValueType(0);
+                        for (int mi = 2; mi < 4; mi ++){
+                            if (el[mi] < 0) continue;
+                            const ValueType * kf = &K[el[mi] * nElecs_];
+                            ValueType t = ValueType(0);
+                            if (el[0] > -1) t += kf[el[0]];
+                            if (el[1] > -1) t -= kf[el[1]];
+                            if (mi == 2) v += t; else v -= t;
+                        }
+                        col[dataIdx] += v * w;
+                    }
+                } else {
+                    for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+                        const int * el = &abmn[dataIdx * 4];
+                        const ValueType * qa = el[0] > -1 ? &Q[el[0] * nN] : 0;
+                        const ValueType * qb = el[1] > -1 ? &Q[el[1] * nN] : 0;
+                        const ValueType * pm = el[2] > -1 ? &P[el[2] * nN] : 0;
+                        const ValueType * pn = el[3] > -1 ? &P[el[3] * nN] : 0;
+
+                        ValueType v = ValueType(0);
+                        for (Index i = 0; i < nN; i ++){
+                            ValueType q = ValueType(0);
+                            if (qa) q += qa[i];
+                            if (qb) q -= qb[i];
+                            ValueType p = ValueType(0);
+                            if (pm) p += pm[i];
+                            if (pn) p -= pn[i];
+                            v += q * p;
+                        }
+                        col[dataIdx] += v * w;
+                    }
                 }
             }
         }
+        addColumn_(col, colMarker,
+                   colMarker == firstMarker || colMarker == lastMarker);
     }
 
     virtual void calc1(Index tNr=0){
@@ -250,8 +351,32 @@ public:
     }
 
 protected:
+    /*! Add col to the Jacobian column modelIdx and clean col. Columns that
+     * can be shared with other threads are written under lock. */
+    void addColumn_(std::vector < ValueType > & col, int modelIdx, bool shared){
+        if (modelIdx < 0) return;
+        if (shared){
+#if USE_BOOST_THREAD
+            boost::mutex::scoped_lock lock(eraseMutex__);
+#else
+            std::lock_guard< std::mutex > lock(eraseMutex__);
+#endif
+            addColumn_(col, modelIdx);
+        } else {
+            addColumn_(col, modelIdx);
+        }
+    }
+
+    void addColumn_(std::vector < ValueType > & col, int modelIdx){
+        for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+            (*S_)[dataIdx][modelIdx] += col[dataIdx];
+            col[dataIdx] = ValueType(0);
+        }
+    }
+
     Matrix < ValueType >            * S_;
     const std::vector < Cell * >    * para_;
+    const MeshView                  * view_;
     const DataContainerERT          * data_;
     const Matrix < ValueType >      * pots_;
     const std::map< long, uint >    * currPatternIdx_;
@@ -306,10 +431,12 @@ MEMINFO
         std::cout << "Size of S: " << maxSizeNeeded << " MB" << std::endl;
     }
 
+    const MeshView & view = mesh.view();
+
     //** avoid MT problems
     for (std::vector< Cell * >::iterator it = cells.begin();
          it != cells.end(); it ++){
-        (*it)->pShape()->invJacobian();
+        if (!view.hasGradients((*it)->id())) (*it)->pShape()->invJacobian();
     }
 
 //     ShapeFunctionCache::instance().shapeFunctions(cells[0]->shape());
@@ -361,7 +488,8 @@ MEMINFO
             distributeCalc(CreateSensitivityColMT< ValueType >(S, cellsCluster,
                                                                data, pots,
                                                                currPatternIdx,
-                                                               weights, k, verbose),
+                                                               weights, k, view,
+                                                               verbose),
                            cellsCluster.size(), nThreads, verbose);
 
 MEMINFO
@@ -401,7 +529,8 @@ MEMINFO
 
         distributeCalc(CreateSensitivityColMT< ValueType >(S, cells, data,
                                                            pots, currPatternIdx,
-                                                           weights, k, verbose),
+                                                           weights, k, view,
+                                                           verbose),
                         cells.size(), nThreads, verbose);
          if (verbose){
              swatch.stop(verbose);
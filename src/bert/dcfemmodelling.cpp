@@ -40,10 +40,15 @@
 #include <stopwatch.h>
 #include <vectortemplates.h>
 
-#undef HAVE_LIBBOOST_THREAD
+#include <calculateMultiThread.h>
 
-#ifdef HAVE_LIBBOOST_THREAD
-#include <boost/thread.hpp>
+#if USE_BOOST_THREAD
+    #include <boost/thread.hpp>
+    /*! Lock the solver slots of concurrent wavenumbers */
+    static boost::mutex __dcSolverSlots__mutex__;
+#else
+    #include <mutex>
+    static std::mutex __dcSolverSlots__mutex__;
 #endif
 
 namespace GIMLI{
@@ -161,51 +166,38 @@ void assembleStiffnessMatrixHomogenDirichletBC(SparseMatrix < ValueType > & S,
 template < class ValueType >
 void dcfemDomainAssembleStiffnessMatrix(SparseMatrix < ValueType > & S, const Mesh & mesh,
                                         const Vector < ValueType > & atts,
+                                        ElementSlotMap * map,
                                         double k, bool fix){
     S.clean();
     uint countRho0 = 0, countforcedHomDirichlet = 0;
 
     if (!S.valid()) S.buildSparsityPattern(mesh);
 
-    ElementMatrix < double > Se, Stmp;
-
     if (atts.size() != mesh.cellCount()){
        throwLengthError(1, WHERE_AM_I + " attribute size missmatch" + toStr(atts.size())
                        + " != " + toStr(mesh.cellCount()));
     }
-    ValueType rho = 0.0;
-    Stopwatch swatch(true);
-    unsigned long sCount = 0;
 
+    //** cells with scale 0 are skipped by the assembly
+    Vector < ValueType > scale(atts.size(), ValueType(0.0));
+    ValueType rho = 0.0;
     for (uint i = 0; i < mesh.cellCount(); i++){
         rho = atts[mesh.cell(i).id()];
         //** rho == 0.0 may happen while secondary field assemblation
         if (GIMLI::abs(rho) > TOLERANCE){
-            if (k > 0.0){
-//             Stmp = Se.u2(mesh.cell(i));
-//             Stmp *= k * k;
-//             Stmp += Se.ux2uy2uz2(mesh.cell(i));
-
-                Stopwatch s(true);
-                Se.u2(mesh.cell(i));
-                sCount += s.cycleCounter().toc();
-
-                Se *= k * k;
-                Se += Stmp.ux2uy2uz2(mesh.cell(i));
-
-            } else {
-                Se.ux2uy2uz2(mesh.cell(i));
-            }
-            S.add(Se, 1./rho);
-//             Se *= 1.0 / rho;
-//             S += Se;
-        } else {
-            //std::cout << WHERE_AM_I << " " << rho << std::endl;
+            scale[mesh.cell(i).id()] = 1./rho;
         }
         if (rho < ValueType(0.0) && fix) countRho0++;
     }
 
-    //std::cout << "assemble time: " << swatch.cycleCounter().toc() << " " << sCount << "  " << swatch.duration()  << std::endl;
+    //** the slot map only depends on mesh and pattern, callers can keep it
+    ElementSlotMap localMap;
+    if (!map) map = &localMap;
+    if (!map->valid(mesh.cellCount(), S.nVals(), S.stype())){
+        map->init(mesh, S.vecColPtr(), S.vecRowIdx(), S.stype());
+    }
+    S.assemble(mesh, *map, scale, 1.0, (k > 0.0) ? k * k : 0.0);
+
     if (fix){
         IndexArray fixSingNodesID;
         for (uint i = 0; i < S.size(); i ++){
@@ -229,13 +221,25 @@ void dcfemDomainAssembleStiffnessMatrix(SparseMatrix < ValueType > & S, const Me
 
 void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
                                         double k, bool fix){
-    dcfemDomainAssembleStiffnessMatrix(S, mesh, mesh.cellAttributes(), k, fix);
+    dcfemDomainAssembleStiffnessMatrix(S, mesh, mesh.cellAttributes(), 0, k, fix);
 }
 void dcfemDomainAssembleStiffnessMatrix(CSparseMatrix & S, const Mesh & mesh,
                                         double k, bool fix){
     dcfemDomainAssembleStiffnessMatrix(S, mesh, getComplexResistivities(mesh),
+                                       0, k, fix);
+}
+void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
+                                        ElementSlotMap & map,
+                                        double k, bool fix){
+    dcfemDomainAssembleStiffnessMatrix(S, mesh, mesh.cellAttributes(), &map,
                                        k, fix);
 }
+void dcfemDomainAssembleStiffnessMatrix(CSparseMatrix & S, const Mesh & mesh,
+                                        ElementSlotMap & map,
+                                        double k, bool fix){
+    dcfemDomainAssembleStiffnessMatrix(S, mesh, getComplexResistivities(mesh),
+                                       &map, k, fix);
+}
 
 
 template < class ValueType >
@@ -534,6 +538,8 @@ DCMultiElectrodeModelling::~DCMultiElectrodeModelling(){
 
     if (primDataMap_) delete primDataMap_;
 
+    clearFactorisation_();
+
     for_each(electrodes_.begin(), electrodes_.end(), deletePtr());
 }
 
@@ -544,6 +550,8 @@ void DCMultiElectrodeModelling::init_(){
     lastIsReferenz_      = false;
     complex_             = false;
     setSingValue_        = true;
+    rhsBlockSize_        = 64;
+    directSolverMemory_  = 0.0;
 
     subpotOwner_         = false;
     subSolutions_        = NULL;
@@ -572,6 +580,91 @@ DataContainerERT & DCMultiElectrodeModelling::dataContainer() const{
 void DCMultiElectrodeModelling::deleteMeshDependency_(){
     for_each(electrodes_.begin(), electrodes_.end(), deletePtr()); electrodes_.clear();
     electrodeRef_        = NULL;
+    clearFactorisation_();
+}
+
+const RSparseMatrix & DCMultiElectrodeModelling::meshSparsityPattern_(){
+    if (!meshPattern_.valid()) meshPattern_.buildSparsityPattern(*mesh_);
+    return meshPattern_;
+}
+
+void DCMultiElectrodeModelling::prepareAssembly_(){
+    const RSparseMatrix & pattern = meshSparsityPattern_();
+    if (!meshSlotMap_.valid(mesh_->cellCount(), pattern.nVals(), pattern.stype())){
+        meshSlotMap_.init(*mesh_, pattern.vecColPtr(), pattern.vecRowIdx(),
+                          pattern.stype());
+    }
+
+    prepareMeshCaches_(*mesh_);
+}
+
+void DCMultiElectrodeModelling::prepareMeshCaches_(const Mesh & mesh){
+    mesh.view();
+    std::set < uint > rttis;
+    ElementMatrix < double > Se;
+    for (Index i = 0; i < mesh.cellCount(); i ++){
+        const Cell & cell = mesh.cell(i);
+        if (rttis.insert(cell.rtti()).second){
+            Se.u2(cell);
+            Se.ux2uy2uz2(cell);
+        }
+    }
+    for (Index i = 0; i < mesh.boundaryCount(); i ++){
+        const Boundary & bound = mesh.boundary(i);
+        if (rttis.insert(bound.rtti()).second) Se.u2(bound);
+    }
+}
+
+void DCMultiElectrodeModelling::clearFactorisation_(){
+    meshPattern_.clear();
+    meshSlotMap_.clear();
+    for (Index i = 0; i < linSolvers_.size(); i ++) delete linSolvers_[i];
+    linSolvers_.clear();
+    freeSolvers_.clear();
+}
+
+LinSolver * DCMultiElectrodeModelling::acquireSolver_(){
+    __dcSolverSlots__mutex__.lock();
+    LinSolver * solver = NULL;
+    if (freeSolvers_.empty()){
+        solver = new LinSolver(verbose_);
+        linSolvers_.push_back(solver);
+    } else {
+        solver = freeSolvers_.back();
+        freeSolvers_.pop_back();
+    }
+    __dcSolverSlots__mutex__.unlock();
+    return solver;
+}
+
+void DCMultiElectrodeModelling::releaseSolver_(LinSolver * solver){
+    __dcSolverSlots__mutex__.lock();
+    freeSolvers_.push_back(solver);
+    __dcSolverSlots__mutex__.unlock();
+}
+
+/*! Hold a solver of the modelling until the end of the scope. */
+class DCSolverSlot{
+public:
+    DCSolverSlot(DCMultiElectrodeModelling & fop)
+        : fop_(&fop), solver_(fop.acquireSolver_()){
+    }
+
+    ~DCSolverSlot(){
+        fop_->releaseSolver_(solver_);
+    }
+
+    LinSolver & solver() { return *solver_; }
+
+protected:
+    DCMultiElectrodeModelling * fop_;
+    LinSolver * solver_;
+};
+
+double DCMultiElectrodeModelling::directSolverMemoryLimit_() const {
+    if (directSolverMemory_ < 0.0) return 0.0;
+    if (directSolverMemory_ == 0.0) return physicalMemory() / 2.0;
+    return directSolverMemory_;
 }
 
 void DCMultiElectrodeModelling::assembleStiffnessMatrixDCFEMByPass(RSparseMatrix & S){
@@ -681,6 +774,10 @@ void DCMultiElectrodeModelling::assembleStiffnessMatrixDCFEMByPass_(SparseMatrix
         }
     }
 
+    //** the map conversion drops zero entries and would change the sparsity
+    //** pattern, which prevents reusing the symbolic factorisation
+    if (byPassNodesPair.empty()) return;
+
     RSparseMapMatrix S(_S);
     for (Index i = 0; i < byPassNodesPair.size(); i ++){
         Index a1 = byPassNodesPair[i].first;
@@ -700,6 +797,7 @@ void DCMultiElectrodeModelling::assembleStiffnessMatrixDCFEMByPass_(SparseMatrix
 void DCMultiElectrodeModelling::updateMeshDependency_(){
 
     if (subSolutions_) subSolutions_->clear();
+    clearFactorisation_();
 
     for_each(electrodes_.begin(), electrodes_.end(), deletePtr());
     electrodes_.clear();
@@ -1586,23 +1684,31 @@ void DCMultiElectrodeModelling::calculate(DataMap & dMap){
     }
 }
 
-class CalculateMT{
-    public:
-    CalculateMT(DCMultiElectrodeModelling * fop, const std::vector < ElectrodeShape * > & eA,
-                 const std::vector < ElectrodeShape * > & eB,
-                 uint kIdx, RMatrix & mat)
-    : fop_(fop), eA_(&eA), eB_(&eB), kIdx_(kIdx), mat_(& mat) {
+/*! Solve the wavenumber kIdx for all current pattern. */
+class CalculateKTask{
+public:
+    CalculateKTask(DCMultiElectrodeModelling * fop,
+                   const std::vector < ElectrodeShape * > & eA,
+                   const std::vector < ElectrodeShape * > & eB,
+                   MatrixBase * mat, bool complex, Index kIdx)
+    : fop_(fop), eA_(&eA), eB_(&eB), mat_(mat), complex_(complex), kIdx_(kIdx){
     }
+
     void operator()(){
-        fop_->calculateK(*eA_, *eB_, *mat_, kIdx_);
+        if (complex_){
+            fop_->calculateK(*eA_, *eB_, dynamic_cast< CMatrix & >(*mat_), kIdx_);
+        } else {
+            fop_->calculateK(*eA_, *eB_, dynamic_cast< RMatrix & >(*mat_), kIdx_);
+        }
     }
 
+protected:
     DCMultiElectrodeModelling * fop_;
-
     const std::vector < ElectrodeShape * > * eA_;
     const std::vector < ElectrodeShape * > * eB_;
-    uint kIdx_;
-    RMatrix * mat_;
+    MatrixBase * mat_;
+    bool complex_;
+    Index kIdx_;
 };
 
 void DCMultiElectrodeModelling::calculate(const std::vector < ElectrodeShape * > & eA,
@@ -1634,31 +1740,34 @@ void DCMultiElectrodeModelling::calculate(const std::vector < ElectrodeShape * >
 
     preCalculate(eA, eB);
 
-#ifdef HAVE_LIBBOOST_THREAD
-    uint kIdx = 0;
-    while (kIdx < kValues_.size()){
-        boost::thread_group threads;
-        for (uint thread = 0; thread < nThreads_; thread ++){
-            if (kIdx <  kValues_.size()){
-                threads.create_thread(CalculateMT(this,
-                                                  eA, eB,
-                                                  kIdx, *subSolutions_));
-                kIdx ++;
-            }
-        }
-        threads.join_all();
-    }
-#else
-    for (Index kIdx = 0; kIdx < kValues_.size(); kIdx ++){
-        //if (verbose_ && kValues_.size() > 1) std::cout << "\r" << kIdx + 1 << "/" << kValues_.size();
-
-        if (complex_){
-            calculateK(eA, eB, dynamic_cast< CMatrix & > (*subSolutions_), kIdx);
-        } else {
-            calculateK(eA, eB, dynamic_cast< RMatrix & > (*subSolutions_), kIdx);
+    //** the wavenumbers are independent, each one is assembled, factorised
+    //** and solved by a task with its own solver. Every concurrent task
+    //** holds a factor, so the memory limits their number.
+    Index nK = kValues_.size();
+    Index maxConcurrent = min(threadCount(), nK);
+    if (buildCompleteElectrodeModel_) maxConcurrent = 1;
+    //** a dynamic mesh rebuilds its view on every access
+    if (!mesh_->staticGeometry()) maxConcurrent = 1;
+
+    double maxFactorMemory = directSolverMemoryLimit_();
+    double factorMemory = predictFactorMemory(mesh_->nodeCount(), mesh_->dim(), complex_);
+    if (!analytical_ && maxFactorMemory > 0.0 && factorMemory <= maxFactorMemory){
+        maxConcurrent = min(maxConcurrent, max(Index(1), Index(maxFactorMemory / factorMemory)));
+    }
+
+    if (maxConcurrent > 1){
+        if (!analytical_) prepareAssembly_();
+        TaskGroup tasks(maxConcurrent);
+        for (Index kIdx = 0; kIdx < nK; kIdx ++){
+            threadPool().submit(tasks, CalculateKTask(this, eA, eB, subSolutions_,
+                                                      complex_, kIdx));
+        }
+        threadPool().wait(tasks);
+    } else {
+        for (Index kIdx = 0; kIdx < nK; kIdx ++){
+            CalculateKTask(this, eA, eB, subSolutions_, complex_, kIdx)();
         }
     }
-#endif
     for (Index kIdx = 0; kIdx < kValues_.size(); kIdx ++){
         for (Index i = 0; i < nCurrentPattern; i ++) {
             if (kIdx == 0) {
@@ -1707,6 +1816,9 @@ void DCMultiElectrodeModelling::calculateKAnalyt(const std::vector < ElectrodeSh
     }
 }
 
+inline bool isComplexValue__(double){ return false; }
+inline bool isComplexValue__(const Complex &){ return true; }
+
 template < class ValueType >
 void DCMultiElectrodeModelling::calculateK_(const std::vector < ElectrodeShape * > & eA,
                                             const std::vector < ElectrodeShape * > & eB,
@@ -1731,13 +1843,13 @@ void DCMultiElectrodeModelling::calculateK_(const std::vector < ElectrodeShape *
     if (debug) std::cout << "build sparsity pattern ... " ;
 
     SparseMatrix < ValueType > S_;
-    S_.buildSparsityPattern(*mesh_);
+    S_.buildSparsityPattern(meshSparsityPattern_());
 
 MEMINFO
 
 //** START  assemble matrix
     if (verbose_) std::cout << "assemble matrix ... " ;
-    dcfemDomainAssembleStiffnessMatrix(S_, *mesh_, k);
+    dcfemDomainAssembleStiffnessMatrix(S_, *mesh_, meshSlotMap_, k);
     dcfemBoundaryAssembleStiffnessMatrix(S_, *mesh_, sourceCenterPos_, k);
 
     uint oldMatSize = mesh_->nodeCount();
@@ -1780,74 +1892,73 @@ MEMINFO
 
     //** START solving
 
-    LinSolver solver(verbose_);
-    //solver.setSolverType(LDL);
-    //    std::cout << "solver: " << solver.solverName() << std::endl;
+    DCSolverSlot slot(*this);
+    LinSolver & solver = slot.solver();
+
+    //** use PCG if the direct factor would not fit into memory
+    double maxFactorMemory = directSolverMemoryLimit_();
+    if (maxFactorMemory > 0.0 &&
+        predictFactorMemory(S_.rows(), mesh_->dim(), isComplexValue__(ValueType(0))) > maxFactorMemory){
+        solver.setSolverType(PCG);
+    } else {
+        solver.setSolverType(AUTOMATIC);
+    }
 
     if (verbose_) std::cout << "Factorize (" << solver.solverName() << ") matrix ... ";
-    solver.setMatrix(S_, 1);
+    solver.refactorise(S_, 1);
 
 MEMINFO
 
-    Vector < ValueType > sol(S_.cols());
+    //** solve blocks of current pattern at once, the block size limits
+    //** the memory for the rhs and solution workspace
+    Index blockSize = max(Index(1), rhsBlockSize_);
+
+    for (Index start = 0; start < nCurrentPattern; start += blockSize){
+        Index end = min(start + blockSize, Index(nCurrentPattern));
 
-    for (uint i = 0; i < nCurrentPattern; i ++){
         if (verbose_ && k == 0){
-            std::cout << "\r " << i << " (" << swatch.duration(true) << "s)";
+            std::cout << "\r " << start << " (" << swatch.duration(true) << "s)";
         }
 
-        RVector rTmp(S_.rows(), 0.0);
-        if (eA[i]) eA[i]->assembleRHS(rTmp,  1.0, oldMatSize);
-        if (eB[i]) eB[i]->assembleRHS(rTmp, -1.0, oldMatSize);
-        Vector < ValueType >rhs(rTmp);
+        Matrix < ValueType > rhs(end - start, S_.rows());
+        for (Index i = start; i < end; i ++){
+            RVector rTmp(S_.rows(), 0.0);
+            if (eA[i]) eA[i]->assembleRHS(rTmp,  1.0, oldMatSize);
+            if (eB[i]) eB[i]->assembleRHS(rTmp, -1.0, oldMatSize);
+            rhs[i - start] = Vector < ValueType >(rTmp);
+        }
 
+        Matrix < ValueType > sol;
+        if (solver.solverType() == PCG){
+            //** start with the potentials of the last call
+            sol.resize(end - start, S_.rows());
+            Index nOld = min(Index(oldMatSize), solutionK.cols());
+            for (Index i = start; i < end; i ++){
+                const Vector < ValueType > & last = solutionK[i + kIdx * nCurrentPattern];
+                for (Index j = 0; j < nOld; j ++) sol[i - start][j] = last[j];
+            }
+        }
         solver.solve(rhs, sol);
 
-//         if (i==4){
-//             S_.save("S-gimli.matrix");
-//             rhs.save("rhs.vec");
-//             save(sol, "sol.vec");
-//             mesh_->addData("sol" + str((kIdx) * nCurrentPattern + i), sol);
-// //             mesh_->addData("rhs", rhs);
-// //             mesh_->addData("soll",abs(log(sol)));
-//             mesh_->exportVTK("sol");
-// //             exit(0);
-//         }
-//         mesh_->addData("sol" + str((kIdx) * nCurrentPattern + i), sol);
-//         S_.save("S-gimli.matrix");
-//         rhs.save("rhs.vec");
-
-//          save(rhs[i],  "rhs.vec");
-//          save(sol, "sol.vec");
-
-//         __MS(complex_)
-//         __MS(min(sol)<< " " << max(sol))
-//         __MS(i<< " " << k)
-        if (norml2(S_ * sol - rhs) / norml2(rhs) > 1e-6){
-//                 S_.save("S.matrix");
-//                 save(rhs[i], "rhs.vec");
-//                 save(sol, "sol.vec");
-            std::cout   << " Ooops: Warning!!!! Solver: " << solver.solverName()
-                            << " fails with rms(A *x -b)/rms(b) > tol: "
-                            << norml2(S_ * sol - rhs)<< std::endl;
-
-//             S_.save("S-gimli.matrix");
-//             rhs.save("rhs.vec");
-//             exit(0);
-        }
-        solutionK[i + kIdx * nCurrentPattern].setVal(sol, 0, oldMatSize);
-
-        if (buildCompleteElectrodeModel_){
-            //__MS(sol(oldMatSize, sol.size()- passiveCEM_.size()));
-            potentialsCEM_[i] = TmpToRealHACK(sol(oldMatSize, sol.size() - passiveCEM_.size()));
-        }
-
-        // no need for setSingValue here .. numerical primpotentials have
-        // some "proper" non singular value
-//         if (setSingValue_){
-//             if (eA[i]) eA[i]->setSingValue(solutionK[i], mesh_->cellAttributes(),  1.0, k);
-//             if (eB[i]) eB[i]->setSingValue(solutionK[i], mesh_->cellAttributes(), -1.0, k);
-//         }
+        //** residual check for the whole block with one sweep over S
+        Matrix < ValueType > res(S_.mult(sol));
+
+        for (Index i = start; i < end; i ++){
+            const Vector < ValueType > & b = rhs[i - start];
+            const Vector < ValueType > & x = sol[i - start];
+
+            double resNorm = norml2(res[i - start] - b);
+            if (resNorm / norml2(b) > 1e-6){
+                std::cout   << " Ooops: Warning!!!! Solver: " << solver.solverName()
+                                << " fails with rms(A *x -b)/rms(b) > tol: "
+                                << resNorm << std::endl;
+            }
+            solutionK[i + kIdx * nCurrentPattern].setVal(x, 0, oldMatSize);
+
+            if (buildCompleteElectrodeModel_){
+                potentialsCEM_[i] = TmpToRealHACK(x(oldMatSize, x.size() - passiveCEM_.size()));
+            }
+        }
     }
 MEMINFO
     // we dont need reserve the memory
@@ -2065,6 +2176,12 @@ void DCSRMultiElectrodeModelling::preCalculate(const std::vector < ElectrodeShap
 MEMINFO
 }
 
+void DCSRMultiElectrodeModelling::prepareAssembly_(){
+    DCMultiElectrodeModelling::prepareAssembly_();
+    //** the copy in preCalculate starts without a mesh view
+    prepareMeshCaches_(mesh1_);
+}
+
 void DCSRMultiElectrodeModelling::calculateK(const std::vector < ElectrodeShape * > & eA,
                                              const std::vector < ElectrodeShape * > & eB,
                                              RMatrix & solutionK, int kIdx) {
@@ -2087,12 +2204,12 @@ void DCSRMultiElectrodeModelling::calculateK(const std::vector < ElectrodeShape
 MEMINFO
 
     RSparseMatrix S_;
-    S_.buildSparsityPattern(*mesh_);
+    S_.buildSparsityPattern(meshSparsityPattern_());
     bool singleVerbose = verbose_;
 
 MEMINFO
 
-    dcfemDomainAssembleStiffnessMatrix(       S_, *mesh_, k);
+    dcfemDomainAssembleStiffnessMatrix(       S_, *mesh_, meshSlotMap_, k);
     dcfemBoundaryAssembleStiffnessMatrix(     S_, *mesh_, sourceCenterPos_, k);
     assembleStiffnessMatrixHomogenDirichletBC(S_, calibrationSourceIdx_);
 //     S_.save("S.mat");
@@ -2102,7 +2219,7 @@ MEMINFO
 
 //     RVector tmpRho(mesh_->cellAttributes());
 //     mesh_->setCellAttributes(1.0);
-    dcfemDomainAssembleStiffnessMatrix(  S1, mesh1_, k);
+    dcfemDomainAssembleStiffnessMatrix(  S1, mesh1_, meshSlotMap_, k);
     dcfemBoundaryAssembleStiffnessMatrix(S1, mesh1_, sourceCenterPos_, k);
     assembleStiffnessMatrixHomogenDirichletBC(S1, calibrationSourceIdx_);
 
@@ -2110,8 +2227,9 @@ MEMINFO
     //mesh_->setCellAttributes(tmpRho);
 
 MEMINFO
-    LinSolver solver(false);
-    solver.setMatrix(S_, 1);
+    DCSolverSlot slot(*this);
+    LinSolver & solver = slot.solver();
+    solver.refactorise(S_, 1);
 //     if (verbose_) std::cout << "Factorize (" << solver.solverName() << ") matrix ... " << swatch.duration() << std::endl;
 
 MEMINFO
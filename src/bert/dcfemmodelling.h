@@ -31,6 +31,8 @@
 
 namespace GIMLI{
 
+class LinSolver;
+
 /*! if fix is set. Matrix will check and fix singularities. Do not fix the matrix if you need it for the rhs while singulariety removal calculation. */
 DLLEXPORT void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
                                                   double k=0.0, bool fix=true);
@@ -38,6 +40,16 @@ DLLEXPORT void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh
 DLLEXPORT void dcfemDomainAssembleStiffnessMatrix(CSparseMatrix & S, const Mesh & mesh,
                                                   double k=0.0, bool fix=true);
 
+/*! Same as above but reuses the element to pattern slot map. The map is
+ * (re)build if it does not fit to mesh and the sparsity pattern of S. */
+DLLEXPORT void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
+                                                  ElementSlotMap & map,
+                                                  double k=0.0, bool fix=true);
+
+DLLEXPORT void dcfemDomainAssembleStiffnessMatrix(CSparseMatrix & S, const Mesh & mesh,
+                                                  ElementSlotMap & map,
+                                                  double k=0.0, bool fix=true);
+
 // DLLEXPORT void assembleStiffnessMatrixHomogenDirichletBC(RSparseMatrix & S,
 //                                                          const IndexArray & nodeID);
 
@@ -259,6 +271,24 @@ public:
     /*! Return true if singular value estimation is switched on.*/
     bool isSetSingValue() const { return setSingValue_;}
 
+    /*! Set the number of current pattern that are solved together in one
+     * blocked solve. Larger blocks are faster but need a rhs and solution
+     * workspace of blockSize * nodeCount values. Default is 64. */
+    void setRHSBlockSize(Index blockSize) { rhsBlockSize_ = blockSize; }
+
+    /*! Return the number of current pattern solved together. */
+    Index rhsBlockSize() const { return rhsBlockSize_; }
+
+    /*! Set the memory in MByte a direct factorisation may use. Systems
+     * whose predicted factor is larger are solved iteratively with
+     * preconditioned conjugate gradients, starting from the potentials of
+     * the last call. 0 (default) is half of the physical memory, a
+     * negative value always uses the direct solver. */
+    void setDirectSolverMemory(double mb) { directSolverMemory_ = mb; }
+
+    /*! Return the memory limit for direct factorisations in MByte. */
+    double directSolverMemory() const { return directSolverMemory_; }
+
 private:
     void init_();
 
@@ -291,8 +321,46 @@ protected:
 
     virtual void searchElectrodes_();
 
+    /*! Return the sparsity pattern of the current mesh. Built on first
+     * request. */
+    const RSparseMatrix & meshSparsityPattern_();
+
+    /*! Build the sparsity pattern, the slot map and the mesh caches of
+     * every mesh a wavenumber is assembled on, so several wavenumbers can
+     * be assembled concurrently. */
+    virtual void prepareAssembly_();
+
+    /*! Fill the mesh view and the shape function and integration caches
+     * of mesh, the concurrent wavenumbers only read them. */
+    void prepareMeshCaches_(const Mesh & mesh);
+
+    /*! Release the cached sparsity pattern and the solvers. */
+    void clearFactorisation_();
+
+    friend class DCSolverSlot;
+
+    /*! Return a solver that is not used by another wavenumber. Hand it
+     * back with \ref releaseSolver_. */
+    LinSolver * acquireSolver_();
+
+    void releaseSolver_(LinSolver * solver);
+
+    /*! Return the memory in MByte for direct factorisations, 0 for no
+     * limit, see \ref setDirectSolverMemory. */
+    double directSolverMemoryLimit_() const;
+
     MatrixBase * subSolutions_;
 
+    /*! Sparsity pattern and solvers (with their symbolic factorisation)
+     * depend on the mesh only. They are reused for all wavenumbers and
+     * forward calls until the mesh changes, so each wavenumber only needs a
+     * numerical refactorisation. There is one solver for every wavenumber
+     * that is solved at the same time. */
+    RSparseMatrix meshPattern_;
+    ElementSlotMap meshSlotMap_;
+    std::vector < LinSolver * > linSolvers_;
+    std::vector < LinSolver * > freeSolvers_;
+
     bool complex_;
 
     bool JIsRMatrix_;
@@ -303,6 +371,8 @@ protected:
     bool subpotOwner_;
     bool lastIsReferenz_;
     bool setSingValue_;
+    Index rhsBlockSize_;
+    double directSolverMemory_;
 
     std::string byPassFile_;
 
@@ -391,6 +461,9 @@ protected:
     virtual void updateMeshDependency_();
     virtual void updateDataDependency_();
 
+    /*! The secondary field is assembled on the homogeneous mesh1_ too. */
+    virtual void prepareAssembly_();
+
     void checkPrimpotentials_(const std::vector < ElectrodeShape * > & eA,
                                const std::vector < ElectrodeShape * > & eB);
 
@@ -0,0 +1,172 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "calculateMultiThread.h"
+
+namespace GIMLI{
+
+ThreadPool::ThreadPool() : stop_(false){
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        Lock lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    for (Index i = 0; i < workers_.size(); i ++){
+        workers_[i]->join();
+        delete workers_[i];
+    }
+}
+
+Index ThreadPool::workerCount() const {
+    Lock lock(mutex_);
+    return std::min(Index(workers_.size()), activeWorkers_());
+}
+
+Index ThreadPool::activeWorkers_() const {
+    return threadCount() > 1 ? threadCount() - 1 : 0;
+}
+
+void ThreadPool::startWorkers_(){
+    Index nWorkers = activeWorkers_();
+    while (workers_.size() < nWorkers){
+        workers_.push_back(new Thread(&ThreadPool::work_, this, Index(workers_.size())));
+    }
+}
+
+void ThreadPool::submit(TaskGroup & group, const std::function< void() > & task){
+    Lock lock(mutex_);
+    startWorkers_();
+    if (group.maxConcurrent_ == 0 || group.running_ < group.maxConcurrent_){
+        group.running_ ++;
+        Task t = { &group, task };
+        queue_.push_back(t);
+        lock.unlock();
+        condition_.notify_all();
+    } else {
+        group.pending_.push_back(task);
+    }
+}
+
+bool ThreadPool::runNext_(Lock & lock, TaskGroup * group){
+    std::deque < Task >::iterator it = queue_.begin();
+    if (group){
+        while (it != queue_.end() && it->group != group) it ++;
+    }
+    if (it == queue_.end()) return false;
+
+    Task task(*it);
+    queue_.erase(it);
+
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+        task.func();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    lock.lock();
+
+    TaskGroup & g = *task.group;
+    if (error && !g.error_) g.error_ = error;
+    if (!g.pending_.empty()){
+        //** the slot of the finished task goes to the next one
+        Task next = { &g, g.pending_.front() };
+        g.pending_.pop_front();
+        queue_.push_back(next);
+    } else {
+        g.running_ --;
+    }
+    //** wakes the waiting thread of the group and idle workers
+    condition_.notify_all();
+    return true;
+}
+
+void ThreadPool::work_(Index id){
+    Lock lock(mutex_);
+    while (!stop_){
+        //** surplus workers sleep until the thread count grows again
+        if (id >= activeWorkers_() || !runNext_(lock, NULL)) condition_.wait(lock);
+    }
+}
+
+void ThreadPool::wait(TaskGroup & group){
+    Lock lock(mutex_);
+    while (group.running_ > 0){
+        if (!runNext_(lock, &group)) condition_.wait(lock);
+    }
+    if (group.error_){
+        std::exception_ptr error(group.error_);
+        group.error_ = std::exception_ptr();
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+WorkRanges::WorkRanges(Index nCalcs, Index nParts, Index chunkSize)
+    : chunk_(chunkSize){
+    nParts = std::max(Index(1), nParts);
+    if (chunk_ == 0) chunk_ = std::max(Index(1), nCalcs / (nParts * 8));
+
+    begin_.resize(nParts);
+    end_.resize(nParts);
+    for (Index i = 0; i < nParts; i ++){
+        begin_[i] = nCalcs * i / nParts;
+        end_[i]   = nCalcs * (i + 1) / nParts;
+    }
+}
+
+bool WorkRanges::next(Index part, Index & start, Index & end){
+    ThreadPool::Lock lock(mutex_);
+    if (begin_[part] == end_[part]){
+        Index victim = part;
+        Index most = 0;
+        for (Index i = 0; i < begin_.size(); i ++){
+            if (end_[i] - begin_[i] > most){
+                most = end_[i] - begin_[i];
+                victim = i;
+            }
+        }
+        if (most == 0) return false;
+
+        //** the owner goes on at the front of its range
+        Index mid = end_[victim] - (most + 1) / 2;
+        begin_[part] = mid;
+        end_[part] = end_[victim];
+        end_[victim] = mid;
+    }
+    start = begin_[part];
+    end = std::min(end_[part], start + chunk_);
+    begin_[part] = end;
+    return true;
+}
+
+void WorkRanges::cancel(){
+    ThreadPool::Lock lock(mutex_);
+    for (Index i = 0; i < begin_.size(); i ++) begin_[i] = end_[i];
+}
+
+ThreadPool & threadPool(){
+    //** never destroyed, the workers live until the process ends
+    static ThreadPool * pool = new ThreadPool();
+    return *pool;
+}
+
+} // namespace GIMLI
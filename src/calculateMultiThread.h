@@ -21,14 +21,112 @@
 
 #include "gimli.h"
 
+#include <deque>
+#include <exception>
+#include <functional>
+#include <vector>
+
 #ifdef USE_BOOST_THREAD
     #include <boost/thread.hpp>
 #else
+    #include <condition_variable>
+    #include <mutex>
     #include <thread>
 #endif
 
 namespace GIMLI{
 
+//! Tasks submitted to the \ref ThreadPool that are waited for together.
+/*! At most maxConcurrent tasks of the group run at the same time, 0 is
+ * unlimited. Use this if every task needs a lot of memory, e.g., a
+ * matrix factorisation of its own. The remaining tasks wait in the group
+ * until a running one has finished. */
+class DLLEXPORT TaskGroup{
+public:
+    TaskGroup(Index maxConcurrent=0)
+        : maxConcurrent_(maxConcurrent), running_(0){
+    }
+
+    /*! Return the maximum number of tasks that run at the same time. */
+    Index maxConcurrent() const { return maxConcurrent_; }
+
+protected:
+    friend class ThreadPool;
+
+    Index maxConcurrent_;
+    //** tasks in the pool queue or running
+    Index running_;
+    //** tasks that wait for a free slot of the group
+    std::deque < std::function< void() > > pending_;
+    std::exception_ptr error_;
+};
+
+//! Persistent worker threads for the tasks of several \ref TaskGroup.
+/*! The workers are started on first use and kept alive, so submitting a
+ * task costs no thread creation. \ref threadCount() - 1 workers run
+ * tasks, surplus workers of a former larger thread count idle. The
+ * thread that waits for a group runs its tasks too. That way
+ * tasks can submit and wait for tasks of their own without blocking a
+ * worker. The first exception of a task is passed on to \ref wait. */
+class DLLEXPORT ThreadPool{
+public:
+#ifdef USE_BOOST_THREAD
+    typedef boost::mutex Mutex;
+    typedef boost::unique_lock < boost::mutex > Lock;
+    typedef boost::condition_variable Condition;
+    typedef boost::thread Thread;
+#else
+    typedef std::mutex Mutex;
+    typedef std::unique_lock < std::mutex > Lock;
+    typedef std::condition_variable Condition;
+    typedef std::thread Thread;
+#endif
+
+    ThreadPool();
+
+    ~ThreadPool();
+
+    /*! Add task to the group and run it as soon as a worker (and a slot
+     * of the group) is free. */
+    void submit(TaskGroup & group, const std::function< void() > & task);
+
+    /*! Return when all tasks of the group have finished. The calling
+     * thread runs tasks of the group meanwhile. Rethrows the first
+     * exception of a task. */
+    void wait(TaskGroup & group);
+
+    /*! Return the number of worker threads that run tasks. */
+    Index workerCount() const;
+
+protected:
+    struct Task{
+        TaskGroup * group;
+        std::function< void() > func;
+    };
+
+    /*! Return the number of workers that may run tasks, threadCount() - 1. */
+    Index activeWorkers_() const;
+
+    /*! Start workers until there are threadCount() - 1. */
+    void startWorkers_();
+
+    /*! Loop of worker id, it only runs tasks while id < activeWorkers_(). */
+    void work_(Index id);
+
+    /*! Run the next queued task of group (any group for NULL) with the
+     * lock released during the run. Return false if there is none. */
+    bool runNext_(Lock & lock, TaskGroup * group);
+
+    mutable Mutex mutex_;
+    Condition condition_;
+    std::deque < Task > queue_;
+    std::vector < Thread * > workers_;
+    bool stop_;
+};
+
+/*! Return the process wide thread pool. */
+DLLEXPORT ThreadPool & threadPool();
+
 class BaseCalcMT{
 public:
     BaseCalcMT(Index count=0, bool verbose=false)
@@ -56,44 +154,83 @@ protected:
     Index threadNumber_;
 };
 
-template < class T > void distributeCalc(T calc, uint nCalcs, uint nThreads, bool verbose=false){
-    if (nThreads == 1){
+//! Index ranges of a \ref distributeCalc that are shared by its parts.
+/*! Every part starts with an equal share of the indices and takes chunks
+ * from the front of it. A part that has run out steals the back half of
+ * the largest remaining range, so parts with cheap indices take over work
+ * from parts with expensive ones. */
+class DLLEXPORT WorkRanges{
+public:
+    /*! A chunkSize of 0 chooses about eight chunks per part. */
+    WorkRanges(Index nCalcs, Index nParts, Index chunkSize=0);
+
+    /*! Set [start, end) to the next chunk for part. Return false if no
+     * indices are left. */
+    bool next(Index part, Index & start, Index & end);
+
+    /*! Drop all remaining indices, e.g., after an exception. */
+    void cancel();
+
+    /*! Return the number of indices taken at once. */
+    Index chunkSize() const { return chunk_; }
+
+protected:
+    ThreadPool::Mutex mutex_;
+    std::vector < Index > begin_;
+    std::vector < Index > end_;
+    Index chunk_;
+};
+
+/*! Call calc for all indices [0, nCalcs) with nThreads parts, 0 uses
+ * \ref threadCount(). Every part works on its own copy of calc that is
+ * called with \ref BaseCalcMT::setRange for one chunk after another until
+ * all indices are done, see \ref WorkRanges. Give a chunkSize of 1 if
+ * every index is expensive. The parts run on the \ref threadPool and the
+ * calling thread works on the first one. The first exception of a part is
+ * rethrown after all parts have stopped. */
+template < class T > void distributeCalc(T calc, Index nCalcs, Index nThreads,
+                                         bool verbose=false, Index chunkSize=0){
+    if (nThreads == 0) nThreads = threadCount();
+    nThreads = std::min(nThreads, nCalcs);
+
+    if (nThreads < 2){
         calc.setRange(0, nCalcs);
         calc();
-    } else {
-        uint singleCalcCount = (uint)ceil((double)nCalcs / (double)nThreads);
-
-        std::vector < T > calcObjs;
-        for (uint i = 0; i < nThreads; i ++){
-            calcObjs.push_back(calc);
-            Index start = singleCalcCount * i;
-            Index end   = singleCalcCount * (i + 1);
-            if (i == nThreads -1) end = nCalcs;
-            if (debug()) std::cout << "Threaded calculation: " << i << ": " << start <<" " << end << std::endl;
-            calcObjs.back().setRange(start, end, i);
-        }
-#if USE_BOOST_THREAD
-        boost::thread_group threads;
-        for (uint i = 0; i < nThreads; i++) {
-            if (debug()) std::cout << "start thread: " << i << std::endl;
-            threads.create_thread(calcObjs[i]);
-        }
-        threads.join_all();
-#else
-
-        std::vector<std::thread> threads;
+        return;
+    }
 
-        for (uint i = 0; i < nThreads; i++) {
-            if (debug()) std::cout << "start thread: " << i << std::endl;
-            threads.emplace_back(calcObjs[i]);
+    std::vector < T > calcObjs(nThreads, calc);
+    WorkRanges ranges(nCalcs, nThreads, chunkSize);
+
+    std::function< void(Index) > part = [&calcObjs, &ranges](Index i){
+        Index start = 0, end = 0;
+        try {
+            while (ranges.next(i, start, end)){
+                if (debug()) std::cout << "Threaded calculation: " << i << ": "
+                                       << start << " " << end << std::endl;
+                calcObjs[i].setRange(start, end, i);
+                calcObjs[i]();
+            }
+        } catch (...) {
+            ranges.cancel();
+            throw;
         }
+    };
 
-        for (auto & th : threads) if (th.joinable()) th.join();
+    TaskGroup group;
+    for (Index i = 1; i < nThreads; i ++){
+        threadPool().submit(group, std::bind(part, i));
+    }
 
-//         std::vector boost::thread_group threads;
-//         for (uint i = 0; i < nThreads; i++) calcObjs[i]();
-#endif
+    //** the other parts refer to calcObjs, so wait for them in any case
+    std::exception_ptr error;
+    try {
+        part(0);
+    } catch (...) {
+        error = std::current_exception();
     }
+    threadPool().wait(group);
+    if (error) std::rethrow_exception(error);
 }
 
 } // namespace GIMLI{
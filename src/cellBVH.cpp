@@ -0,0 +1,304 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "cellBVH.h"
+
+#include "calculateMultiThread.h"
+#include "mesh.h"
+#include "meshentities.h"
+#include "node.h"
+#include "shape.h"
+
+#include <algorithm>
+
+namespace GIMLI{
+
+const Index CellBVH::leafSize;
+
+//** amount of leaves for n items, the tree for n items has 2 * leaves - 1 nodes
+inline Index leafCount__(Index n){
+    return std::max(Index(1), (n + CellBVH::leafSize - 1) / CellBVH::leafSize);
+}
+
+class CellBoxesMT : public BaseCalcMT{
+public:
+    CellBoxesMT(CellBVH & bvh, const std::vector < Cell * > & cells,
+                bool verbose=false)
+        : BaseCalcMT(1, verbose), bvh_(&bvh), cells_(&cells){
+    }
+
+    virtual ~CellBoxesMT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index i = start_; i < end_; i ++){
+            const Cell & c = *(*cells_)[i];
+            double * box = &bvh_->itemBox_[6 * i];
+            for (Index d = 0; d < 3; d ++){
+                box[d] = MAX_DOUBLE;
+                box[3 + d] = -MAX_DOUBLE;
+            }
+            for (Index j = 0; j < c.nodeCount(); j ++){
+                const RVector3 & p = c.node(j).pos();
+                for (Index d = 0; d < 3; d ++){
+                    box[d] = std::min(box[d], p[d]);
+                    box[3 + d] = std::max(box[3 + d], p[d]);
+                }
+            }
+            //** pad the box so that touching positions accepted by
+            //** Shape::isInside are not missed due to round-off
+            double extent = 0.0, center = 0.0;
+            for (Index d = 0; d < 3; d ++){
+                extent = std::max(extent, box[3 + d] - box[d]);
+                bvh_->itemCenter_[3 * i + d] = 0.5 * (box[d] + box[3 + d]);
+                center = std::max(center, std::fabs(bvh_->itemCenter_[3 * i + d]));
+            }
+            double pad = 1e-8 * extent + TOUCH_TOLERANCE * (1.0 + center);
+            for (Index d = 0; d < 3; d ++){
+                box[d] -= pad;
+                box[3 + d] += pad;
+            }
+        }
+    }
+
+protected:
+    CellBVH * bvh_;
+    const std::vector < Cell * > * cells_;
+};
+
+class BuildCellBVHMT : public BaseCalcMT{
+public:
+    BuildCellBVHMT(CellBVH & bvh, const std::vector < Index > & tasks,
+                   bool verbose=false)
+        : BaseCalcMT(1, verbose), bvh_(&bvh), tasks_(&tasks){
+    }
+
+    virtual ~BuildCellBVHMT(){}
+
+    virtual void calc(Index tNr=0){
+        std::vector < Index > noTasks;
+        for (Index i = start_; i < end_; i ++){
+            bvh_->build_((*tasks_)[3 * i], (*tasks_)[3 * i + 1],
+                         (*tasks_)[3 * i + 2], 0, MAX_INT, noTasks);
+        }
+    }
+
+protected:
+    CellBVH * bvh_;
+    const std::vector < Index > * tasks_;
+};
+
+//** sort items along one axis of their centers
+class CellBVHCenterLess{
+public:
+    CellBVHCenterLess(const std::vector < double > & center, Index axis)
+        : center_(&center), axis_(axis){}
+
+    inline bool operator() (Index a, Index b) const {
+        return (*center_)[3 * a + axis_] < (*center_)[3 * b + axis_];
+    }
+
+protected:
+    const std::vector < double > * center_;
+    Index axis_;
+};
+
+CellBVH::CellBVH()
+    : dim_(3){
+}
+
+CellBVH::~CellBVH(){
+}
+
+void CellBVH::clear(){
+    nodes_.clear();
+    cells_.clear();
+    boxes_.clear();
+}
+
+void CellBVH::build(const Mesh & mesh, Index nThreads){
+    clear();
+    dim_ = std::max(Index(1), std::min(Index(3), Index(mesh.dim())));
+
+    const std::vector < Cell * > & cells = mesh.cells();
+    Index nItems = cells.size();
+    if (nItems == 0) return;
+
+    if (nThreads == 0) nThreads = threadCount();
+    nThreads = std::max(Index(1), std::min(nThreads, nItems / 10000 + 1));
+
+    itemBox_.resize(6 * nItems);
+    itemCenter_.resize(3 * nItems);
+    distributeCalc(CellBoxesMT(*this, cells), nItems, nThreads);
+
+    items_.resize(nItems);
+    for (Index i = 0; i < nItems; i ++) items_[i] = i;
+    nodes_.resize(2 * leafCount__(nItems) - 1);
+
+    //** split the upper levels serially until there are enough
+    //** independent subtrees to keep all threads busy
+    Index maxDepth = 0;
+    if (nThreads > 1){
+        while ((Index(1) << maxDepth) < 4 * nThreads) maxDepth ++;
+    }
+    std::vector < Index > tasks;
+    build_(0, 0, nItems, 0, maxDepth, tasks);
+    if (!tasks.empty()){
+        distributeCalc(BuildCellBVHMT(*this, tasks), tasks.size() / 3,
+                       std::min(nThreads, Index(tasks.size() / 3)));
+    }
+
+    //** children are stored behind their parent, so a reverse sweep
+    //** can merge the boxes of the inner nodes bottom-up
+    for (Index i = nodes_.size(); i-- > 0;){
+        TreeNode & n = nodes_[i];
+        if (n.count > 0) continue;
+        const TreeNode & l = nodes_[i + 1];
+        const TreeNode & r = nodes_[n.first];
+        for (Index d = 0; d < 3; d ++){
+            n.box[d] = std::min(l.box[d], r.box[d]);
+            n.box[3 + d] = std::max(l.box[3 + d], r.box[3 + d]);
+        }
+    }
+
+    cells_.resize(nItems);
+    boxes_.resize(6 * nItems);
+    for (Index i = 0; i < nItems; i ++){
+        cells_[i] = cells[items_[i]];
+        std::copy(&itemBox_[6 * items_[i]], &itemBox_[6 * items_[i]] + 6,
+                  &boxes_[6 * i]);
+    }
+
+    std::vector < Index >().swap(items_);
+    std::vector < double >().swap(itemBox_);
+    std::vector < double >().swap(itemCenter_);
+}
+
+void CellBVH::build_(Index node, Index start, Index end,
+                     Index depth, Index maxDepth,
+                     std::vector < Index > & tasks){
+    Index n = end - start;
+    TreeNode & tn = nodes_[node];
+
+    if (n <= leafSize){
+        tn.first = start;
+        tn.count = n;
+        for (Index d = 0; d < 3; d ++){
+            tn.box[d] = MAX_DOUBLE;
+            tn.box[3 + d] = -MAX_DOUBLE;
+        }
+        for (Index i = start; i < end; i ++){
+            const double * box = &itemBox_[6 * items_[i]];
+            for (Index d = 0; d < 3; d ++){
+                tn.box[d] = std::min(tn.box[d], box[d]);
+                tn.box[3 + d] = std::max(tn.box[3 + d], box[3 + d]);
+            }
+        }
+        return;
+    }
+
+    if (depth == maxDepth){
+        tasks.push_back(node);
+        tasks.push_back(start);
+        tasks.push_back(end);
+        return;
+    }
+
+    //** split along the longest extent of the cell centers
+    double cMin[3] = {MAX_DOUBLE, MAX_DOUBLE, MAX_DOUBLE};
+    double cMax[3] = {-MAX_DOUBLE, -MAX_DOUBLE, -MAX_DOUBLE};
+    for (Index i = start; i < end; i ++){
+        const double * c = &itemCenter_[3 * items_[i]];
+        for (Index d = 0; d < dim_; d ++){
+            cMin[d] = std::min(cMin[d], c[d]);
+            cMax[d] = std::max(cMax[d], c[d]);
+        }
+    }
+    Index axis = 0;
+    for (Index d = 1; d < dim_; d ++){
+        if (cMax[d] - cMin[d] > cMax[axis] - cMin[axis]) axis = d;
+    }
+
+    //** the left subtree gets a multiple of leafSize items, so the size
+    //** of every subtree is known in advance and the layout is fixed
+    Index leftLeaves = leafCount__(n) / 2;
+    Index mid = start + leftLeaves * leafSize;
+    std::nth_element(items_.begin() + start, items_.begin() + mid,
+                     items_.begin() + end,
+                     CellBVHCenterLess(itemCenter_, axis));
+
+    tn.count = 0;
+    tn.first = node + 2 * leftLeaves;
+    build_(node + 1, start, mid, depth + 1, maxDepth, tasks);
+    build_(node + 2 * leftLeaves, mid, end, depth + 1, maxDepth, tasks);
+}
+
+template < class Visit > Cell * CellBVH::traverse_(const RVector3 & pos,
+                                                   Visit & visit) const {
+    if (nodes_.empty()) return NULL;
+
+    //** the tree is balanced, its depth is below log2(size) + 2
+    Index stack[128];
+    Index top = 0;
+    stack[top++] = 0;
+
+    while (top > 0){
+        Index i = stack[--top];
+        const TreeNode & n = nodes_[i];
+        if (!touch_(n.box, pos)) continue;
+
+        if (n.count > 0){
+            Cell * c = visit(n.first, n.count);
+            if (c) return c;
+        } else {
+            stack[top++] = n.first;
+            stack[top++] = i + 1;
+        }
+    }
+    return NULL;
+}
+
+Cell * CellBVH::find(const RVector3 & pos) const {
+    size_t count = 0;
+    return find(pos, count);
+}
+
+Cell * CellBVH::find(const RVector3 & pos, size_t & count) const {
+    auto visit = [&](Index first, Index n) -> Cell * {
+        for (Index i = first; i < first + n; i ++){
+            if (!touch_(&boxes_[6 * i], pos)) continue;
+            count ++;
+            if (cells_[i]->shape().isInside(pos, false)) return cells_[i];
+        }
+        return NULL;
+    };
+    return traverse_(pos, visit);
+}
+
+std::vector < Cell * > CellBVH::candidates(const RVector3 & pos) const {
+    std::vector < Cell * > ret;
+    auto visit = [&](Index first, Index n) -> Cell * {
+        for (Index i = first; i < first + n; i ++){
+            if (touch_(&boxes_[6 * i], pos)) ret.push_back(cells_[i]);
+        }
+        return NULL;
+    };
+    traverse_(pos, visit);
+    return ret;
+}
+
+} // namespace GIMLI
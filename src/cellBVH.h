@@ -0,0 +1,125 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_CELLBVH__H
+#define _GIMLI_CELLBVH__H
+
+#include "gimli.h"
+#include "pos.h"
+
+#include <vector>
+
+namespace GIMLI{
+
+//! Bounding volume hierarchy over the cells of a mesh.
+/*! Static bounding volume hierarchy (BVH) over the axis aligned bounding
+ * boxes of all cells of a \ref Mesh, used for point-in-cell queries.
+ * The cells are split at the median of their centers along the longest axis
+ * until at most four cells are left in a leaf, so the tree is balanced and a
+ * query visits O(log n) nodes. The nodes are stored in a single flat array
+ * in depth-first order: the left child of an inner node follows its parent
+ * directly, only the index of the right child is stored.
+ * Building is distributed over several threads, queries only read the tree
+ * and can run concurrently. The tree holds no reference to the mesh, it has
+ * to be rebuilt if cells are added or nodes are moved. */
+class DLLEXPORT CellBVH{
+public:
+    /*! Maximum number of cells in a leaf. */
+    static const Index leafSize = 4;
+
+    /*! Default constructor, create an empty tree. */
+    CellBVH();
+
+    /*! Default destructor. */
+    ~CellBVH();
+
+    /*! Build the tree for all cells of the mesh with up to nThreads threads
+     * (0 = \ref threadCount()). An existing tree is replaced. */
+    void build(const Mesh & mesh, Index nThreads=0);
+
+    /*! Remove all cells from the tree. */
+    void clear();
+
+    /*! Return the amount of cells inside the tree. */
+    inline Index size() const { return cells_.size(); }
+
+    /*! Return the amount of tree nodes. */
+    inline Index nodeCount() const { return nodes_.size(); }
+
+    /*! Return the first cell that contains pos or NULL if pos is outside
+     * the mesh. Only cells whose bounding box contains pos are tested with
+     * \ref Shape::isInside. */
+    Cell * find(const RVector3 & pos) const;
+
+    /*! Same as \ref find(const RVector3 & pos), count is increased by the
+     * amount of cells tested. */
+    Cell * find(const RVector3 & pos, size_t & count) const;
+
+    /*! Return all cells with a bounding box that contains pos. */
+    std::vector < Cell * > candidates(const RVector3 & pos) const;
+
+protected:
+    struct TreeNode{
+        //! min and max corner of the bounding box
+        double box[6];
+        //! leaf: first cell in cells_, inner node: index of the right child
+        Index first;
+        //! amount of cells, 0 for inner nodes
+        Index count;
+    };
+
+    /*! Return true if the first dim_ coordinates of pos lie inside the
+     * box given by its min and max corner. */
+    inline bool touch_(const double * box, const RVector3 & pos) const {
+        for (Index d = 0; d < dim_; d ++){
+            if (pos[d] < box[d] || pos[d] > box[3 + d]) return false;
+        }
+        return true;
+    }
+
+    /*! Build the subtree for the items [start, end) at node. Stops at
+     * depth maxDepth and appends the remaining subtrees to tasks as
+     * (node, start, end). */
+    void build_(Index node, Index start, Index end,
+                Index depth, Index maxDepth,
+                std::vector < Index > & tasks);
+
+    /*! Traverse the tree and call visit(first, count) for every leaf
+     * touched by pos until it returns a cell. */
+    template < class Visit > Cell * traverse_(const RVector3 & pos,
+                                              Visit & visit) const;
+
+    friend class CellBoxesMT;
+    friend class BuildCellBVHMT;
+
+    Index dim_;
+
+    std::vector < TreeNode > nodes_;
+    std::vector < Cell * > cells_;
+    //** cell boxes in tree order, 6 values per cell
+    std::vector < double > boxes_;
+
+    //** build scratch: item order, cell boxes and centers
+    std::vector < Index > items_;
+    std::vector < double > itemBox_;
+    std::vector < double > itemCenter_;
+};
+
+} // namespace GIMLI
+
+#endif // _GIMLI_CELLBVH__H
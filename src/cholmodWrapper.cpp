@@ -17,6 +17,7 @@
  ******************************************************************************/
 
 #include "cholmodWrapper.h"
+#include "matrix.h"
 #include "vector.h"
 #include "sparsematrix.h"
 
@@ -266,8 +267,10 @@ int CHOLMODWrapper::factorise(){
          } else {
             if (verbose_) cholmod_print_sparse((cholmod_sparse *)A_, "A", (cholmod_common*)c_);
 
-            L_ = cholmod_analyze((cholmod_sparse*)A_,
-                            (cholmod_common*)c_);		    /* analyze */
+            if (!L_){
+                L_ = cholmod_analyze((cholmod_sparse*)A_,
+                                (cholmod_common*)c_);		    /* analyze */
+            }
             cholmod_factorize((cholmod_sparse*)A_,
                         (cholmod_factor*)L_,
                         (cholmod_common*)c_);		    /* factorize */
@@ -283,6 +286,32 @@ int CHOLMODWrapper::factorise(){
     return 0;
 }
 
+template < class ValueType >
+int CHOLMODWrapper::refactorise_(SparseMatrix < ValueType > & S){
+    if (dummy_ || useUmfpack_ || !A_ || !L_) return 0;
+#if USE_CHOLMOD
+    if (((cholmod_sparse*)A_)->nrow != S.nRows() ||
+        ((cholmod_sparse*)A_)->nzmax != S.nVals()) return 0;
+
+    //** S may live in different storage than the analysed matrix
+    ((cholmod_sparse*)A_)->p = (void*)S.colPtr();
+    ((cholmod_sparse*)A_)->i = (void*)S.rowIdx();
+    ((cholmod_sparse*)A_)->x = S.vals();
+
+    return factorise();
+#else
+    return 0;
+#endif
+}
+
+int CHOLMODWrapper::refactorise(RSparseMatrix & S){
+    return refactorise_(S);
+}
+
+int CHOLMODWrapper::refactorise(CSparseMatrix & S){
+    return refactorise_(S);
+}
+
 template < class ValueType >
     int CHOLMODWrapper::solveCHOL_(const Vector < ValueType > & rhs,
                                    Vector < ValueType > & solution){
@@ -328,6 +357,60 @@ template < class ValueType >
     return 0;
 }
 
+template < class ValueType >
+    int CHOLMODWrapper::solveCHOL_(const Matrix < ValueType > & rhs,
+                                   Matrix < ValueType > & solution){
+    if (!dummy_){
+#if USE_CHOLMOD
+        Index nRHS = rhs.rows();
+        solution.resize(nRHS, dim_);
+        if (nRHS == 0) return 1;
+
+        //** one column per right hand side
+        cholmod_dense * b = cholmod_zeros(((cholmod_sparse*)A_)->nrow,
+                                          nRHS,
+                                          ((cholmod_sparse*)A_)->xtype,
+                                          (cholmod_common*)c_);
+
+        ValueType * bx = (ValueType*)b->x;
+        for (Index j = 0; j < nRHS; j ++){
+            if (rhs[j].size() != dim_){
+                cholmod_free_dense(&b, (cholmod_common*)c_);
+                throwLengthError(1, WHERE_AM_I + " rhs size mismatch: " +
+                                 str(rhs[j].size()) + " != " + str(dim_));
+            }
+            std::copy(&rhs[j][0], &rhs[j][0] + dim_, bx + j * b->d);
+        }
+
+        cholmod_dense * x = cholmod_solve(CHOLMOD_A,
+                                          (cholmod_factor *)L_,
+                                          b,
+                                          (cholmod_common *)c_);       /* solve AX=B */
+        bx = (ValueType *)x->x;
+        for (Index j = 0; j < nRHS; j ++){
+            std::copy(bx + j * x->d, bx + j * x->d + dim_, &solution[j][0]);
+        }
+        cholmod_free_dense(&x, (cholmod_common*)c_);
+        cholmod_free_dense(&b, (cholmod_common*)c_);
+        return 1;
+#else
+    std::cerr << WHERE_AM_I << " cholmod not installed" << std::endl;
+#endif
+    }
+    return 0;
+}
+
+int CHOLMODWrapper::solve(const RMatrix & rhs, RMatrix & solution){
+    //** umfpack and the full storage path need their own single solves
+    if (useUmfpack_ || stype_ == 0) return SolverWrapper::solve(rhs, solution);
+    return solveCHOL_(rhs, solution);
+}
+
+int CHOLMODWrapper::solve(const CMatrix & rhs, CMatrix & solution){
+    if (useUmfpack_ || stype_ == 0) return SolverWrapper::solve(rhs, solution);
+    return solveCHOL_(rhs, solution);
+}
+
 int CHOLMODWrapper::solve(const RVector & rhs, RVector & solution){
     if (!dummy_){
 
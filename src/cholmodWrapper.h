@@ -40,6 +40,18 @@ public:
 
     virtual int solve(const CVector & rhs, CVector & solution);
 
+    /*! Solve for all right hand sides (rows of rhs) with one blocked
+     * triangular solve. */
+    virtual int solve(const RMatrix & rhs, RMatrix & solution);
+
+    /*! Solve for all right hand sides (rows of rhs) with one blocked
+     * triangular solve. */
+    virtual int solve(const CMatrix & rhs, CMatrix & solution);
+
+    virtual int refactorise(RSparseMatrix & S);
+
+    virtual int refactorise(CSparseMatrix & S);
+
 protected:
     void init();
 
@@ -53,9 +65,15 @@ protected:
     template < class ValueType >
     int initMatrixChol_(SparseMatrix < ValueType > & S, int xType);
 
+    template < class ValueType >
+    int refactorise_(SparseMatrix < ValueType > & S);
+
     template < class ValueType >
     int solveCHOL_(const Vector < ValueType > & rhs, Vector < ValueType > & solution);
 
+    template < class ValueType >
+    int solveCHOL_(const Matrix < ValueType > & rhs, Matrix < ValueType > & solution);
+
 
     template < class ValueType >
     int solveUmf_(const Vector < ValueType > & rhs, Vector < ValueType > & solution);
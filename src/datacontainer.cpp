@@ -17,10 +17,15 @@
  ******************************************************************************/
 
 #include "datacontainer.h"
+#include "calculateMultiThread.h"
+#include "mappedFile.h"
 #include "pos.h"
 #include "numericbase.h"
 #include "vectortemplates.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace GIMLI{
 
 DataContainer::DataContainer(){
@@ -184,14 +189,222 @@ bool DataContainer::isSensorIndex(const std::string & token) const {
     return dataSensorIdx_.find(token) != dataSensorIdx_.end();
 }
 
+/*! Row reader on a mapped text file. row() and nonEmptyRow() split like
+ * getRowSubstrings and getNonEmptyRow, i.e., at white spaces and without
+ * the comment that starts with #. */
+class DataTextReader{
+public:
+    DataTextReader(const char * begin, const char * end)
+        : pos_(begin), end_(end){
+    }
+
+    inline bool eof() const { return pos_ >= end_; }
+
+    /*! Return the next character or 0 at the end of the file. */
+    inline char peek() const { return eof() ? 0 : *pos_; }
+
+    inline void skip() { if (!eof()) pos_ ++; }
+
+    /*! Return the substrings of the next line. */
+    std::vector < std::string > row(){
+        std::vector < std::string > subStrings;
+        const char * eol = lineEnd_(pos_, end_);
+        const char * c = pos_;
+        while (c < eol && *c != '#'){
+            while (c < eol && *c != '#' && isSpace__(*c)) c ++;
+            const char * s = c;
+            while (c < eol && *c != '#' && !isSpace__(*c)) c ++;
+            if (c > s) subStrings.push_back(std::string(s, c));
+        }
+        pos_ = eol < end_ ? eol + 1 : end_;
+        return subStrings;
+    }
+
+    std::vector < std::string > nonEmptyRow(){
+        std::vector < std::string > r;
+        while ((r = row()).empty() && !eof());
+        return r;
+    }
+
+    inline const char * pos() const { return pos_; }
+    inline void setPos(const char * pos) { pos_ = pos; }
+
+    static inline bool isSpace__(char c){
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    static inline const char * lineEnd_(const char * p, const char * end){
+        const char * eol = (const char *)std::memchr(p, '\n', end - p);
+        return eol ? eol : end;
+    }
+
+protected:
+    const char * pos_;
+    const char * end_;
+};
+
+//** exact powers of ten of the fast path in parseDouble__
+static const double exactPow10__[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/*! Convert the token [s, e) without allocation. Plain decimal numbers with
+ * a mantissa up to 2^53 and a decimal exponent up to 22 are computed with
+ * one exact multiplication or division, which gives the same correctly
+ * rounded value as strtod. Everything else (long mantissas, nan, inf, hex,
+ * garbage) is passed to strtod, like toDouble. */
+static double parseDouble__(const char * s, const char * e){
+    const char * p = s;
+    bool neg = false;
+    if (p < e && (*p == '-' || *p == '+')) neg = (*p ++ == '-');
+
+    uint64 m = 0;
+    int nDigits = 0, exp10 = 0;
+    bool fast = true;
+    for (; p < e && *p >= '0' && *p <= '9'; p ++, nDigits ++){
+        if (nDigits < 19) m = m * 10 + (*p - '0'); else fast = false;
+    }
+    if (p < e && *p == '.'){
+        p ++;
+        for (; p < e && *p >= '0' && *p <= '9'; p ++, nDigits ++){
+            if (nDigits < 19) m = m * 10 + (*p - '0'); else fast = false;
+            exp10 --;
+        }
+    }
+    if (nDigits > 0 && p < e && (*p == 'e' || *p == 'E')){
+        p ++;
+        bool eNeg = false;
+        if (p < e && (*p == '-' || *p == '+')) eNeg = (*p ++ == '-');
+        int ex = 0;
+        if (p == e) fast = false;
+        for (; p < e && *p >= '0' && *p <= '9'; p ++){
+            if (ex < 10000) ex = ex * 10 + (*p - '0');
+        }
+        exp10 += eNeg ? -ex : ex;
+    }
+
+    if (fast && nDigits > 0 && p == e && m <= (uint64(1) << 53) &&
+        exp10 >= -22 && exp10 <= 22){
+        double v = exp10 < 0 ? double(m) / exactPow10__[-exp10]
+                             : double(m) * exactPow10__[exp10];
+        return neg ? -v : v;
+    }
+
+    char buf[64];
+    if (e - s < 64){
+        std::memcpy(buf, s, e - s);
+        buf[e - s] = '\0';
+        return std::strtod(buf, NULL);
+    }
+    return std::strtod(std::string(s, e).c_str(), NULL);
+}
+
+/*! Parse the data block of a unified data file from chunks of whole lines.
+ * Counting pass: count the non empty lines of every chunk. Parsing pass:
+ * fill the values of line first_[chunk] + k into the columns. */
+class DataBlockParserMT : public BaseCalcMT{
+public:
+    DataBlockParserMT(const std::vector < const char * > & chunks,
+                      const std::vector < Index > & colOfToken,
+                      std::vector < double * > & cols, Index nData,
+                      std::vector < Index > & count,
+                      std::vector < Index > & first,
+                      std::vector < Index > & nTokens,
+                      const char ** dataEnd, bool parse, bool verbose=false)
+        : BaseCalcMT(1, verbose), chunks_(&chunks), colOfToken_(&colOfToken),
+          cols_(&cols), nData_(nData), count_(&count), first_(&first),
+          nTokens_(&nTokens), dataEnd_(dataEnd), parse_(parse){
+    }
+
+    virtual ~DataBlockParserMT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index c = start_; c < end_; c ++){
+            if (parse_) parseChunk_(c); else countChunk_(c);
+        }
+    }
+
+protected:
+    void countChunk_(Index c){
+        const char * p = (*chunks_)[c];
+        const char * end = (*chunks_)[c + 1];
+        Index n = 0;
+        while (p < end){
+            const char * eol = DataTextReader::lineEnd_(p, end);
+            while (p < eol && DataTextReader::isSpace__(*p)) p ++;
+            if (p < eol && *p != '#') n ++;
+            p = eol < end ? eol + 1 : end;
+        }
+        (*count_)[c] = n;
+    }
+
+    void parseChunk_(Index c){
+        const char * p = (*chunks_)[c];
+        const char * end = (*chunks_)[c + 1];
+        const std::vector < Index > & colOfToken = *colOfToken_;
+        double ** cols = &(*cols_)[0];
+        Index nFormat = colOfToken.size();
+        Index i = (*first_)[c];
+        Index nTokens = 0;
+
+        while (p < end && i < nData_){
+            const char * eol = DataTextReader::lineEnd_(p, end);
+            const char * t = p;
+            p = eol < end ? eol + 1 : end;
+            while (t < eol && DataTextReader::isSpace__(*t)) t ++;
+            if (t == eol || *t == '#') continue;
+
+            //** tokens behind the format are ignored
+            for (Index j = 0; j < nFormat; j ++){
+                while (t < eol && DataTextReader::isSpace__(*t)) t ++;
+                if (t == eol || *t == '#') break;
+                const char * s = t;
+                while (t < eol && *t != '#' && !DataTextReader::isSpace__(*t)) t ++;
+                cols[colOfToken[j]][i] = parseDouble__(s, t);
+                nTokens = std::max(nTokens, j + 1);
+            }
+            if (i == nData_ - 1) *dataEnd_ = p;
+            i ++;
+        }
+        (*nTokens_)[c] = nTokens;
+    }
+
+    const std::vector < const char * > * chunks_;
+    const std::vector < Index > * colOfToken_;
+    std::vector < double * > * cols_;
+    Index nData_;
+    std::vector < Index > * count_;
+    std::vector < Index > * first_;
+    std::vector < Index > * nTokens_;
+    const char ** dataEnd_;
+    bool parse_;
+};
+
+//** bytes per thread below which the data block is parsed serial
+static const Index dataBytesPerThread__ = 1 << 20;
+
+/*! Magic of the binary DataContainer format, followed by a version byte. */
+static const char dataBinaryMagic__[7] = {'G', 'I', 'M', 'L', 'i', 'D', 'C'};
+
+static bool isBinaryDataFile__(const MappedFile & file){
+    return file.size() >= 8 &&
+           std::memcmp(file.data(), dataBinaryMagic__, 7) == 0;
+}
+
 int DataContainer::load(const std::string & fileName,
                         bool sensorIndicesFromOne,
                         bool removeInvalid){
     setSensorIndexOnFileFromOne(sensorIndicesFromOne);
 
-	std::fstream file; openInFile(fileName, & file, true);
+    MappedFile mapped(fileName);
+    if (isBinaryDataFile__(mapped)){
+        this->loadBinary_(mapped);
+        this->checkDataValidity(removeInvalid);
+        return 1;
+    }
+    DataTextReader file(mapped.data(), mapped.data() + mapped.size());
 
-    std::vector < std::string > row(getNonEmptyRow(file));
+    std::vector < std::string > row(file.nonEmptyRow());
 
     if (row.size() != 1){
         throwError(EXIT_DATACONTAINER_NELECS, WHERE_AM_I + " cannot determine data format. " + str(row.size()));
@@ -209,16 +422,15 @@ int DataContainer::load(const std::string & fileName,
     std::string sensorFormatDefault("x y z");
     std::vector < std::string > format(getSubstrings(sensorFormatDefault));
 
-    char c; file.get(c);
-    if (c == '#') {
-        format = getRowSubstrings(file);
+    if (file.peek() == '#') {
+        file.skip();
+        format = file.row();
 //         if (format[0][0] != 'x' && format[0][0] != 'X'){
 //             format = getSubstrings(elecsFormatDefault);
 //         }
     } else {
         format = getSubstrings(sensorFormatDefault);
     }
-    file.unget();
 
     inputFormatStringSensors_.clear();
     for (uint i = 0; i < format.size(); i ++)
@@ -226,7 +438,7 @@ int DataContainer::load(const std::string & fileName,
 
     //** read sensor
     for (int i = 0; i < nSensors; i ++){
-        row = getNonEmptyRow(file);
+        row = file.nonEmptyRow();
 
         if (row.empty()){
             throwError(EXIT_DATACONTAINER_NELECS,
@@ -256,7 +468,7 @@ int DataContainer::load(const std::string & fileName,
         createSensor(RVector3(x[i], y[i], z[i]).round(1e-12));
     }
     //****************************** Start read the data;
-    row = getNonEmptyRow(file);
+    row = file.nonEmptyRow();
     if (row.size() != 1) {
         for (Index i = 0; i < row.size(); i ++){
             std::cerr << row[i] << " ";
@@ -275,38 +487,71 @@ int DataContainer::load(const std::string & fileName,
         this->resize(nData);
 
         //** looking for # symbol which start format description section
-        file.get(c);
-        if (c == '#') {
-            format = getRowSubstrings(file);
+        if (file.peek() == '#') {
+            file.skip();
+            format = file.row();
             if (format.size() == 0){
                 throwError(EXIT_DATACONTAINER_NO_DATAFORMAT, WHERE_AM_I + "Can not determine data format.");
             }
 //            if (format.size() == 4) schemeOnly = true;
         }
-        file.unget();
+    }
 
+    //** one column for every unique token, repeated tokens share the column
+    std::vector < std::string > colTokens;
+    std::vector < Index > colOfToken(format.size());
+    for (Index j = 0; j < format.size(); j ++){
+        colOfToken[j] = std::find(colTokens.begin(), colTokens.end(), format[j])
+                        - colTokens.begin();
+        if (colOfToken[j] == colTokens.size()) colTokens.push_back(format[j]);
     }
 
     std::map< std::string, RVector > tmpMap;
 
-    for (int data = 0; data < nData; data ++){
-        row = getNonEmptyRow(file);
-
-        if (row.empty()){
+    if (nData > 0){
+        //** split the rest of the file into chunks of whole lines
+        const char * begin = file.pos();
+        const char * end = mapped.data() + mapped.size();
+        Index nThreads = std::max(Index(1), std::min(threadCount(),
+                                  Index(end - begin) / dataBytesPerThread__));
+        std::vector < const char * > chunks(1, begin);
+        for (Index c = 1; c < nThreads; c ++){
+            const char * p = begin + (end - begin) * c / nThreads;
+            if (p < chunks.back()) p = chunks.back();
+            p = DataTextReader::lineEnd_(p, end);
+            chunks.push_back(p < end ? p + 1 : end);
+        }
+        chunks.push_back(end);
+
+        std::vector < Index > count(nThreads, 0), first(nThreads, 0),
+                              nTokens(nThreads, 0);
+        std::vector < RVector > cols(colTokens.size(), RVector(nData, 0.0));
+        std::vector < double * > colPtr(cols.size() + 1, NULL);
+        for (Index i = 0; i < cols.size(); i ++) colPtr[i] = &cols[i][0];
+        const char * dataEnd = NULL;
+
+        distributeCalc(DataBlockParserMT(chunks, colOfToken, colPtr, nData,
+                                         count, first, nTokens, &dataEnd, false),
+                       nThreads, nThreads);
+        Index nRows = 0;
+        for (Index c = 0; c < nThreads; c ++){
+            first[c] = nRows;
+            nRows += count[c];
+        }
+        if (nRows < Index(nData)){
             throwError(EXIT_DATACONTAINER_DATASIZE,
                        WHERE_AM_I + " To few data. " + str(nData) +
-                       " data expected and " + str(data) + " data found.");
+                       " data expected and " + str(nRows) + " data found.");
         }
-
-        for (uint j = 0; j < row.size(); j ++){
-            if (j == format.size()) break;
-
-            if (!tmpMap.count(format[j])){
-                tmpMap.insert(std::pair< std::string, RVector > (format[j], RVector(nData, 0.0))) ;
-            }
-// 	    std::cout << format[j] << " " << tmpMap[format[j]].size() << std::endl;
-// 	    std::cout << row[j] << " " << toDouble(row[j]) << std::endl;
-            tmpMap[format[j]][data] = toDouble(row[j]);
+        distributeCalc(DataBlockParserMT(chunks, colOfToken, colPtr, nData,
+                                         count, first, nTokens, &dataEnd, true),
+                       nThreads, nThreads);
+        file.setPos(dataEnd);
+
+        //** only columns that are given in at least one row
+        Index maxTokens = *std::max_element(nTokens.begin(), nTokens.end());
+        for (Index j = 0; j < std::min(maxTokens, Index(format.size())); j ++){
+            if (!tmpMap.count(format[j])) tmpMap[format[j]] = cols[colOfToken[j]];
         }
     }
 
@@ -361,7 +606,7 @@ int DataContainer::load(const std::string & fileName,
     this->checkDataValidity(removeInvalid);
 
     //** start read topography;
-    row = getNonEmptyRow(file);
+    row = file.nonEmptyRow();
 
     if (row.size() == 1) {
         //** we found topography
@@ -373,20 +618,18 @@ int DataContainer::load(const std::string & fileName,
 
             std::string topoFormatDefault("x y z");
 
-            file.get(c);
-            if (c == '#') {
-                format = getRowSubstrings(file);
+            if (file.peek() == '#') {
+                file.skip();
+                format = file.row();
                 if (format[0] != "x" && format[0] != "X"){
                     //** if no electrodes format is given (no x after comment symbol) take defaults;
                     format = getSubstrings(topoFormatDefault);
                 }
-            } else {
-                file.unget();
             }
 
             //** read topography points;
             for (Index i = 0; i < nTopoPoints; i ++){
-                row = getNonEmptyRow(file);
+                row = file.nonEmptyRow();
 
                 if (row.empty()) {
                     throwError(EXIT_DATACONTAINER_NTOPO, WHERE_AM_I
@@ -415,7 +658,6 @@ int DataContainer::load(const std::string & fileName,
         } // if nTopo > 0
     } // if topo
 
-    file.close();
     return 1;
 }
 
@@ -573,6 +815,161 @@ int DataContainer::save(const std::string & fileName,
     return 1;
 }
 
+template < class ValueType >
+static void writeData__(FILE * file, const ValueType * v, Index count,
+                        const std::string & fileName){
+    if (count > 0 && fwrite(v, sizeof(ValueType), count, file) != count){
+        fclose(file);
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": " + strerror(errno));
+    }
+}
+
+static void writeString__(FILE * file, const std::string & s,
+                          const std::string & fileName){
+    uint32 n = s.size();
+    writeData__(file, &n, 1, fileName);
+    writeData__(file, s.data(), n, fileName);
+}
+
+static std::string readString__(MappedReader & reader){
+    uint32 n = reader.read< uint32 >();
+    return std::string(reader.section< char >(n), n);
+}
+
+static void writePositions__(FILE * file, const std::vector < RVector3 > & pos,
+                             const std::string & fileName){
+    std::vector < double > xyz(3 * pos.size());
+    for (Index i = 0; i < pos.size(); i ++){
+        for (Index j = 0; j < 3; j ++) xyz[i * 3 + j] = pos[i][j];
+    }
+    uint64 n = pos.size();
+    writeData__(file, &n, 1, fileName);
+    writeData__(file, xyz.data(), xyz.size(), fileName);
+}
+
+static std::vector < RVector3 > readPositions__(MappedReader & reader){
+    uint64 n = reader.read< uint64 >();
+    const char * p = reader.section< double >(3 * n);
+    std::vector < RVector3 > pos(n);
+    for (Index i = 0; i < n; i ++){
+        pos[i] = RVector3(MappedReader::at< double >(p, 3 * i),
+                          MappedReader::at< double >(p, 3 * i + 1),
+                          MappedReader::at< double >(p, 3 * i + 2));
+    }
+    return pos;
+}
+
+int DataContainer::saveBinary(const std::string & fileName) const {
+//   char[7]  "GIMLiDC", uint8[1] file format version
+//   uint64[1] nSensors, double[3 * nSensors] sensor positions
+//   uint64[1] nPoints, double[3 * nPoints] additional points
+//   uint64[1] data size, uint64[1] nFields
+//   nFields times: string token, uint8[1] is sensor index, double[size] values
+//   uint64[1] nDescriptions, nDescriptions times: string token, string text
+//   string inputFormatString, string inputFormatStringSensors
+//   uint8[1] sensor indices on file from one
+//   string: uint32[1] length, char[length]
+
+    FILE * file = fopen(fileName.c_str(), "w+b");
+    if (!file) {
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": " + strerror(errno));
+    }
+
+    uint8 version = 1;
+    writeData__(file, dataBinaryMagic__, 7, fileName);
+    writeData__(file, &version, 1, fileName);
+
+    writePositions__(file, sensorPoints_, fileName);
+    writePositions__(file, topoPoints_, fileName);
+
+    uint64 n[2] = {this->size(), dataMap_.size()};
+    writeData__(file, n, 2, fileName);
+    for (std::map< std::string, RVector >::const_iterator it = dataMap_.begin();
+         it != dataMap_.end(); it ++){
+        writeString__(file, it->first, fileName);
+        uint8 isIdx = isSensorIndex(it->first);
+        writeData__(file, &isIdx, 1, fileName);
+        if (it->second.size() != n[0]){
+            fclose(file);
+            throwError(1, WHERE_AM_I + " " + it->first + " has size "
+                       + str(it->second.size()) + " but not " + str(n[0]));
+        }
+        if (n[0] > 0) writeData__(file, &it->second[0], n[0], fileName);
+    }
+
+    uint64 nDesc = dataDescription_.size();
+    writeData__(file, &nDesc, 1, fileName);
+    for (std::map< std::string, std::string >::const_iterator it = dataDescription_.begin();
+         it != dataDescription_.end(); it ++){
+        writeString__(file, it->first, fileName);
+        writeString__(file, it->second, fileName);
+    }
+
+    writeString__(file, inputFormatString_, fileName);
+    writeString__(file, inputFormatStringSensors_, fileName);
+    uint8 fromOne = sensorIndexOnFileFromOne_;
+    writeData__(file, &fromOne, 1, fileName);
+
+    fclose(file);
+    return 1;
+}
+
+int DataContainer::loadBinary(const std::string & fileName){
+    MappedFile mapped(fileName);
+    if (!isBinaryDataFile__(mapped)){
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName +
+                   ": no binary data container file.");
+    }
+    this->loadBinary_(mapped);
+    return 1;
+}
+
+void DataContainer::loadBinary_(const MappedFile & mapped){
+    MappedReader reader(mapped);
+    reader.section< char >(7);
+    uint8 version = reader.read< uint8 >();
+    if (version != 1){
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + mapped.fileName() +
+                   ": unknown binary data container version " + str(int(version)));
+    }
+
+    std::vector < RVector3 > sensors(readPositions__(reader));
+    std::vector < RVector3 > points(readPositions__(reader));
+
+    uint64 nData = reader.read< uint64 >();
+    uint64 nFields = reader.read< uint64 >();
+    std::map< std::string, RVector > dataMap;
+    std::vector < std::string > sensorIdx;
+    for (Index i = 0; i < nFields; i ++){
+        std::string token(readString__(reader));
+        if (reader.read< uint8 >()) sensorIdx.push_back(token);
+        RVector & v = dataMap[token];
+        v.resize(nData);
+        const char * p = reader.section< double >(nData);
+        if (nData > 0) std::memcpy(&v[0], p, nData * sizeof(double));
+    }
+
+    std::map< std::string, std::string > descriptions;
+    uint64 nDesc = reader.read< uint64 >();
+    for (Index i = 0; i < nDesc; i ++){
+        std::string token(readString__(reader));
+        descriptions[token] = readString__(reader);
+    }
+    std::string inputFormat(readString__(reader));
+    std::string inputFormatSensors(readString__(reader));
+    bool fromOne = reader.read< uint8 >() != 0;
+
+    //** the file is complete, replace the content
+    sensorPoints_ = sensors;
+    topoPoints_ = points;
+    dataMap_.swap(dataMap);
+    dataSensorIdx_.insert(sensorIdx.begin(), sensorIdx.end());
+    dataDescription_.swap(descriptions);
+    inputFormatString_ = inputFormat;
+    inputFormatStringSensors_ = inputFormatSensors;
+    sensorIndexOnFileFromOne_ = fromOne;
+}
+
 std::string DataContainer::tokenList(bool withAnnotation) const {
     std::string tokenList;
     if (withAnnotation) tokenList += "SensorIdx: ";
@@ -30,6 +30,8 @@
 
 namespace GIMLI{
 
+class MappedFile;
+
 //! DataContainer to store, load and save data in the GIMLi unified data format.
 /*! DataContainer to store, load and save data in the GIMLi unified data format.
  The DataContainer contains a data map that holds the data itself. Each map entry can be identified by tokens.
@@ -226,11 +228,25 @@ public:
 
     /*! Loads the data from a file. See save for details on the fileformat.
      On default remove all invalid data that have been marked by checkDataValidity
-     and checkDataValidityLocal.*/
+     and checkDataValidityLocal.
+     The file is memory mapped and the data block is parsed with several
+     threads for large files. Files written by \ref saveBinary are
+     recognized and loaded with \ref loadBinary.*/
     virtual int load(const std::string & fileName,
                      bool sensorIndicesFromOne=true,
                      bool removeInvalid=true);
 
+    /*! Save the complete container in a binary file: sensors, additional
+     * points, all data fields including invalid data, the sensor index
+     * registrations, descriptions and input format strings. The values
+     * are stored bitwise, so \ref loadBinary restores the container
+     * without loss. */
+    int saveBinary(const std::string & fileName) const;
+
+    /*! Replace the content with a file written by \ref saveBinary.
+     * No validity check is done. */
+    int loadBinary(const std::string & fileName);
+
     /*! Save the data to a file. Saves only valid data(except formatData == "all"). File format is\n\n
      * Number of Sensors\n
      * #Sensor tokens\n
@@ -362,6 +378,8 @@ public:
 protected:
     virtual void copy_(const DataContainer & data);
 
+    void loadBinary_(const MappedFile & file);
+
     std::string inputFormatStringSensors_;
 
     std::string inputFormatString_;
@@ -44,16 +44,20 @@ public:
     virtual ~MT1dModelling() { }
 
     /*! different sub-forward operators for alternate use */
-    virtual RVector rhoaphi(const RVector & rho, const RVector & thk); //! app. res. and phase
+    virtual RVector rhoaphi(const RVector & rho, const RVector & thk) const; //! app. res. and phase
 
-    virtual RVector rhoa(const RVector & rho, const RVector & thk);    //! only app. res.
+    virtual RVector rhoa(const RVector & rho, const RVector & thk) const;    //! only app. res.
 
     virtual RVector rhoa(const RVector & model);
     //! app. res. for thk/res vector
 
 
     /*! the actual (full) forward operator returning app.res.+phase for thickness+resistivity */
-    virtual RVector response(const RVector & model);
+    virtual RVector response(const RVector & model){ return response_mt(model); }
+
+    /*! Read only variant of \ref response, used for the multi threaded
+     * brute force Jacobian. */
+    virtual RVector response_mt(const RVector & model, Index i=0) const;
 
 protected:
     RVector periods_;
@@ -78,6 +82,10 @@ public:
 
     virtual RVector response(const RVector & rho) { return rhoaphi(rho, thk_); }
 
+    virtual RVector response_mt(const RVector & rho, Index i=0) const {
+        return rhoaphi(rho, thk_);
+    }
+
     virtual RVector rhoa(const RVector & rho) { return MT1dModelling::rhoa(rho, thk_); }
 
 protected:
@@ -101,14 +109,18 @@ public:
 
     void init();
 
-    virtual RVector response(const RVector & model);
+    virtual RVector response(const RVector & model){ return response_mt(model); }
+
+    /*! Read only variant of \ref response, used for the multi threaded
+     * brute force Jacobian. */
+    virtual RVector response_mt(const RVector & model, Index i=0) const;
 
     /*! Return reference to the freeAirSolution.
      * This will be automatic filled by and init() call during
      * instance construction. */
     const RVector & freeAirSolution() const { return freeAirSolution_; }
 
-    RVector calc(const RVector & rho, const RVector & thk);
+    RVector calc(const RVector & rho, const RVector & thk) const;
 
 
 protected:
@@ -143,6 +155,10 @@ public:
 
     RVector response(const RVector & model){ return calc(model, thk_); }
 
+    virtual RVector response_mt(const RVector & model, Index i=0) const {
+        return calc(model, thk_);
+    }
+
 protected:
     RVector thk_;
 };
@@ -162,7 +178,10 @@ public:
     virtual ~MRSModelling() { }
 
     /*! return response voltage for a given water content vector */
-    RVector response(const RVector & model);
+    RVector response(const RVector & model){ return response_mt(model); }
+
+    /*! Read only variant of \ref response. */
+    virtual RVector response_mt(const RVector & model, Index i=0) const;
 
     /*! create jacobian matrix (AmplitudeJacobian) */
     void createJacobian(const RVector & model);
@@ -191,6 +210,15 @@ public:
     /*! return voltage for a given block model vector */
     RVector response(const RVector & model);
 
+    /*! Read only variant of \ref response, used for the multi threaded
+     * brute force Jacobian. */
+    virtual RVector response_mt(const RVector & model, Index i=0) const {
+        return MRSModelling::response_mt(waterContent(model));
+    }
+
+    /*! Return the water content of the block model on the depths zvec. */
+    RVector waterContent(const RVector & model) const;
+
     /*! use default (brute-force) jacobian generator (override the smooth one) */
     void createJacobian(const RVector & model){
         ModellingBase::createJacobian(model);
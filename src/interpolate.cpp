@@ -20,6 +20,7 @@
 
 #include "meshentities.h"
 #include "mesh.h"
+#include "meshView.h"
 #include "node.h"
 #include "shape.h"
 
@@ -45,22 +46,7 @@ void interpolate(const Mesh & mesh, const RMatrix & vData,
         iData.resize(vData.rows(), pos.size());
     }
 
-    std::vector < Cell * > cells(pos.size());
-    size_t count = 0;
-
-    Cell * c = 0;
-    for (uint i = 0; i < pos.size(); i ++) {
-//         __MS(pos[i])
-        c = mesh.findCell(pos[i], count, false);
-//         if (!c) {
-//             __MS(pos[i])
-// //             c = mesh.findCell(pos[i], count, true);
-// //             if (!c) exit(0);
-//         }
-        cells[i] = c;
-//         if (verbose) std::cout << "\r" << i + 1 << " \t/ " << pos.size()
-//                                << "\t searched: " << count << std::endl;
-    }
+    std::vector < Cell * > cells(mesh.findCells(pos));
     if (verbose) std::cout << std::endl;
 
     for (uint i = 0; i < vData.rows(); i ++) {
@@ -259,13 +245,14 @@ RVector cellDataToPointData(const Mesh & mesh, const RVector & cellData){
 
     RVector ret(mesh.nodeCount());
 
-    std::set < Cell * > cset;
-    for (uint i = 0; i < mesh.nodeCount(); i ++){
-        cset = mesh.node(i).cellSet();
-        for (std::set < Cell * >::iterator it = cset.begin(); it != cset.end(); it ++){
-            ret[i] += cellData[(*it)->id()];
+    const MeshView & view = mesh.view();
+    for (Index i = 0; i < view.nodeCount(); i ++){
+        const Index * cells = view.nodeCells(i);
+        Index nCells = view.nodeCellCount(i);
+        for (Index j = 0; j < nCells; j ++){
+            ret[i] += cellData[cells[j]];
         }
-        ret[i] /= cset.size();
+        ret[i] /= nCells;
     }
 
     return ret;
@@ -166,6 +166,7 @@ protected:
         isRobust_           = false;
         isBlocky_           = false;
         useLinesearch_      = true;
+        lineSearchArmijo_   = false;
         optimizeLambda_     = false;
         recalcJacobian_     = true;
         jacobiNeedRecalc_   = true;
@@ -186,6 +187,10 @@ protected:
         lambdaMin_          = 1.0;
         dPhiAbortPercent_   = 2.0;
 
+        armijoFactor_       = 1e-4;
+        lineSearchMaxSteps_ = 5;
+        broydenRecalcInterval_ = 0;
+        broydenUpdates_     = 0;
         CGLStol_            = -1.0; //** -1 means automatic scaled
     }
 
@@ -332,6 +337,20 @@ public:
     inline void setLineSearch(bool linesearch) { useLinesearch_ = linesearch; }
     inline bool lineSearch() const { return useLinesearch_; }
 
+    /*! Set and get Armijo backtracking for the line search. Instead of
+     * interpolating the responses, the full step is reduced until the
+     * objective function of the forward response decreases by at least
+     * armijoFactor (default 1e-4) times the predicted decrease. Takes at
+     * most maxSteps (default 5) extra forward calls, none if the full step
+     * is accepted. */
+    inline void setLineSearchArmijo(bool armijo, double armijoFactor=1e-4,
+                                    Index maxSteps=5) {
+        lineSearchArmijo_ = armijo;
+        armijoFactor_ = armijoFactor;
+        lineSearchMaxSteps_ = maxSteps;
+    }
+    inline bool lineSearchArmijo() const { return lineSearchArmijo_; }
+
     /*! Set and get blocky model behaviour (by L1 reweighting of constraints) */
     inline void setBlockyModel(bool isBlocky) { isBlocky_ = isBlocky; }
     inline bool blockyModel() const { return isBlocky_; }
@@ -466,23 +485,28 @@ public:
     }
     bool recalcJacobian() const { return recalcJacobian_; }
 
-    /*! Enable/disable broyden update (which enforces scaling by transform function derivatives */
+    /*! Enable/disable Broyden update. Instead of recalculating the Jacobian
+     * in every iteration, it is corrected by a rank-1 update with the model
+     * and response change of the last step. Works for dense Jacobians and
+     * sparse map Jacobians, for the latter only the existing entries are
+     * updated. See \ref setBroydenRecalcInterval. */
     void setBroydenUpdate(bool broydenUpdate){
         doBroydenUpdate_ = broydenUpdate;
         if (doBroydenUpdate_) recalcJacobian_ = false;
-        //** puts transformation functions into jacobian since it is not changed anymore;
-        if (broydenUpdate) {
-            THROW_TO_IMPL
-            //scaleMatrix(*J_, tD_->deriv(response_), Vec(1.0 / tM_->deriv(model_)));
-        }
     }
     inline bool broydenUpdate() const { return doBroydenUpdate_; }
 
+    /*! Set and get the number of Broyden updates after which the Jacobian
+     * is recalculated, 0 (default) means never. It is recalculated too if a
+     * step with an updated Jacobian increased the data misfit. */
+    inline void setBroydenRecalcInterval(Index n) { broydenRecalcInterval_ = n; }
+    inline Index broydenRecalcInterval() const { return broydenRecalcInterval_; }
+
     /*! Set model vector .
      * If you call \ref run() the inversion starts with this model,
      * otherwise it will start with fop.startModel(). */
     void setModel(const Vec & model){
-        if (recalcJacobian_ && model != model_) jacobiNeedRecalc_ = true;
+        if ((recalcJacobian_ || doBroydenUpdate_) && model != model_) jacobiNeedRecalc_ = true;
         model_ = model;
     }  //why is there no size check???
 
@@ -697,32 +721,34 @@ public:
     /*! Return last relative RMS misfit */
     inline double relrms() const { return rrms(data_, response_) * 100.; }
 
-    /*! Start with linear interpolation, followed by quadratic fit if linesearch parameter tau is lower than 0.03. Tries to return values between 0.03 and 1 */
+    /*! Start with linear interpolation, followed by quadratic fit if linesearch parameter tau is lower than 0.03. Tries to return values between 0.03 and 1.
+     * Models and responses are interpolated linearly in transformed space,
+     * so both terms of the objective function are quadratic in tau and the
+     * 101 step lengths are evaluated from their coefficients. */
     double linesearch(const Vec & modelNew, const Vec & responseNew) const {
-        Vec phiVector(101, getPhi());
-        Vec phiDVector(101 , getPhiD());
-
         Vec dModel(tM_->trans(modelNew)    - tM_->trans(model_));
         Vec dData( tD_->trans(responseNew) - tD_->trans(response_));
 
-        double tau = 0.0, minTau = 0.0;
-        double minPhi = phiVector[ 0 ];
+        double d0 = 0.0, d1 = 0.0, d2 = 0.0;
+        double m0 = 0.0, m1 = 0.0, m2 = 0.0;
+        dataTermCoefficients_(dData, d0, d1, d2);
+        //** local regularization does not contribute to the objective function
+        if (!localRegularization_) modelTermCoefficients_(dModel, m0, m1, m2);
 
-        if (localRegularization_) minPhi = phiDVector[ 0 ];
+        Vec phiVector(101);
+        Vec phiDVector(101);
+        double tau = 0.0, minTau = 0.0;
+        for (int i = 0; i < 101; i++) {
+            tau = 0.01 * (double) i;
+            phiDVector[ i ] = d0 + tau * (d1 + tau * d2);
+            phiVector[ i ]  = phiDVector[ i ] + lambda_ * (m0 + tau * (m1 + tau * m2));
+        }
 
-        double thisPhi = minPhi;
+        double minPhi = phiVector[ 0 ];
         for (int i = 1; i < 101; i++) {
-            tau = 0.01 * (double) i;
-            Vec appModel (tM_->update(model_, dModel * tau));
-            Vec appResponse (tD_->update(response_, dData * tau));
-            phiVector[ i ]  = getPhi(appModel, appResponse);
-            phiDVector[ i ] = getPhiD(appResponse);
-            thisPhi = phiVector[ i ]; //! rigorous minimization of the total objective function
-            //** this could also be controlled by another switch (which is enforced by local reg.)
-            if (localRegularization_) thisPhi = phiDVector[ i ];
-            if (thisPhi < minPhi){
-                minPhi = thisPhi;
-                minTau = tau;
+            if (phiVector[ i ] < minPhi){
+                minPhi = phiVector[ i ];
+                minTau = 0.01 * (double) i;
             }
         }
         DOSAVE save(phiVector,  "linesearchPhi");
@@ -776,6 +802,45 @@ public:
         return tauopt;
     }
 
+    /*! Backtracking line search on the forward responses. Starting with
+     * the full step, whose response is given in response, tau is reduced
+     * by quadratic interpolation until the objective function decreases
+     * sufficiently (Armijo condition) with the slope of the linearised
+     * problem at tau = 0. Every reduction costs one forward call, the
+     * response of the returned step length is left in response. */
+    double linesearchArmijo(const Vec & dModel, Vec & response) const {
+        Vec dDataLin(tD_->deriv(response_) *
+                     forward_->jacobian()->mult(Vec(dModel / tM_->deriv(model_))));
+
+        double d0 = 0.0, d1 = 0.0, d2 = 0.0;
+        double m0 = 0.0, m1 = 0.0, m2 = 0.0;
+        dataTermCoefficients_(dDataLin, d0, d1, d2);
+        if (!localRegularization_) modelTermCoefficients_(dModel, m0, m1, m2);
+
+        double phi0  = d0 + lambda_ * m0;
+        //** an inexact inverse sub step may not descend, then any decrease does
+        double slope = std::min(0.0, d1 + lambda_ * m1);
+
+        double tau = 1.0;
+        double phi = getPhiD(response) + lambda_ * (m0 + m1 + m2);
+        for (Index i = 0; i < lineSearchMaxSteps_ &&
+                          phi > phi0 + armijoFactor_ * tau * slope; i ++){
+            //** minimum of the parabola through phi0, slope and phi(tau)
+            double curv = phi - phi0 - slope * tau;
+            double tauNew = 0.5 * tau;
+            if (curv > TOLERANCE) tauNew = -slope * tau * tau / (2.0 * curv);
+            tau = std::max(0.1 * tau, std::min(0.5 * tau, tauNew));
+
+            response = forward_->response(tM_->update(model_, dModel * tau));
+            phi = getPhiD(response) + lambda_ * (m0 + tau * (m1 + tau * m2));
+            if (verbose_) std::cout << "Armijo tau = " << tau << " phi = " << phi
+                                    << " (" << phi0 << ")" << std::endl;
+        }
+
+        if (verbose_) std::cout << "Linesearch tau = " << tau << std::endl;
+        return tau;
+    }
+
     /*! Return the single models for each iteration. For debugging.*/
     inline const std::vector < RVector > & modelHistory() const { return modelHist_; }
 
@@ -854,6 +919,57 @@ public:
     }
 
 protected:
+    /*! Coefficients of the data term |W (d - f(tau))|^2 = c0 + c1 tau + c2 tau^2
+     * for the transformed response f(tau) = tD(response) + tau dData. */
+    void dataTermCoefficients_(const Vec & dData,
+                               double & c0, double & c1, double & c2) const {
+        Vec err(tD_->error(fixZero(data_, TOLERANCE), error_));
+        Vec d((tD_->trans(data_) - tD_->trans(response_)) / err);
+        Vec e(dData / err);
+        c0 = dot(d, d);
+        c1 = -2.0 * dot(d, e);
+        c2 = dot(e, e);
+        if (isnan(c0 + c1 + c2) || isinf(c0 + c1 + c2)){
+            throwError(1, WHERE_AM_I + " phiD == " + str(c0) + " " + str(c1) + " " + str(c2));
+        }
+    }
+
+    /*! Coefficients of the model term |r(tau)|^2 = c0 + c1 tau + c2 tau^2 for
+     * the model tM^-1(tM(model) + tau dModel). The roughness is linear in
+     * the transformed model, so only two constraint products are needed. */
+    void modelTermCoefficients_(const Vec & dModel,
+                                double & c0, double & c1, double & c2) const {
+        Vec a(this->roughness());
+        if (haveReferenceModel_) a = a - constraintsH_;
+        Vec b(*forward_->constraints() * Vec(dModel * modelWeight_) * constraintsWeight_);
+        c0 = dot(a, a);
+        c1 = 2.0 * dot(a, b);
+        c2 = dot(b, b);
+        if (isnan(c0 + c1 + c2) || isinf(c0 + c1 + c2)){
+            throwError(1, WHERE_AM_I + " phiM == " + str(c0) + " " + str(c1) + " " + str(c2));
+        }
+    }
+
+    /*! Broyden rank-1 update J -> J + (dResponse - J dModel) dModel^T / |dModel|^2
+     * of the Jacobian, so that it maps the last model change to the last
+     * response change. */
+    void broydenUpdate_(const Vec & dModel, const Vec & dResponse){
+        double dm2 = dot(dModel, dModel);
+        if (dm2 <= 0.0) return;
+
+        MatrixBase * J = forward_->jacobian();
+        Vec u(dResponse - J->mult(dModel));
+        Vec v(dModel / dm2);
+
+        if (RMatrix * D = dynamic_cast< RMatrix * >(J)){
+            rank1Update(*D, u, v);
+        } else if (RSparseMapMatrix * S = dynamic_cast< RSparseMapMatrix * >(J)){
+            rank1Update(*S, u, v);
+        } else {
+            throwError(1, WHERE_AM_I + " no rank-1 update for this Jacobian type: "
+                       + str(J->rtti()));
+        }
+    }
 
     Vec                   data_;
     ModellingBase       * forward_;
@@ -890,11 +1006,17 @@ protected:
     double lambdaMin_;
     double dPhiAbortPercent_;
     double CGLStol_;
+    double armijoFactor_;
+    Index lineSearchMaxSteps_;
+    Index broydenRecalcInterval_;
+    //** Broyden updates since the last recalculation of the Jacobian
+    Index broydenUpdates_;
 
     bool isBlocky_;
     bool isRobust_;
     bool isRunning_;
     bool useLinesearch_;
+    bool lineSearchArmijo_;
     bool optimizeLambda_;
     bool abort_;
     bool stopAtChi1_;
@@ -996,6 +1118,8 @@ const Vector < ModelValType > & Inversion< ModelValType >::run(){ ALLOW_PYTHON_T
 
     //! validate and rebuild the jacobian if necessary
     this->checkJacobian(jacobiNeedRecalc_);
+    jacobiNeedRecalc_ = false;
+    broydenUpdates_ = 0;
 
     //** End preparation
 
@@ -1095,11 +1219,16 @@ template < class Vec > bool Inversion< Vec>::oneStep() {
     Vec responseNew( data_.size());
     Vec roughness(constraintsH_.size(), 0.0);
 
+    if (doBroydenUpdate_ && broydenRecalcInterval_ > 0 &&
+        broydenUpdates_ >= broydenRecalcInterval_) jacobiNeedRecalc_ = true;
+
     if ((recalcJacobian_ && iter_ > 1) || jacobiNeedRecalc_ ) {
         Stopwatch swatch(true);
         if (verbose_) std::cout << "recalculating jacobian matrix ...";
         forward_->createJacobian(model_);
         if (verbose_) std::cout << swatch.duration(true) << " s" << std::endl;
+        jacobiNeedRecalc_ = false;
+        broydenUpdates_ = 0;
     }
 
     if (!localRegularization_) {
@@ -1139,32 +1268,26 @@ template < class Vec > bool Inversion< Vec>::oneStep() {
         DOSAVE save(tM_->deriv(model_), "modelTrans");
         DOSAVE save(tD_->deriv(response_), "responseTrans");
 
-        if (doBroydenUpdate_) { //!!! h-variante
-           if (verbose_) std::cout << "solve CGLSCDWW with lambda = " << lambda_ << std::endl;
-                THROW_TO_IMPL
-//                solveCGLSCDWW(*J_, forward_->constraints(), dataWeight_, deltaDataIter_, deltaModelIter_, constraintsWeight_,
-//                                modelWeight_, lambda_, deltaModel0, maxCGLSIter_, dosave_);
-        } else {
-            if (verbose_) std::cout << "solve CGLSCDWWtrans with lambda = " << lambda_ << std::endl;
-//             solveCGLSCDWWtrans(*J_, forward_->constraints(), dataWeight_, deltaDataIter_, deltaModelIter_, constraintsWeight_,
-//                                  modelWeight_, tM_->deriv(model_), tD_->deriv(response_),
-//                                lambda_, deltaModel0, maxCGLSIter_, verbose_);
-
-            //save(forward_->jacobian(), "S"+ toStr(iter_) + ".mat", Ascii);
-
-            // wannebee
-//             DoubleWeightedMatrix scaledJacobian (forward_->jacobian(), tM_->deriv(model_), tD_->deriv(response_));
-//             DoubleWeightedMatrix weightedConstraints(forward_->constraints(), constraintsWeight_, modelWeight_);
-//             solveCGLSCDWWhtransWB(scaledJacobian, weightedConstraints, dataWeight_, deltaDataIter_, deltaModelIter_,
-//                                    lambda_, roughness, maxCGLSIter_, verbose_);
-
-            solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
-                                dataWeight_, deltaDataIter_, deltaModelIter_,
-                                constraintsWeight_, modelWeight_,
-                                tM_->deriv(model_), tD_->deriv(response_),
-                                lambda_, roughness, maxCGLSIter_, CGLStol_,
-                                dosave_);
-        } // else no broyden
+        //** a Broyden updated Jacobian stays unscaled like a recalculated one
+        if (verbose_) std::cout << "solve CGLSCDWWtrans with lambda = " << lambda_ << std::endl;
+//         solveCGLSCDWWtrans(*J_, forward_->constraints(), dataWeight_, deltaDataIter_, deltaModelIter_, constraintsWeight_,
+//                              modelWeight_, tM_->deriv(model_), tD_->deriv(response_),
+//                            lambda_, deltaModel0, maxCGLSIter_, verbose_);
+
+        //save(forward_->jacobian(), "S"+ toStr(iter_) + ".mat", Ascii);
+
+        // wannebee
+//         DoubleWeightedMatrix scaledJacobian (forward_->jacobian(), tM_->deriv(model_), tD_->deriv(response_));
+//         DoubleWeightedMatrix weightedConstraints(forward_->constraints(), constraintsWeight_, modelWeight_);
+//         solveCGLSCDWWhtransWB(scaledJacobian, weightedConstraints, dataWeight_, deltaDataIter_, deltaModelIter_,
+//                                lambda_, roughness, maxCGLSIter_, verbose_);
+
+        solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
+                            dataWeight_, deltaDataIter_, deltaModelIter_,
+                            constraintsWeight_, modelWeight_,
+                            tM_->deriv(model_), tD_->deriv(response_),
+                            lambda_, roughness, maxCGLSIter_, CGLStol_,
+                            dosave_);
     } // else no optimization
 
     DOSAVE echoMinMax(deltaModelIter_, "dm");
@@ -1184,17 +1307,25 @@ template < class Vec > bool Inversion< Vec>::oneStep() {
     responseNew = forward_->response(modelNew);
 
     double tau = 1.0;
-    if (useLinesearch_){
-        tau = linesearch(modelNew, responseNew);
-    }
-
-    if (tau >= 0.95){ //! full step possible;
+    if (useLinesearch_ && lineSearchArmijo_){
+        //** responseNew holds the response of the accepted step afterwards
+        tau = linesearchArmijo(deltaModelIter_, responseNew);
+        if (tau < 1.0) modelNew = tM_->update(model_, deltaModelIter_ * tau);
         response_ = responseNew;
-    } else { //! normal line search parameter between 0.03 and 0.94
-        modelNew = tM_->update(model_, deltaModelIter_ * tau);
-        response_ = forward_->response(modelNew);
+    } else {
+        if (useLinesearch_){
+            tau = linesearch(modelNew, responseNew);
+        }
+
+        if (tau >= 0.95){ //! full step possible;
+            response_ = responseNew;
+        } else { //! normal line search parameter between 0.03 and 0.94
+            modelNew = tM_->update(model_, deltaModelIter_ * tau);
+            response_ = forward_->response(modelNew);
+        }
     }
 
+    Vec modelLast(model_);
     model_ = modelNew;
     if (saveModelHistory_) save(model_, "model_" + toStr(iter_) PLUS_TMP_VECSUFFIX);
 
@@ -1202,13 +1333,16 @@ template < class Vec > bool Inversion< Vec>::oneStep() {
 
     ipc_.setDouble("Chi2", getPhiD() / data_.size());
 
-    if (doBroydenUpdate_) { //** perform Broyden update;
-    // did not yet reflect moving jacobian into modellingbase
-    THROW_TO_IMPL
-//         if (verbose_) std::cout << "perform Broyden update" << std::endl;
-//         Vec u(tD_->trans(response_) - tD_->trans(responseLast) - (*J_ * deltaModelIter_));
-//         Vec v(deltaModelIter_ / dot(deltaModelIter_, deltaModelIter_));
-//         rank1Update(*J_, u, v);
+    if (doBroydenUpdate_) {
+        if (broydenUpdates_ > 0 && getPhiD() > getPhiD(responseLast)){
+            //** the updated Jacobian led astray, start over with a new one
+            if (verbose_) std::cout << "data misfit increased, recalculate jacobian" << std::endl;
+            jacobiNeedRecalc_ = true;
+        } else {
+            if (verbose_) std::cout << "perform Broyden update" << std::endl;
+            broydenUpdate_(Vec(model_ - modelLast), Vec(response_ - responseLast));
+            broydenUpdates_ ++;
+        }
     }
 
     //!** temporary stuff
@@ -20,6 +20,7 @@
 #include "sparsematrix.h"
 #include "ldlWrapper.h"
 #include "cholmodWrapper.h"
+#include "pcgWrapper.h"
 
 namespace GIMLI{
 
@@ -70,7 +71,10 @@ void LinSolver::init_(){
     rows_ = 0;
     cols_ = 0;
     solver_ = 0;
+    solverType_ = UNKNOWN;
     cacheMatrix_ = 0;
+    patternStype_ = -2;
+    patternComplex_ = false;
 }
 
 LinSolver::~LinSolver(){
@@ -85,9 +89,10 @@ LinSolver::~LinSolver(){
 }
 
 void LinSolver::setSolverType(SolverType solverType){
-   solverType_ = solverType;
-   if (solverType_ == AUTOMATIC){
-        solverType_ = UNKNOWN;
+    SolverType lastType = solverType_;
+    solverType_ = solverType;
+    if (solverType_ == AUTOMATIC){
+        solverType_ = PCG;
 
         if (LDLWrapper::valid()){
             solverType_ = LDL;
@@ -96,6 +101,11 @@ void LinSolver::setSolverType(SolverType solverType){
             solverType_ = CHOLMOD;
         }
     }
+    //** a new backend needs a new analysis of the next matrix
+    if (solver_ && solverType_ != lastType){
+        delete solver_;
+        solver_ = 0;
+    }
 }
 
 void LinSolver::setMatrix(RSparseMatrix & S, int stype){
@@ -106,6 +116,39 @@ void LinSolver::setMatrix(CSparseMatrix & S, int stype){
     initialize_(S, stype);
 }
 
+template < class ValueType >
+bool LinSolver::samePattern_(const SparseMatrix < ValueType > & S, int stype,
+                             bool isComplex) const {
+    if (stype == -2) stype = S.stype();
+    if (!solver_ || patternStype_ != stype || patternComplex_ != isComplex) {
+        return false;
+    }
+    return (S.vecColPtr() == patternColPtr_ && S.vecRowIdx() == patternRowIdx_);
+}
+
+template < class ValueType >
+void LinSolver::storePattern_(const SparseMatrix < ValueType > & S, int stype,
+                              bool isComplex){
+    patternColPtr_ = S.vecColPtr();
+    patternRowIdx_ = S.vecRowIdx();
+    patternStype_ = stype == -2 ? S.stype() : stype;
+    patternComplex_ = isComplex;
+}
+
+void LinSolver::refactorise(RSparseMatrix & S, int stype){
+    if (samePattern_(S, stype, false) && solver_->refactorise(S)){
+        return;
+    }
+    setMatrix(S, stype);
+}
+
+void LinSolver::refactorise(CSparseMatrix & S, int stype){
+    if (samePattern_(S, stype, true) && solver_->refactorise(S)){
+        return;
+    }
+    setMatrix(S, stype);
+}
+
 // template <> void LinSolver::solve(const RVector & rhs, RVector & solution);
 // template <> void LinSolver::solve(const CVector & rhs, CVector & solution);
 // template <> RVector LinSolver::solve(const RVector & rhs);
@@ -139,14 +182,37 @@ CVector LinSolver::solve(const CVector & rhs){
     return solution;
 }
 
+void LinSolver::solve(const RMatrix & rhs, RMatrix & solution){
+    solution.resize(rhs.rows(), rows_);
+    if (rhs.rows() && rhs.cols() != cols_){
+        std::cerr << WHERE_AM_I << " rhs size mismatch: " << cols_ << "  " << rhs.cols() << std::endl;
+    }
+    if (solver_) solver_->solve(rhs, solution);
+}
+
+void LinSolver::solve(const CMatrix & rhs, CMatrix & solution){
+    solution.resize(rhs.rows(), rows_);
+    if (rhs.rows() && rhs.cols() != cols_){
+        std::cerr << WHERE_AM_I << " rhs size mismatch: " << cols_ << "  " << rhs.cols() << std::endl;
+    }
+    if (solver_) solver_->solve(rhs, solution);
+}
+
 void LinSolver::initialize_(RSparseMatrix & S, int stype){
     rows_ = S.rows();
     cols_ = S.cols();
     setSolverType(solverType_);
 
+    if (solver_) {
+        delete solver_;
+        solver_ = 0;
+    }
+    storePattern_(S, stype, false);
+
     switch(solverType_){
         case LDL:     solver_ = new LDLWrapper(S, verbose_); break;
         case CHOLMOD: solver_ = new CHOLMODWrapper(S, verbose_, stype); break;
+        case PCG:     solver_ = new PCGWrapper(S, verbose_); break;
         case UNKNOWN:
     default:
             std::cerr << WHERE_AM_I << " no valid solver found"  << std::endl;
@@ -158,9 +224,16 @@ void LinSolver::initialize_(CSparseMatrix & S, int stype){
     cols_ = S.cols();
     setSolverType(solverType_);
 
+    if (solver_) {
+        delete solver_;
+        solver_ = 0;
+    }
+    storePattern_(S, stype, true);
+
     switch(solverType_){
         case LDL:     solver_ = new LDLWrapper(S, verbose_); break;
         case CHOLMOD: solver_ = new CHOLMODWrapper(S, verbose_, stype); break;
+        case PCG:     solver_ = new PCGWrapper(S, verbose_); break;
         case UNKNOWN:
     default:
             std::cerr << WHERE_AM_I << " no valid solver found"  << std::endl;
@@ -172,10 +245,23 @@ std::string LinSolver::solverName() const {
   switch(solverType_){
   case LDL:     return "LDL"; break;
   case CHOLMOD: return "CHOLMOD"; break;
+  case PCG:     return "PCG"; break;
   case UNKNOWN:
   default: return " no valid solver installed";
   }
 }
 
+double predictFactorMemory(Index nUnknowns, Index dim, bool isComplex){
+    if (nUnknowns < 2) return 0.0;
+    double n = double(nUnknowns);
+    double nnz = 0.0;
+    if (dim < 3){
+        nnz = 8.0 * n * std::log(n) / std::log(2.0);
+    } else {
+        nnz = 10.0 * std::pow(n, 4.0 / 3.0);
+    }
+    return nnz * (isComplex ? 20.0 : 12.0) / (1024.0 * 1024.0);
+}
+
 } // namespace GIMLI
 
@@ -26,7 +26,7 @@ namespace GIMLI{
 
 class SolverWrapper;
 
-enum SolverType{AUTOMATIC,LDL,CHOLMOD,UNKNOWN};
+enum SolverType{AUTOMATIC,LDL,CHOLMOD,PCG,UNKNOWN};
 
 class DLLEXPORT LinSolver{
 public:
@@ -49,6 +49,17 @@ public:
     RVector solve(const RVector & rhs);
     CVector solve(const CVector & rhs);
 
+    /*! Solve for all right hand sides given as rows of rhs at once.
+     * Direct solvers use one blocked triangular solve for all of them. */
+    void solve(const RMatrix & rhs, RMatrix & solution);
+
+    /*! Solve for all right hand sides given as rows of rhs at once.
+     * Direct solvers use one blocked triangular solve for all of them. */
+    void solve(const CMatrix & rhs, CMatrix & solution);
+
+    /*! Set the solver backend. AUTOMATIC takes the best installed direct
+     * solver and falls back to the iterative PCG without any. A change
+     * takes effect with the next \ref setMatrix or \ref refactorise. */
     void setSolverType(SolverType solverType = AUTOMATIC);
 
     /*! Forwarded to the wrapper to overwrite settings within S. stype =-2 -> use S.stype()*/
@@ -57,6 +68,18 @@ public:
     /*! Verbose level = -1, use Linsolver.verbose(). */
     void setMatrix(CSparseMatrix & S, int stype=-2);
 
+    /*! Factorise S and reuse the symbolic analysis (ordering and fill-in
+     * pattern) of the last matrix if S shares its sparsity pattern, else
+     * fall back to \ref setMatrix. Use this for a sequence of matrices
+     * assembled on the same mesh. */
+    void refactorise(RSparseMatrix & S, int stype=-2);
+
+    /*! Factorise S and reuse the symbolic analysis (ordering and fill-in
+     * pattern) of the last matrix if S shares its sparsity pattern, else
+     * fall back to \ref setMatrix. Use this for a sequence of matrices
+     * assembled on the same mesh. */
+    void refactorise(CSparseMatrix & S, int stype=-2);
+
     SolverType solverType() const { return solverType_; }
 
     std::string solverName() const;
@@ -67,14 +90,36 @@ protected:
     void initialize_(RSparseMatrix & S, int stype);
     void initialize_(CSparseMatrix & S, int stype);
 
+    template < class ValueType >
+    bool samePattern_(const SparseMatrix < ValueType > & S, int stype,
+                      bool isComplex) const;
+
+    template < class ValueType >
+    void storePattern_(const SparseMatrix < ValueType > & S, int stype,
+                       bool isComplex);
+
     MatrixBase * cacheMatrix_;
     SolverType      solverType_;
     SolverWrapper * solver_;
     bool            verbose_;
     uint rows_;
     uint cols_;
+
+    //! sparsity pattern of the matrix the solver has been analysed for
+    std::vector < int > patternColPtr_;
+    std::vector < int > patternRowIdx_;
+    int patternStype_;
+    bool patternComplex_;
 };
 
+/*! Rough prediction of the memory in MByte for a sparse direct factor of
+ * the system matrix of a finite element mesh with nUnknowns nodes in dim
+ * dimensions. Assumes a nested dissection ordering, i.e., 8 n log2(n)
+ * factor entries in 2D and 10 n^(4/3) in 3D with 12 (real) or 20 (complex)
+ * byte for value and row index. */
+DLLEXPORT double predictFactorMemory(Index nUnknowns, Index dim,
+                                     bool isComplex=false);
+
 template < class Mat, class Vec > int solveLU(const Mat & A, Vec & x, const Vec & b){
 
 	//** from TETGEN
@@ -0,0 +1,112 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "mappedFile.h"
+
+#if defined(WINDOWS) || defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace GIMLI{
+
+#if defined(WINDOWS) || defined(_WIN32)
+
+MappedFile::MappedFile(const std::string & fileName)
+    : fileName_(fileName), data_(NULL), size_(0), file_(NULL), map_(NULL){
+
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": cannot open file");
+    }
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)){
+        CloseHandle(file);
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": cannot determine file size");
+    }
+    size_ = (Index)size.QuadPart;
+    if (size_ == 0) return;
+
+    HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!map){
+        CloseHandle(file);
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": cannot map file");
+    }
+    map_ = map;
+
+    data_ = (const char *)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (!data_){
+        CloseHandle(map);
+        CloseHandle(file);
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": cannot map file");
+    }
+}
+
+MappedFile::~MappedFile(){
+    if (data_) UnmapViewOfFile(data_);
+    if (map_) CloseHandle((HANDLE)map_);
+    if (file_) CloseHandle((HANDLE)file_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string & fileName)
+    : fileName_(fileName), data_(NULL), size_(0), file_(NULL), map_(NULL){
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0){
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0){
+        std::string err(strerror(errno));
+        close(fd);
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": " + err);
+    }
+    size_ = (Index)st.st_size;
+
+    if (size_ > 0){
+        void * p = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED){
+            std::string err(strerror(errno));
+            close(fd);
+            throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": " + err);
+        }
+        data_ = (const char *)p;
+        //** the whole file is read front to back
+        madvise(p, size_, MADV_SEQUENTIAL);
+    }
+    //** the mapping stays valid after closing the descriptor
+    close(fd);
+}
+
+MappedFile::~MappedFile(){
+    if (data_) munmap((void *)data_, size_);
+}
+
+#endif
+
+} // namespace GIMLI
@@ -0,0 +1,112 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_MAPPEDFILE__H
+#define _GIMLI_MAPPEDFILE__H
+
+#include "gimli.h"
+
+#include <cstring>
+
+namespace GIMLI{
+
+//! Read only memory mapped file.
+/*! Maps the whole file into memory, so it can be parsed in place without
+ * copying it through read buffers. The pages are loaded by the operating
+ * system on first access. Uses mmap on POSIX systems and file mappings on
+ * Windows. Throws if the file cannot be opened or mapped. */
+class DLLEXPORT MappedFile{
+public:
+    /*! Map the file fileName. */
+    MappedFile(const std::string & fileName);
+
+    /*! Unmap the file. */
+    ~MappedFile();
+
+    /*! Return the first byte of the file, NULL for empty files. */
+    inline const char * data() const { return data_; }
+
+    /*! Return the file size in byte. */
+    inline Index size() const { return size_; }
+
+    inline const std::string & fileName() const { return fileName_; }
+
+protected:
+    //** not copyable
+    MappedFile(const MappedFile &);
+    MappedFile & operator = (const MappedFile &);
+
+    std::string fileName_;
+    const char * data_;
+    Index size_;
+
+    //** native file and mapping handles (Windows only)
+    void * file_;
+    void * map_;
+};
+
+//! Sequential reader for the binary sections of a mapped file.
+/*! Returns values and pointers to arrays in the mapped memory and throws
+ * if a section exceeds the end of the file. Sections don't need to be
+ * aligned, use \ref at to read single values from them. */
+class DLLEXPORT MappedReader{
+public:
+    MappedReader(const MappedFile & file)
+        : file_(&file), pos_(0){
+    }
+
+    /*! Read the next value. */
+    template < class ValueType > ValueType read(){
+        ValueType v;
+        std::memcpy(&v, section< ValueType >(1), sizeof(ValueType));
+        return v;
+    }
+
+    /*! Return the start of the next count values and skip them. */
+    template < class ValueType > const char * section(Index count){
+        if (count > (file_->size() - pos_) / sizeof(ValueType)){
+            throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + file_->fileName() +
+                       ": unexpected end of file at byte " + str(pos_));
+        }
+        const char * p = file_->data() + pos_;
+        pos_ += count * sizeof(ValueType);
+        return p;
+    }
+
+    /*! Return the i-th value of the section starting at p. */
+    template < class ValueType >
+    static inline ValueType at(const char * p, Index i){
+        ValueType v;
+        std::memcpy(&v, p + i * sizeof(ValueType), sizeof(ValueType));
+        return v;
+    }
+
+    /*! Return the current position in byte. */
+    inline Index pos() const { return pos_; }
+
+    /*! Return true if the end of the file is reached. */
+    inline bool eof() const { return pos_ >= file_->size(); }
+
+protected:
+    const MappedFile * file_;
+    Index pos_;
+};
+
+} // namespace GIMLI
+
+#endif // _GIMLI_MAPPEDFILE__H
@@ -0,0 +1,110 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "matrix.h"
+
+#if OPENBLAS_FOUND
+    #if CONDA_BUILD
+        #include <cblas.h>
+    #else
+        #include <openblas/cblas.h>
+    #endif
+#endif
+
+namespace GIMLI{
+
+template < class ValueType >
+void denseMult_(const ValueType * A, Index rows, Index cols,
+                const ValueType * x, ValueType * y, bool trans){
+    if (trans){
+        for (Index j = 0; j < cols; j ++) y[j] = ValueType(0);
+        for (Index i = 0; i < rows; i ++){
+            const ValueType * a = A + i * cols;
+            ValueType xi = x[i];
+            for (Index j = 0; j < cols; j ++) y[j] += a[j] * xi;
+        }
+    } else {
+        for (Index i = 0; i < rows; i ++){
+            const ValueType * a = A + i * cols;
+            ValueType sum = ValueType(0);
+            for (Index j = 0; j < cols; j ++) sum += a[j] * x[j];
+            y[i] = sum;
+        }
+    }
+}
+
+template < class ValueType >
+void denseMatMult_(const ValueType * A, const ValueType * B, ValueType * C,
+                   Index m, Index n, Index k, bool transA){
+    for (Index i = 0; i < m * n; i ++) C[i] = ValueType(0);
+
+    //** i-l-j order to run over contiguous rows of B and C
+    for (Index i = 0; i < m; i ++){
+        ValueType * c = C + i * n;
+        for (Index l = 0; l < k; l ++){
+            ValueType a = transA ? A[l * m + i] : A[i * k + l];
+            if (a == ValueType(0)) continue;
+            const ValueType * b = B + l * n;
+            for (Index j = 0; j < n; j ++) c[j] += a * b[j];
+        }
+    }
+}
+
+void denseMult(const double * A, Index rows, Index cols,
+               const double * x, double * y, bool trans){
+#if OPENBLAS_FOUND
+    cblas_dgemv(CblasRowMajor, trans ? CblasTrans : CblasNoTrans,
+                rows, cols, 1.0, A, cols, x, 1, 0.0, y, 1);
+#else
+    denseMult_(A, rows, cols, x, y, trans);
+#endif
+}
+
+void denseMult(const Complex * A, Index rows, Index cols,
+               const Complex * x, Complex * y, bool trans){
+#if OPENBLAS_FOUND
+    Complex alpha(1.0, 0.0), beta(0.0, 0.0);
+    cblas_zgemv(CblasRowMajor, trans ? CblasTrans : CblasNoTrans,
+                rows, cols, &alpha, A, cols, x, 1, &beta, y, 1);
+#else
+    denseMult_(A, rows, cols, x, y, trans);
+#endif
+}
+
+void denseMatMult(const double * A, const double * B, double * C,
+                  Index m, Index n, Index k, bool transA){
+#if OPENBLAS_FOUND
+    cblas_dgemm(CblasRowMajor, transA ? CblasTrans : CblasNoTrans, CblasNoTrans,
+                m, n, k, 1.0, A, transA ? m : k, B, n, 0.0, C, n);
+#else
+    denseMatMult_(A, B, C, m, n, k, transA);
+#endif
+}
+
+void denseMatMult(const Complex * A, const Complex * B, Complex * C,
+                  Index m, Index n, Index k, bool transA){
+#if OPENBLAS_FOUND
+    Complex alpha(1.0, 0.0), beta(0.0, 0.0);
+    cblas_zgemm(CblasRowMajor, transA ? CblasTrans : CblasNoTrans, CblasNoTrans,
+                m, n, k, &alpha, A, transA ? m : k, B, n, &beta, C, n);
+#else
+    denseMatMult_(A, B, C, m, n, k, transA);
+#endif
+}
+
+} // namespace GIMLI
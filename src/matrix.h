@@ -313,8 +313,27 @@ protected:
     double val_;
 };
 
+/*! y = A * x or y = A^T * x (trans=true) for the dense row major block A
+ * of size rows x cols. Uses BLAS if available. */
+DLLEXPORT void denseMult(const double * A, Index rows, Index cols,
+                         const double * x, double * y, bool trans);
+
+DLLEXPORT void denseMult(const Complex * A, Index rows, Index cols,
+                         const Complex * x, Complex * y, bool trans);
+
+/*! C = op(A) * B for dense row major blocks, op(A) is m x k, B is k x n.
+ * A is of size m x k or k x m (transA=true). Uses BLAS if available. */
+DLLEXPORT void denseMatMult(const double * A, const double * B, double * C,
+                            Index m, Index n, Index k, bool transA);
+
+DLLEXPORT void denseMatMult(const Complex * A, const Complex * B, Complex * C,
+                            Index m, Index n, Index k, bool transA);
+
 //! Simple row-based dense matrix based on \ref Vector
-/*! Simple row-based dense matrix based on \ref Vector */
+/*! Simple row-based dense matrix based on \ref Vector.
+ * The rows share one contiguous row major memory block as long as they have
+ * equal length. A row that is resized to another length gets its own memory
+ * and mult/transMult fall back to row wise operations. */
 template < class ValueType > class DLLEXPORT Matrix : public MatrixBase {
 public:
     /*! Constructs an empty matrix with the dimension rows x cols. Content of the matrix is zero. */
@@ -334,7 +353,9 @@ public:
     /*! Copy constructor */
 
     Matrix(const std::vector < Vector< ValueType > > & mat)
-        : MatrixBase(){ copy_(mat); }
+        : MatrixBase(){
+        for (Index i = 0; i < mat.size(); i ++) push_back(mat[i]);
+    }
 
     /*! Constructor, read matrix from file see \ref load(Matrix < ValueType > & A, const std::string & filename). */
     Matrix(const std::string & filename)
@@ -407,11 +428,14 @@ public:
     virtual void resize(Index rows, Index cols){ allocate_(rows, cols); }
 
     /*! Clear the matrix and free memory. */
-    inline void clear() { mat_.clear(); }
+    inline void clear() {
+        mat_.clear();
+        std::vector < ValueType >().swap(storage_);
+    }
 
     /*! Fill Vector with 0.0. Don't change size.*/
     inline void clean() {
-        for (Index i = 0; i < mat_.size(); i ++) mat_[i].clear();
+        for (Index i = 0; i < mat_.size(); i ++) mat_[i].clean();
     }
 
     /*! Return number of rows. */
@@ -467,13 +491,43 @@ public:
     /*! Add another row vector add the end. */
     inline void push_back(const Vector < ValueType > & vec) {
         //**!!! length check necessary
-        mat_.push_back(vec);
+        if (!mat_.empty() && &vec >= &mat_.front() && &vec <= &mat_.back()){
+            //** vec is one of our rows and may move below
+            push_back(Vector < ValueType >(vec));
+            return;
+        }
+        if (mat_.empty() || (vec.size() == cols() && contiguous_())){
+            Index c = vec.size();
+            Index r = mat_.size();
+            const ValueType * oldStorage = storage_.data();
+            Index oldCapacity = mat_.capacity();
+
+            mat_.push_back(Vector < ValueType >());
+            storage_.resize((r + 1) * c);
+            if (c) std::copy(&vec[0], &vec[0] + c, &storage_[r * c]);
+
+            //** rows are only rebound if one of the containers moved
+            if (storage_.data() != oldStorage || mat_.capacity() != oldCapacity){
+                bindRows_(c);
+            } else {
+                mat_.back().bind_(&storage_[0] + r * c, c);
+            }
+        } else {
+            mat_.push_back(vec);
+        }
         rowFlag_.resize(rowFlag_.size() + 1);
     }
 
     /*! Return last row vector. */
     inline Vector< ValueType > & back() { return mat_.back(); }
 
+    /*! Return the row major values of all rows or NULL if the rows do not
+     * share one contiguous memory block. */
+    inline const ValueType * data() const {
+        if (rows() && cols() && contiguous_()) return &storage_[0];
+        return 0;
+    }
+
 //     /*! Set one specific column */
 //     virtual void setCol(Index col, const RVector & v){
 //         return setCol_(col, v);
@@ -522,6 +576,10 @@ public:
 
         //ValueType tmpval = 0;
         if (b.size() == cols){
+            if (rows && cols && contiguous_()){
+                denseMult(&storage_[0], rows, cols, &b[0], &ret[0], false);
+                return ret;
+            }
             for (Index i = 0; i < rows; ++i){
                 ret[i] = sum((*this)[i] * b);
             }
@@ -557,6 +615,10 @@ public:
         //ValueType tmpval = 0;
 
         if (b.size() == rows){
+            if (rows && cols && contiguous_()){
+                denseMult(&storage_[0], rows, cols, &b[0], &ret[0], true);
+                return ret;
+            }
             for(Index i = 0; i < rows; i++){
                 for(Index j = 0; j < cols; j++){
                     ret[j] +=  (*this)[i][j] * b[i];
@@ -568,6 +630,16 @@ public:
         return ret;
     }
 
+    /*! Return this * B. */
+    Matrix < ValueType > mult(const Matrix < ValueType > & B) const {
+        return matMult_(B, false);
+    }
+
+    /*! Return this^T * B. */
+    Matrix < ValueType > transMult(const Matrix < ValueType > & B) const {
+        return matMult_(B, true);
+    }
+
     /*! Save matrix to file. */
     virtual void save(const std::string & filename) const {
         saveMatrix(*this, filename);
@@ -583,22 +655,79 @@ protected:
 
     void allocate_(Index rows, Index cols){
 //         __MS(rows << " " << cols)
-        if (mat_.size() != rows) mat_.resize(rows);
-        for (Index i = 0; i < mat_.size(); i ++) {
-//             __MS(this << " " << &mat_[i] << " "<< cols)
-            mat_[i].resize(cols);
-//             __MS(&mat_[i] << " " <<mat_[i].size())
+        if (rows != mat_.size() || cols != this->cols() || !contiguous_()){
+            std::vector < ValueType > storage(rows * cols, ValueType(0));
+
+            //** keep the overlapping values
+            for (Index i = 0; i < std::min(rows, Index(mat_.size())); i ++){
+                Index c = std::min(cols, mat_[i].size());
+                if (c) std::copy(&mat_[i][0], &mat_[i][0] + c, &storage[i * cols]);
+            }
+            if (mat_.size() != rows) mat_.resize(rows);
+            storage_.swap(storage);
+            bindRows_(cols);
         }
         rowFlag_.resize(rows);
     }
 
     void copy_(const Matrix < ValueType > & mat){
         allocate_(mat.rows(), mat.cols());
-        for (Index i = 0; i < mat_.size(); i ++) mat_[i] = mat[i];
+        if (mat.contiguous_()){
+            std::copy(mat.storage_.begin(), mat.storage_.end(), storage_.begin());
+        } else {
+            for (Index i = 0; i < mat_.size(); i ++) mat_[i] = mat[i];
+        }
+    }
+
+    /*! Let all rows use their part of storage_. */
+    void bindRows_(Index cols){
+        ValueType * data = storage_.empty() ? 0 : &storage_[0];
+        for (Index i = 0; i < mat_.size(); i ++) {
+            mat_[i].bind_(data ? data + i * cols : 0, cols);
+        }
+    }
+
+    /*! True if all rows are of equal length and still part of storage_. */
+    bool contiguous_() const {
+        Index c = this->cols();
+        if (storage_.size() != mat_.size() * c) return false;
+        for (Index i = 0; i < mat_.size(); i ++) {
+            if (mat_[i].size() != c) return false;
+            if (c && &mat_[i][0] != &storage_[i * c]) return false;
+        }
+        return true;
+    }
+
+    Matrix < ValueType > matMult_(const Matrix < ValueType > & B, bool transA) const {
+        Index m = transA ? this->cols() : this->rows();
+        Index k = transA ? this->rows() : this->cols();
+        Index n = B.cols();
+
+        if (B.rows() != k){
+            throwLengthError(1, WHERE_AM_I + " " + toStr(k) + " != " + toStr(B.rows()));
+        }
+        Matrix < ValueType > C(m, n);
+        if (m == 0 || n == 0 || k == 0) return C;
+
+        if (contiguous_() && B.contiguous_()){
+            denseMatMult(&storage_[0], &B.storage_[0], &C.storage_[0],
+                         m, n, k, transA);
+        } else {
+            for (Index i = 0; i < m; i ++){
+                for (Index l = 0; l < k; l ++){
+                    ValueType a = transA ? mat_[l][i] : mat_[i][l];
+                    if (a != ValueType(0)) C[i] += B[l] * a;
+                }
+            }
+        }
+        return C;
     }
 
 	std::vector < Vector< ValueType > > mat_;
 
+    /*! Contiguous row major storage of all rows. */
+    std::vector < ValueType > storage_;
+
     /*! BVector flag(rows) for free use, e.g., check if rows are set valid. */
     BVector rowFlag_;
 };
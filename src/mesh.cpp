@@ -18,8 +18,11 @@
 
 #include "mesh.h"
 
+#include "calculateMultiThread.h"
+#include "cellBVH.h"
 #include "kdtreeWrapper.h"
 #include "memwatch.h"
+#include "meshView.h"
 #include "meshentities.h"
 #include "node.h"
 #include "shape.h"
@@ -28,6 +31,7 @@
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
 #include <map>
 
 namespace GIMLI{
@@ -42,6 +46,8 @@ Mesh::Mesh(Index dim)
     rangesKnown_(false),
     neighboursKnown_(false),
     tree_(NULL),
+    cellTree_(NULL),
+    view_(NULL),
     staticGeometry_(true){
 
     oldTet10NumberingStyle_ = true;
@@ -52,6 +58,8 @@ Mesh::Mesh(const std::string & filename, bool createNeighbourInfos)
     : rangesKnown_(false),
     neighboursKnown_(false),
     tree_(NULL),
+    cellTree_(NULL),
+    view_(NULL),
     staticGeometry_(true){
 
     dimension_ = 3;
@@ -64,6 +72,8 @@ Mesh::Mesh(const Mesh & mesh)
     : rangesKnown_(false),
     neighboursKnown_(false),
     tree_(NULL),
+    cellTree_(NULL),
+    view_(NULL),
     staticGeometry_(true){
 
     oldTet10NumberingStyle_ = true;
@@ -121,6 +131,7 @@ Mesh::~Mesh(){
 
 void Mesh::setStaticGeometry(bool stat){
     staticGeometry_ = stat;
+    if (!staticGeometry_) clearGeometryCache_();
 }
 
 void Mesh::clear(){
@@ -128,6 +139,7 @@ void Mesh::clear(){
         deletePtr()(tree_);
         tree_ = NULL;
     }
+    clearGeometryCache_();
 
     for_each(cellVector_.begin(), cellVector_.end(), deletePtr());
     cellVector_.clear();
@@ -206,6 +218,22 @@ Boundary * Mesh::createBoundary(std::vector < Node * > & nodes, int marker){
     return NULL;
 }
 
+Boundary * Mesh::createBoundaryUnchecked_(std::vector < Node * > & nodes, int marker){
+    switch (nodes.size()){
+      case 1: return createBoundary_< NodeBoundary >(nodes, marker, -1); break;
+      case 2: return createBoundary_< Edge >(nodes, marker, -1); break;
+      case 3: {
+        if (dimension_ == 2)
+            return createBoundary_< Edge3 >(nodes, marker, -1);
+        return createBoundary_< TriangleFace >(nodes, marker, -1); } break;
+      case 4: return createBoundary_< QuadrangleFace >(nodes, marker, -1); break;
+      case 6: return createBoundary_< Triangle6Face >(nodes, marker, -1); break;
+      case 8: return createBoundary_< Quadrangle8Face >(nodes, marker, -1); break;
+    }
+    std::cout << WHERE_AM_I << " cannot determine boundary for nodes: " << nodes.size() << std::endl;
+    return NULL;
+}
+
 Boundary * Mesh::createBoundary(const Boundary & bound){
     std::vector < Node * > nodes(bound.nodeCount());
     for (Index i = 0; i < bound.nodeCount(); i ++) nodes[i] = &node(bound.node(i).id());
@@ -507,6 +535,10 @@ Cell * Mesh::findCell(const RVector3 & pos, size_t & count,
                 break;
             }
         }
+    } else if (staticGeometry_){
+        count = 0;
+        fillCellTree_();
+        cell = cellTree_->find(pos, count);
     } else {
         Stopwatch swatch(true);
         cellIDX__.clear();
@@ -564,6 +596,111 @@ Cell * Mesh::findCell(const RVector3 & pos, size_t & count,
     return cell;
 }
 
+class FindCellsMT : public BaseCalcMT{
+public:
+    FindCellsMT(const CellBVH & tree, const R3Vector & pos,
+                const std::vector < Index > & order,
+                std::vector < Cell * > & cells, bool verbose=false)
+        : BaseCalcMT(1, verbose), tree_(&tree), pos_(&pos),
+          order_(&order), cells_(&cells){
+    }
+
+    virtual ~FindCellsMT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index k = start_; k < end_; k ++){
+            Index i = (*order_)[k];
+            (*cells_)[i] = tree_->find((*pos_)[i]);
+        }
+    }
+
+protected:
+    const CellBVH * tree_;
+    const R3Vector * pos_;
+    const std::vector < Index > * order_;
+    std::vector < Cell * > * cells_;
+};
+
+//** spread the lower 21 bits of v to every third bit
+inline uint64 mortonSpread__(uint64 v){
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8)  & 0x100f00f00f00f00fULL;
+    v = (v | v << 4)  & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2)  & 0x1249249249249249ULL;
+    return v;
+}
+
+std::vector < Cell * > Mesh::findCells(const R3Vector & pos,
+                                       Index nThreads) const {
+    std::vector < Cell * > cells(pos.size(), NULL);
+    if (pos.size() == 0) return cells;
+    if (cellCount() == 0 || nodeCount() == 0){
+        throwError(1, WHERE_AM_I + " no cells. This is a empty mesh");
+    }
+
+    if (nThreads == 0) nThreads = threadCount();
+
+    //** everything the search creates lazily has to exist before the
+    //** threads start: search tree and shape function caches.
+    //** Dynamic meshes get a tree for this call only.
+    CellBVH localTree;
+    const CellBVH * tree = &localTree;
+    if (staticGeometry_){
+        fillCellTree_();
+        tree = cellTree_;
+    } else {
+        localTree.build(*this, nThreads);
+    }
+
+    std::set < int > rttis;
+    for (Index i = 0; i < cellCount(); i ++){
+        const Shape & shape = cellVector_[i]->shape();
+        if (rttis.insert(shape.rtti()).second){
+            shape.N(RVector3(0.0, 0.0, 0.0));
+        }
+        //** triangles and tetrahedrons have a closed form xyz2rst
+        if (shape.rtti() != MESH_SHAPE_TRIANGLE_RTTI &&
+            shape.rtti() != MESH_SHAPE_TETRAHEDRON_RTTI){
+            shape.invJacobian();
+        }
+    }
+
+    //** sort the queries along a Morton curve so that consecutive queries
+    //** visit the same part of the tree and each thread gets a compact region
+    RVector3 pMin(pos[0]), pMax(pos[0]);
+    for (Index i = 1; i < pos.size(); i ++){
+        for (Index d = 0; d < 3; d ++){
+            pMin[d] = std::min(pMin[d], pos[i][d]);
+            pMax[d] = std::max(pMax[d], pos[i][d]);
+        }
+    }
+    RVector3 scale(0.0, 0.0, 0.0);
+    for (Index d = 0; d < 3; d ++){
+        if (pMax[d] > pMin[d]) scale[d] = 2097151.0 / (pMax[d] - pMin[d]);
+    }
+
+    std::vector < std::pair < uint64, Index > > keys(pos.size());
+    for (Index i = 0; i < pos.size(); i ++){
+        uint64 code = 0;
+        for (Index d = 0; d < 3; d ++){
+            code |= mortonSpread__((uint64)((pos[i][d] - pMin[d]) * scale[d])) << d;
+        }
+        keys[i] = std::make_pair(code, i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector < Index > order(pos.size());
+    for (Index i = 0; i < pos.size(); i ++) order[i] = keys[i].second;
+
+    nThreads = std::max(Index(1), std::min(nThreads, Index(pos.size() / 1000 + 1)));
+
+    distributeCalc(FindCellsMT(*tree, pos, order, cells),
+                   pos.size(), nThreads);
+    return cells;
+}
+
 std::vector < Boundary * > Mesh::findBoundaryByMarker(int marker) const {
     return findBoundaryByMarker(marker, marker + 1);
 }
@@ -1178,25 +1315,167 @@ void Mesh::cleanNeighbourInfos(){
     }
 }
 
+//** Open addressing hash table for boundaries, keyed by the sorted node
+//** pointers of the boundary. Entries are kept in insertion order.
+class BoundaryHashTable{
+public:
+    struct Entry{
+        Index keyStart;
+        Index keyLen;
+        Boundary * bound;
+        Cell * cells[2];
+        Index faces[2];
+        Index count;
+    };
+
+    BoundaryHashTable(Index size){
+        Index n = 16;
+        while (n < 2 * size) n *= 2;
+        slots_.assign(n, 0);
+        entries_.reserve(size);
+        keys_.reserve(3 * size);
+    }
+
+    /*! Return the entry for the node pointers key, which have to be
+     * sorted. A new entry is created if the key is unknown. */
+    Entry & find(const std::vector < Node * > & key, bool & isNew){
+        uint64 h = hash_(key);
+        Index mask = slots_.size() - 1;
+        for (Index s = h & mask; ; s = (s + 1) & mask){
+            Index e = slots_[s];
+            if (e == 0){
+                isNew = true;
+                Entry entry = {keys_.size(), key.size(), NULL,
+                               {NULL, NULL}, {0, 0}, 0};
+                for (Index i = 0; i < key.size(); i ++) keys_.push_back(key[i]);
+                entries_.push_back(entry);
+                slots_[s] = entries_.size();
+                if (2 * entries_.size() > slots_.size()) rehash_();
+                return entries_.back();
+            }
+            if (equal_(entries_[e - 1], key)){
+                isNew = false;
+                return entries_[e - 1];
+            }
+        }
+    }
+
+    std::vector < Entry > & entries() { return entries_; }
+
+protected:
+    inline uint64 hash_(const std::vector < Node * > & key) const {
+        uint64 h = 14695981039346656037ULL;
+        for (Index i = 0; i < key.size(); i ++){
+            h ^= (uint64)(size_t)key[i];
+            h *= 1099511628211ULL;
+            h ^= h >> 29;
+        }
+        return h;
+    }
+
+    inline bool equal_(const Entry & e, const std::vector < Node * > & key) const {
+        if (e.keyLen != key.size()) return false;
+        for (Index i = 0; i < key.size(); i ++){
+            if (keys_[e.keyStart + i] != key[i]) return false;
+        }
+        return true;
+    }
+
+    void rehash_(){
+        slots_.assign(slots_.size() * 2, 0);
+        Index mask = slots_.size() - 1;
+        std::vector < Node * > key;
+        for (Index e = 0; e < entries_.size(); e ++){
+            key.assign(keys_.begin() + entries_[e].keyStart,
+                       keys_.begin() + entries_[e].keyStart + entries_[e].keyLen);
+            Index s = hash_(key) & mask;
+            while (slots_[s] != 0) s = (s + 1) & mask;
+            slots_[s] = e + 1;
+        }
+    }
+
+    std::vector < Index > slots_;
+    std::vector < Entry > entries_;
+    std::vector < Node * > keys_;
+};
+
 void Mesh::createNeighbourInfos(bool force){
-//     double med = 0.;
-//     __MS(neighboursKnown_ << " " <<force)
     if (!neighboursKnown_ || force){
         this->cleanNeighbourInfos();
+        //** the view holds the left and right cells of the boundaries
+        if (view_) view_->clear();
 
-//         Stopwatch sw(true);
+        Index nFaces = 0;
+        for (Index i = 0; i < cellCount(); i ++) nFaces += cellVector_[i]->boundaryCount();
 
+        //** every face is looked up once in a hash table keyed by its
+        //** sorted nodes, instead of intersecting the boundary and cell
+        //** sets of its nodes. Existing boundaries are entered first.
+        BoundaryHashTable table(boundaryCount() + nFaces / 2 + 1);
+        std::vector < Node * > key;
+        bool isNew = false;
+
+        for (Index i = 0; i < boundaryCount(); i ++){
+            Boundary * b = boundaryVector_[i];
+            key = b->nodes();
+            std::sort(key.begin(), key.end());
+            BoundaryHashTable::Entry & e = table.find(key, isNew);
+            if (isNew) e.bound = b;
+        }
+
+        //** one sweep over all cell faces in the same order as the per
+        //** cell search, so new boundaries get the same ids and left and
+        //** right cells are set by the same rules
         for (Index i = 0; i < cellCount(); i ++){
-//            if (i%10000 ==0) __MS(i);
-            createNeighbourInfosCell_(&cell(i));
-//             med+=sw.duration(true);
+            Cell * c = cellVector_[i];
+            for (Index j = 0; j < c->boundaryCount(); j ++){
+                std::vector < Node * > nodes(c->boundaryNodes(j));
+                key = nodes;
+                std::sort(key.begin(), key.end());
+
+                BoundaryHashTable::Entry & e = table.find(key, isNew);
+                if (!e.bound) e.bound = createBoundaryUnchecked_(nodes, 0);
+                if (e.count < 2){
+                    e.cells[e.count] = c;
+                    e.faces[e.count] = j;
+                }
+                e.count ++;
+
+                Boundary * bound = e.bound;
+                bool cellIsLeft = true;
+                if (bound->shape().nodeCount() == 2) {
+                    cellIsLeft = (nodes[0]->id() == bound->node(0).id());
+                } else if (bound->shape().nodeCount() > 2) {
+                    // normal vector of boundary shows outside for left cell ... every boundary needs a left cell
+                    cellIsLeft = bound->normShowsOutside(*c);
+                }
+
+                if (bound->leftCell() == NULL && cellIsLeft) {
+                    if (bound->rightCell() != c) bound->setLeftCell(c);
+                } else if (bound->rightCell() == NULL && bound->leftCell() != c){
+                    bound->setRightCell(c);
+                }
+            }
+        }
+
+        //** faces shared by exactly two cells link both cells
+        std::vector < BoundaryHashTable::Entry > & entries = table.entries();
+        for (Index i = 0; i < entries.size(); i ++){
+            BoundaryHashTable::Entry & e = entries[i];
+            if (e.count != 2) continue;
+
+            e.cells[0]->setNeighbourCell(e.faces[0], e.cells[1]);
+            e.cells[1]->setNeighbourCell(e.faces[1], e.cells[0]);
+
+            Boundary * bound = e.bound;
+            if (bound->leftCell() == NULL){
+                bound->setLeftCell(bound->rightCell() == e.cells[0] ? e.cells[1] : e.cells[0]);
+            } else if (bound->rightCell() == NULL){
+                bound->setRightCell(bound->leftCell() == e.cells[0] ? e.cells[1] : e.cells[0]);
+            }
         }
         neighboursKnown_ = true;
-    } else {
-//         __M
     }
-
-//     std::cout << med << " " << med/cellCount() << std::endl;
 }
 
 void Mesh::createNeighbourInfosCell_(Cell *c){
@@ -1867,6 +2146,7 @@ Mesh & Mesh::scale(const RVector3 & s){
                   boost::bind(& RVector3::scale, _1, boost::ref(s)));
 
     rangesKnown_ = false;
+    clearGeometryCache_();
     return *this;
 }
 
@@ -1879,6 +2159,7 @@ Mesh & Mesh::translate(const RVector3 & t){
                   boost::bind(& RVector3::translate, _1, boost::ref(t)));
 
     rangesKnown_ = false;
+    clearGeometryCache_();
     return *this;
 }
 
@@ -1891,6 +2172,7 @@ Mesh & Mesh::rotate(const RVector3 & r){
                   boost::bind(& RVector3::rotate, _1, boost::ref(r)));
 
     rangesKnown_ = false;
+    clearGeometryCache_();
     return *this;
 }
 
@@ -1902,6 +2184,7 @@ void Mesh::swapCoordinates(Index i, Index j){
                 nodeVector_[n]->at(i) = nodeVector_[n]->at(j);
                 nodeVector_[n]->at(j) = tmp;
             }
+            clearGeometryCache_();
         }
     }
 }
@@ -1993,6 +2276,7 @@ void Mesh::smooth(bool nodeMoving, bool edgeSliding, uint smoothFunction, uint s
             }
         }
     }
+    if (nodeMoving) clearGeometryCache_();
 }
 
 void Mesh::fillKDTree_() const {
@@ -2013,6 +2297,37 @@ void Mesh::fillKDTree_() const {
 
 }
 
+void Mesh::fillCellTree_() const {
+    if (!cellTree_) cellTree_ = new CellBVH();
+
+    if (cellTree_->size() != cellCount()){
+        cellTree_->build(*this);
+    }
+}
+
+void Mesh::clearGeometryCache_() const {
+    if (cellTree_) {
+        deletePtr()(cellTree_);
+        cellTree_ = NULL;
+    }
+    if (view_) {
+        deletePtr()(view_);
+        view_ = NULL;
+    }
+}
+
+const MeshView & Mesh::view() const {
+    if (!view_) view_ = new MeshView();
+
+    if (!staticGeometry_ ||
+        view_->nodeCount() != nodeCount() ||
+        view_->cellCount() != cellCount() ||
+        view_->boundaryCount() != boundaryCount()){
+        view_->build(*this);
+    }
+    return *view_;
+}
+
 void Mesh::addRegionMarker(const RegionMarker & reg){
     regionMarker_.push_back(reg);
 }
@@ -2032,12 +2347,12 @@ void Mesh::addHoleMarker(const RVector3 & pos){
 void Mesh::interpolationMatrix(const R3Vector & q, RSparseMapMatrix & I){
     I.resize(q.size(), this->nodeCount());
 
-    Index count = 0;
+    std::vector < Cell * > cells(this->findCells(q));
     Cell * c = 0;
     RVector cI;
 
     for (Index i = 0; i < q.size(); i ++ ){
-        c = this->findCell(q[i], count, false);
+        c = cells[i];
         if (c){
             cI.resize(c->nodeCount());
             c->N(c->shape().rst(q[i]), cI);
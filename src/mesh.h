@@ -33,6 +33,9 @@
 namespace GIMLI{
 
 class KDTreeWrapper;
+class CellBVH;
+class MeshView;
+struct MeshFileSections;
 
 template < class T > class DLLEXPORT BoundingBox;
 typedef BoundingBox< double > RBoundingBox;
@@ -107,6 +110,10 @@ template < class ValueType > std::ostream & operator << (std::ostream & str, con
 
 DLLEXPORT std::ostream & operator << (std::ostream & str, const Mesh & mesh);
 
+/*! Return the cell markers of a mesh in binary format v.3 without loading
+ * the mesh, only the marker chunks are decoded. */
+DLLEXPORT IVector loadCellMarkersBinaryV3(const std::string & fbody, Index nThreads=0);
+
 
 class DLLEXPORT RegionMarkerPLC : public RVector3{
 public:
@@ -151,7 +158,7 @@ public:
     void clear();
 
     /*!If the mesh is static in geometry and shape some useful informations are cached.
-     * (cell sizes, boundary sizes, ...)
+     * (cell sizes, boundary sizes, cell search tree ...)
      For dynamic meshes, i.e., node positions can be moved, you have to set staticGeometry to false to avoid any caching.*/
     void setStaticGeometry(bool stat);
 
@@ -320,6 +327,12 @@ public:
      For the left cell neighbor the normal direction should be always the outer normal.*/
     R3Vector & boundarySizedNormals() const;
 
+    /*! Return the compact snapshot of the mesh topology and geometry
+     * (\ref MeshView) for loops over all cells or nodes. Cached for static
+     * geometry and rebuilt if the amount of nodes, cells or boundaries
+     * changes. Will be build on first call, not thread safe. */
+    const MeshView & view() const;
+
 
     /*! Return a vector of all boundary marker */
     IVector boundaryMarkers() const;
@@ -350,7 +363,9 @@ public:
     void setBoundaryMarker(const IndexArray & ids, int marker);
 
     /*! Return ptr to the cell that match position pos, counter holds amount of touch tests.
-        Searching is done first by nearest-neighbour-kd-tree search,
+        For static geometry the search uses a bounding volume hierarchy over all cells
+        (\ref CellBVH), which is built once and always finds the cell.
+        Otherwise searching is done first by nearest-neighbour-kd-tree search,
         followed by slope-search if extensive is set. Return NULL if no cell can be found. */
     Cell * findCell(const RVector3 & pos, size_t & counter, bool extensive) const ;
 
@@ -358,6 +373,17 @@ public:
     Cell * findCell(const RVector3 & pos, bool extensive=true) const {
         size_t counter; return findCell(pos, counter, extensive); }
 
+    /*! Return the cells that contain the query positions pos, NULL for
+     * positions outside the mesh. The queries are answered by the cell
+     * bounding volume hierarchy (\ref CellBVH), which only reads the mesh,
+     * so they can be distributed over up to nThreads threads
+     * (0 = \ref threadCount()). The queries are sorted along a Morton
+     * curve so that each thread works on a compact region. The hierarchy
+     * is created once in advance if needed, for dynamic meshes only for
+     * this call. The search is exhaustive. */
+    std::vector < Cell * > findCells(const R3Vector & pos,
+                                     Index nThreads=0) const;
+
     /*! Return the index to the node of this mesh with the smallest distance to pos. */
     Index findNearestNode(const RVector3 & pos);
 
@@ -436,6 +462,7 @@ public:
 //                        bind2nd(std::mem_fun(&Node::pos().transform), mat));
         for (uint i = 0; i < nodeVector_.size(); i ++) nodeVector_[i]->pos().transform(mat);
         rangesKnown_ = false;
+        clearGeometryCache_();
         return *this;
     }
 
@@ -476,9 +503,39 @@ public:
     void saveBinaryV2(const std::string & fbody) const;
 
     /*! Load mesh in binary format v.2.0. should be possible to interchange on all little endian platforms. Format see \ref saveBinaryV2.
+        The file is memory mapped (\ref MappedFile) and the mesh is created directly from its sections.
+        The stored boundaries are trusted to be unique. If their left and right cells cover all cell faces,
+        the neighbour infos are complete and \ref createNeighbourInfos has nothing to do.
         If something goes wrong while reading, an exception is thrown. */
     void loadBinaryV2(const std::string & fbody);
 
+    /*! Save mesh in the compressed binary format v.3. Contains the same as
+        \ref saveBinaryV2. Index arrays are delta encoded, markers and node
+        counts are run length encoded, all as variable length integers.
+        Coordinates are stored lossless (xor with the previous coordinate) or,
+        if quantum > 0, rounded to multiples of quantum, so every coordinate
+        differs at most quantum / 2 from the original.
+        Every array is split into chunks of chunkSize nodes, cells or boundaries
+        that can be decoded independently. A chunk index in the header allows
+        parallel and partial reading, see \ref loadBinaryV3Cells.
+        Chunks are encoded with up to nThreads threads (0 = \ref threadCount()).
+        If something goes wrong while writing, an exception is thrown. */
+    void saveBinaryV3(const std::string & fbody, double quantum=0.0,
+                      Index chunkSize=65536, Index nThreads=0) const;
+
+    /*! Load mesh in the binary format v.3, see \ref saveBinaryV3. The chunks
+        are decoded with up to nThreads threads (0 = \ref threadCount()).
+        Boundaries and neighbour infos are treated like in \ref loadBinaryV2.
+        If something goes wrong while reading, an exception is thrown. */
+    void loadBinaryV3(const std::string & fbody, Index nThreads=0);
+
+    /*! Load only the cells [start, end) from a mesh in binary format v.3
+        with their nodes. Only the chunks that hold these cells and their
+        nodes are decoded. The nodes keep their order but are renumbered,
+        no boundaries and export data are loaded. */
+    void loadBinaryV3Cells(const std::string & fbody, Index start, Index end,
+                           Index nThreads=0);
+
     int exportSimple(const std::string & fbody, const RVector & data) const ;
 
     /*! Very simple export filter. Write to file fileName:
@@ -520,11 +577,19 @@ public:
 
     /*! Export the mesh in filename using vtu format:
     Visualization Toolkit Unstructured Points Data (http://www.vtk.org)
-    Set binary to true writes the data content in binary format.
+    Set binary to true writes all arrays unformatted as raw binary blocks
+    in the appended data section.
     The file suffix .vtu will be added or substituted if .vtu or .vtk is found.
     \ref exportData, cell.marker and cell.attribute will be exported as data. */
     void exportVTU(const std::string & filename, bool binary = false) const ;
 
+    /*! Export the mesh like \ref exportVTU with binary data, split into
+    nParts pieces of consecutive cells. The pieces fbody_i.vtu hold the
+    cells with their nodes and are written by up to nThreads threads
+    (0 = \ref threadCount()), fbody.pvtu refers to them.
+    nParts = 0 writes one piece per thread. */
+    void exportPVTU(const std::string & fbody, Index nParts=0, Index nThreads=0) const;
+
     /*! Export the boundary of this mesh in vtu format: Visualization Toolkit Unstructured Points Data (http://www.vtk.org) Set Binary to true writes the datacontent in binary format. The file suffix .vtu will be added or substituted if .vtu or .vtk is found. */
     void exportBoundaryVTU(const std::string & fbody, bool binary = false) const ;
 
@@ -695,6 +760,13 @@ protected:
         return b;
     }
 
+    /*! Create a boundary without looking for an existing one. */
+    Boundary * createBoundaryUnchecked_(std::vector < Node * > & nodes, int marker);
+
+    /*! Create nodes, cells and boundaries from the arrays of a binary mesh
+     * file and link the neighbours if they are complete. */
+    void createFromSections_(const MeshFileSections & s, const std::string & fileName);
+
     template < class C > Cell * createCell_(
         std::vector < Node * > & nodes, int marker, int id){
 
@@ -714,6 +786,13 @@ protected:
 
     void fillKDTree_() const;
 
+    /*! Build the cell search tree if it is missing or out of date. */
+    void fillCellTree_() const;
+
+    /*! Delete the cell search tree and the mesh view, e.g., after the
+     * nodes have been moved. */
+    void clearGeometryCache_() const;
+
     std::vector< Node * >     nodeVector_;
     std::vector< Boundary * > boundaryVector_;
     std::vector< Cell * >     cellVector_;
@@ -727,6 +806,8 @@ protected:
     bool neighboursKnown_;
 
     mutable KDTreeWrapper * tree_;
+    mutable CellBVH * cellTree_;
+    mutable MeshView * view_;
 
     /*! A static geometry mesh caches geometry informations. */
     bool staticGeometry_;
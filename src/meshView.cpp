@@ -0,0 +1,281 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "meshView.h"
+
+#include "calculateMultiThread.h"
+#include "mesh.h"
+#include "meshentities.h"
+#include "node.h"
+#include "shape.h"
+
+#include <cmath>
+
+namespace GIMLI{
+
+//** spatial dimension of the cached gradients, 0 if the cell has no cache
+inline Index simplexDim__(uint8 rtti){
+    switch (rtti){
+        case MESH_EDGE_CELL_RTTI: return 1;
+        case MESH_TRIANGLE_RTTI: return 2;
+        case MESH_TETRAHEDRON_RTTI: return 3;
+        default: return 0;
+    }
+}
+
+class BuildMeshViewMT : public BaseCalcMT{
+public:
+    BuildMeshViewMT(MeshView & view, const Mesh & mesh, bool verbose=false)
+        : BaseCalcMT(1, verbose), view_(&view), mesh_(&mesh){
+    }
+
+    virtual ~BuildMeshViewMT(){}
+
+    virtual void calc(Index tNr=0){
+        MeshView & v = *view_;
+
+        for (Index c = start_; c < end_; c ++){
+            const Cell & cell = mesh_->cell(c);
+            Index * nodes = &v.cellNodes_[v.cellNodePtr_[c]];
+            for (Index i = 0; i < cell.nodeCount(); i ++){
+                nodes[i] = cell.node(i).id();
+            }
+            v.cellRtti_[c] = cell.rtti();
+
+            //** lower dimensional cells would get gradients and sizes
+            //** of their projection, so they keep the shape path
+            Index d = simplexDim__(cell.rtti());
+            if (d == 0 || d < v.dim_ || !simplexGradients_(v, c, d)){
+                if (d > 0) v.grads_[v.gradPtr_[c]] = std::nan("");
+                v.cellSize_[c] = cell.shape().domainSize();
+            }
+        }
+    }
+
+protected:
+    /*! Fill the barycentric gradients and the size of the simplex c of
+     * dimension d from the inverse of its Jacobian. */
+    bool simplexGradients_(MeshView & v, Index c, Index d){
+        const Index * nodes = &v.cellNodes_[v.cellNodePtr_[c]];
+        const double * p0 = v.nodePos(nodes[0]);
+
+        double J[3][3];
+        for (Index k = 0; k < d; k ++){
+            const double * pk = v.nodePos(nodes[k + 1]);
+            for (Index r = 0; r < d; r ++) J[r][k] = pk[r] - p0[r];
+        }
+
+        double det = 0.0, inv[3][3];
+        switch (d){
+            case 1:
+                det = J[0][0];
+                inv[0][0] = 1.0;
+                break;
+            case 2:
+                det = J[0][0] * J[1][1] - J[0][1] * J[1][0];
+                inv[0][0] =  J[1][1]; inv[0][1] = -J[0][1];
+                inv[1][0] = -J[1][0]; inv[1][1] =  J[0][0];
+                break;
+            case 3:
+                inv[0][0] = J[1][1] * J[2][2] - J[1][2] * J[2][1];
+                inv[0][1] = J[0][2] * J[2][1] - J[0][1] * J[2][2];
+                inv[0][2] = J[0][1] * J[1][2] - J[0][2] * J[1][1];
+                inv[1][0] = J[1][2] * J[2][0] - J[1][0] * J[2][2];
+                inv[1][1] = J[0][0] * J[2][2] - J[0][2] * J[2][0];
+                inv[1][2] = J[0][2] * J[1][0] - J[0][0] * J[1][2];
+                inv[2][0] = J[1][0] * J[2][1] - J[1][1] * J[2][0];
+                inv[2][1] = J[0][1] * J[2][0] - J[0][0] * J[2][1];
+                inv[2][2] = J[0][0] * J[1][1] - J[0][1] * J[1][0];
+                det = J[0][0] * inv[0][0] + J[0][1] * inv[1][0] + J[0][2] * inv[2][0];
+                break;
+        }
+        if (det == 0.0) return false;
+
+        //** row k of the inverse Jacobian is the gradient of node k + 1,
+        //** the gradient of node 0 is minus their sum
+        double * g = &v.grads_[v.gradPtr_[c]];
+        for (Index r = 0; r < d; r ++){
+            g[r] = 0.0;
+            for (Index k = 0; k < d; k ++){
+                g[(k + 1) * d + r] = inv[k][r] / det;
+                g[r] -= g[(k + 1) * d + r];
+            }
+        }
+
+        double size = std::fabs(det);
+        for (Index k = 2; k <= d; k ++) size /= k;
+        v.cellSize_[c] = size;
+        return true;
+    }
+
+    MeshView * view_;
+    const Mesh * mesh_;
+};
+
+MeshView::MeshView()
+    : dim_(0){
+}
+
+MeshView::MeshView(const Mesh & mesh, Index nThreads)
+    : dim_(0){
+    build(mesh, nThreads);
+}
+
+MeshView::~MeshView(){
+}
+
+void MeshView::clear(){
+    dim_ = 0;
+    pos_.clear();
+    cellNodePtr_.clear();
+    cellNodes_.clear();
+    nodeCellPtr_.clear();
+    nodeCells_.clear();
+    boundNodePtr_.clear();
+    boundNodes_.clear();
+    boundLeft_.clear();
+    boundRight_.clear();
+    cellRtti_.clear();
+    cellSize_.clear();
+    gradPtr_.clear();
+    grads_.clear();
+}
+
+void MeshView::build(const Mesh & mesh, Index nThreads){
+    clear();
+    dim_ = mesh.dim();
+
+    Index nNodes = mesh.nodeCount();
+    Index nCells = mesh.cellCount();
+    Index nBounds = mesh.boundaryCount();
+
+    pos_.resize(3 * nNodes);
+    for (Index i = 0; i < nNodes; i ++){
+        const RVector3 & p = mesh.node(i).pos();
+        pos_[3 * i] = p[0];
+        pos_[3 * i + 1] = p[1];
+        pos_[3 * i + 2] = p[2];
+    }
+
+    //** row pointers for the cell nodes and the gradient cache
+    cellNodePtr_.resize(nCells + 1, 0);
+    gradPtr_.resize(nCells + 1, 0);
+    for (Index c = 0; c < nCells; c ++){
+        const Cell & cell = mesh.cell(c);
+        Index n = cell.nodeCount();
+        cellNodePtr_[c + 1] = cellNodePtr_[c] + n;
+        gradPtr_[c + 1] = gradPtr_[c] + simplexDim__(cell.rtti()) * n;
+    }
+    cellNodes_.resize(cellNodePtr_[nCells]);
+    grads_.resize(gradPtr_[nCells]);
+    cellRtti_.resize(nCells);
+    cellSize_.resize(nCells);
+
+    if (nCells > 0){
+        if (nThreads == 0) nThreads = threadCount();
+        nThreads = std::max(Index(1), std::min(nThreads, nCells / 10000 + 1));
+        distributeCalc(BuildMeshViewMT(*this, mesh), nCells, nThreads);
+    }
+
+    //** degenerated simplices keep no cache and fall back to the mesh
+    Index nGrads = 0;
+    for (Index c = 0; c < nCells; c ++){
+        Index start = gradPtr_[c], end = gradPtr_[c + 1];
+        gradPtr_[c] = nGrads;
+        if (end > start && !std::isnan(grads_[start])){
+            if (nGrads != start){
+                std::copy(grads_.begin() + start, grads_.begin() + end,
+                          grads_.begin() + nGrads);
+            }
+            nGrads += end - start;
+        }
+    }
+    gradPtr_[nCells] = nGrads;
+    grads_.resize(nGrads);
+
+    //** the cells of each node by counting sort, so they come in order
+    nodeCellPtr_.resize(nNodes + 1, 0);
+    for (Index i = 0; i < cellNodes_.size(); i ++) nodeCellPtr_[cellNodes_[i] + 1] ++;
+    for (Index i = 0; i < nNodes; i ++) nodeCellPtr_[i + 1] += nodeCellPtr_[i];
+    nodeCells_.resize(nodeCellPtr_[nNodes]);
+    std::vector < Index > fill(nodeCellPtr_.begin(), nodeCellPtr_.end() - 1);
+    for (Index c = 0; c < nCells; c ++){
+        for (Index i = cellNodePtr_[c]; i < cellNodePtr_[c + 1]; i ++){
+            nodeCells_[fill[cellNodes_[i]] ++] = c;
+        }
+    }
+
+    boundNodePtr_.resize(nBounds + 1, 0);
+    for (Index b = 0; b < nBounds; b ++){
+        boundNodePtr_[b + 1] = boundNodePtr_[b] + mesh.boundary(b).nodeCount();
+    }
+    boundNodes_.resize(boundNodePtr_[nBounds]);
+    boundLeft_.resize(nBounds);
+    boundRight_.resize(nBounds);
+    for (Index b = 0; b < nBounds; b ++){
+        Boundary & bound = mesh.boundary(b);
+        Index * nodes = &boundNodes_[boundNodePtr_[b]];
+        for (Index i = 0; i < bound.nodeCount(); i ++) nodes[i] = bound.node(i).id();
+        boundLeft_[b] = bound.leftCell() ? SIndex(bound.leftCell()->id()) : -1;
+        boundRight_[b] = bound.rightCell() ? SIndex(bound.rightCell()->id()) : -1;
+    }
+}
+
+bool MeshView::stiffness(Index c, double * S) const {
+    if (!hasGradients(c)) return false;
+
+    Index n = cellNodeCount(c);
+    Index d = n - 1;
+    const double * g = gradients(c);
+    double size = cellSize_[c];
+
+    for (Index i = 0; i < n; i ++){
+        for (Index j = i; j < n; j ++){
+            double s = 0.0;
+            for (Index r = 0; r < d; r ++) s += g[i * d + r] * g[j * d + r];
+            S[i * n + j] = S[j * n + i] = size * s;
+        }
+    }
+    return true;
+}
+
+bool MeshView::mass(Index c, double * M) const {
+    if (!hasGradients(c)) return false;
+
+    //** int N_i N_j = size * (1 + delta_ij) / ((d + 1) * (d + 2))
+    Index n = cellNodeCount(c);
+    double off = cellSize_[c] / (n * (n + 1));
+
+    for (Index i = 0; i < n; i ++){
+        for (Index j = 0; j < n; j ++) M[i * n + j] = off;
+        M[i * n + i] = 2.0 * off;
+    }
+    return true;
+}
+
+Index MeshView::memoryUsage() const {
+    return sizeof(double) * (pos_.size() + cellSize_.size() + grads_.size()) +
+           sizeof(Index) * (cellNodePtr_.size() + cellNodes_.size() +
+                            nodeCellPtr_.size() + nodeCells_.size() +
+                            boundNodePtr_.size() + boundNodes_.size() +
+                            gradPtr_.size()) +
+           sizeof(SIndex) * (boundLeft_.size() + boundRight_.size()) +
+           sizeof(uint8) * cellRtti_.size() + sizeof(*this);
+}
+
+} // namespace GIMLI
@@ -0,0 +1,157 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_MESHVIEW__H
+#define _GIMLI_MESHVIEW__H
+
+#include "gimli.h"
+
+#include <vector>
+
+namespace GIMLI{
+
+//! Immutable compact snapshot of a mesh.
+/*! Flat copy of the topology and geometry of a \ref Mesh for loops over
+ * all cells or nodes. The node coordinates are stored in one array, the
+ * cell nodes, the cells of each node and the boundary nodes are stored as
+ * compressed rows (CSR) of node and cell indices. For every boundary the
+ * index of its left and right cell is stored, -1 if there is none.
+ * For every cell the rtti and the size are stored. For linear simplices
+ * (edge cells, triangles and tetrahedrons) the constant gradients of the
+ * shape functions are cached, so their stiffness and mass matrices
+ * can be formed without \ref Shape or \ref ElementMatrix.
+ * The view holds no reference to the mesh, it has to be rebuilt if the
+ * mesh changes. Markers are not part of the view since they can change
+ * without changing the mesh geometry, ask the mesh for them.
+ * Usually the view is obtained from \ref Mesh::view(). */
+class DLLEXPORT MeshView{
+public:
+    /*! Default constructor, create an empty view. */
+    MeshView();
+
+    /*! Create the view for mesh, see \ref build. */
+    MeshView(const Mesh & mesh, Index nThreads=0);
+
+    /*! Default destructor. */
+    ~MeshView();
+
+    /*! Build the view for mesh with up to nThreads threads
+     * (0 = \ref threadCount()). An existing view is replaced. */
+    void build(const Mesh & mesh, Index nThreads=0);
+
+    /*! Remove everything from the view. */
+    void clear();
+
+    inline Index dim() const { return dim_; }
+
+    inline Index nodeCount() const { return pos_.size() / 3; }
+
+    inline Index cellCount() const { return cellRtti_.size(); }
+
+    inline Index boundaryCount() const { return boundLeft_.size(); }
+
+    /*! Return the coordinates x, y, z of node i. */
+    inline const double * nodePos(Index i) const { return &pos_[3 * i]; }
+
+    inline Index cellNodeCount(Index c) const {
+        return cellNodePtr_[c + 1] - cellNodePtr_[c]; }
+
+    /*! Return the node indices of cell c. */
+    inline const Index * cellNodes(Index c) const {
+        return &cellNodes_[cellNodePtr_[c]]; }
+
+    inline Index nodeCellCount(Index n) const {
+        return nodeCellPtr_[n + 1] - nodeCellPtr_[n]; }
+
+    /*! Return the indices of the cells that share node n, sorted. */
+    inline const Index * nodeCells(Index n) const {
+        return &nodeCells_[nodeCellPtr_[n]]; }
+
+    inline Index boundaryNodeCount(Index b) const {
+        return boundNodePtr_[b + 1] - boundNodePtr_[b]; }
+
+    /*! Return the node indices of boundary b. */
+    inline const Index * boundaryNodes(Index b) const {
+        return &boundNodes_[boundNodePtr_[b]]; }
+
+    /*! Return the index of the left cell of boundary b or -1. */
+    inline SIndex leftCell(Index b) const { return boundLeft_[b]; }
+
+    /*! Return the index of the right cell of boundary b or -1. */
+    inline SIndex rightCell(Index b) const { return boundRight_[b]; }
+
+    inline uint8 cellRtti(Index c) const { return cellRtti_[c]; }
+
+    /*! Return the size (length, area or volume) of cell c. */
+    inline double cellSize(Index c) const { return cellSize_[c]; }
+
+    /*! Return true if the shape function gradients of cell c are cached. */
+    inline bool hasGradients(Index c) const {
+        return gradPtr_[c + 1] > gradPtr_[c]; }
+
+    /*! Return the gradients of the shape functions of cell c, the
+     * cellNodeCount(c) - 1 derivatives of each node follow each other.
+     * Only valid if \ref hasGradients(c). */
+    inline const double * gradients(Index c) const {
+        return &grads_[gradPtr_[c]]; }
+
+    /*! Fill S (row major, cellNodeCount(c)^2 values) with the stiffness
+     * matrix int grad N_i * grad N_j of cell c. This is the same as
+     * \ref ElementMatrix::ux2uy2uz2. Return false and leave S untouched
+     * if the gradients of c are not cached. */
+    bool stiffness(Index c, double * S) const;
+
+    /*! Fill M (row major, cellNodeCount(c)^2 values) with the mass
+     * matrix int N_i * N_j of cell c. This is the same as
+     * \ref ElementMatrix::u2. Return false and leave M untouched
+     * if the gradients of c are not cached. */
+    bool mass(Index c, double * M) const;
+
+    /*! Return the amount of bytes held by the view. */
+    Index memoryUsage() const;
+
+protected:
+    friend class BuildMeshViewMT;
+
+    Index dim_;
+
+    //** x, y, z for each node
+    std::vector < double > pos_;
+
+    std::vector < Index > cellNodePtr_;
+    std::vector < Index > cellNodes_;
+
+    std::vector < Index > nodeCellPtr_;
+    std::vector < Index > nodeCells_;
+
+    std::vector < Index > boundNodePtr_;
+    std::vector < Index > boundNodes_;
+    std::vector < SIndex > boundLeft_;
+    std::vector < SIndex > boundRight_;
+
+    std::vector < uint8 > cellRtti_;
+    std::vector < double > cellSize_;
+
+    //** shape function gradients, empty rows for cells without cache
+    std::vector < Index > gradPtr_;
+    std::vector < double > grads_;
+};
+
+} // namespace GIMLI
+
+#endif // _GIMLI_MESHVIEW__H
@@ -17,6 +17,8 @@
  ******************************************************************************/
 
 #include "mesh.h"
+#include "calculateMultiThread.h"
+#include "mappedFile.h"
 #include "node.h"
 #include "matrix.h"
 #include "pos.h"
@@ -371,7 +373,7 @@ void Mesh::loadBinary(const std::string & fbody){
 }
 
 template < class ValueType > void writeToFile(FILE * file, const ValueType & v, int count=1){
-    if (!fwrite(&v, sizeof(ValueType), count, file)){
+    if (count > 0 && !fwrite(&v, sizeof(ValueType), count, file)){
         throwError(EXIT_OPEN_FILE, WHERE_AM_I + strerror(errno)  + str(errno));
     }
 }
@@ -513,104 +515,927 @@ void Mesh::saveBinaryV2(const std::string & fbody) const {
     delete [] rightCells;
 }
 
+//** index of the face of c with the same nodes as b, c.boundaryCount() if none
+inline Index faceIndex__(const Cell & c, const Boundary & b){
+    for (Index i = 0; i < c.boundaryCount(); i ++){
+        std::vector < Node * > nodes(c.boundaryNodes(i));
+        if (nodes.size() != b.nodeCount()) continue;
+
+        bool match = true;
+        for (Index j = 0; j < b.nodeCount() && match; j ++){
+            match = std::find(nodes.begin(), nodes.end(), &b.node(j)) != nodes.end();
+        }
+        if (match) return i;
+    }
+    return c.boundaryCount();
+}
+
+/*! Link the left and right cells of the boundaries [start_, end_) as
+ * neighbours. Every boundary writes different cell faces, so no locking
+ * is needed. A boundary that is no face of its cells marks the thread
+ * result as incomplete. */
+class NeighbourCellsMT : public BaseCalcMT{
+public:
+    NeighbourCellsMT(const std::vector < Boundary * > & bounds,
+                     std::vector < int > & complete, bool verbose=false)
+        : BaseCalcMT(1, verbose), bounds_(&bounds), complete_(&complete){
+    }
+
+    virtual ~NeighbourCellsMT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index i = start_; i < end_; i ++){
+            Boundary * bound = (*bounds_)[i];
+            Cell * left = bound->leftCell();
+            Cell * right = bound->rightCell();
+            if (!left || !right) continue;
+
+            Index lFace = faceIndex__(*left, *bound);
+            Index rFace = faceIndex__(*right, *bound);
+            if (lFace == left->boundaryCount() || rFace == right->boundaryCount()){
+                (*complete_)[tNr] = 0;
+                return;
+            }
+            left->setNeighbourCell(lFace, right);
+            right->setNeighbourCell(rFace, left);
+        }
+    }
+
+protected:
+    const std::vector < Boundary * > * bounds_;
+    std::vector < int > * complete_;
+};
+
+//** the arrays of a binary mesh file, either in place in the mapped file
+//** (v2) or decoded into buffers (v3), none of them needs to be aligned
+struct MeshFileSections{
+    Index nNodes;
+    const char * coord;         // double[3 * nNodes]
+    const char * nodeMarker;    // int32[nNodes]
+    Index nCells;
+    const uint8 * cellVerts;    // uint8[nCells]
+    const char * cellIdx;       // uint32[sum(cellVerts)]
+    const char * cellMarker;    // int32[nCells]
+    Index nBounds;
+    const uint8 * boundVerts;   // uint8[nBounds]
+    const char * boundIdx;      // uint32[sum(boundVerts)]
+    const char * boundMarker;   // int32[nBounds]
+    const char * leftCells;     // int32[nBounds]
+    const char * rightCells;    // int32[nBounds]
+};
+
+template < class SizeType > void readExportData__(MappedReader & in, Mesh & mesh){
+    SizeType nData = in.read< SizeType >();
+
+    for (Index i = 0; i < nData; i ++){
+        SizeType strLen = in.read< SizeType >();
+        const char * str = in.section< char >(strLen);
+        SizeType datLen = in.read< SizeType >();
+        const char * dat = in.section< double >(datLen);
+
+        RVector v(datLen);
+        if (datLen) std::memcpy(&v[0], dat, datLen * sizeof(double));
+        mesh.addData(std::string(str, strLen), v);
+    }
+}
+
+void Mesh::createFromSections_(const MeshFileSections & s, const std::string & fileName){
+    nodeVector_.reserve(s.nNodes);
+    for (Index i = 0; i < s.nNodes; i ++) {
+        this->createNode_(RVector3(MappedReader::at< double >(s.coord, i * 3),
+                                   MappedReader::at< double >(s.coord, i * 3 + 1),
+                                   MappedReader::at< double >(s.coord, i * 3 + 2)),
+                          MappedReader::at< int32 >(s.nodeMarker, i), -1);
+    }
+
+    //** create cells
+    std::vector < Node * > nodes;
+    Index count = 0;
+    cellVector_.reserve(s.nCells);
+    for (Index i = 0; i < s.nCells; i ++){
+        nodes.resize(s.cellVerts[i]);
+        for (Index j = 0; j < nodes.size(); j ++){
+            uint32 id = MappedReader::at< uint32 >(s.cellIdx, count + j);
+            if (id >= s.nNodes){
+                throwError(1, WHERE_AM_I + " " + fileName + ": cell " + str(i) +
+                           " node index out of range " + str(id));
+            }
+            nodes[j] = nodeVector_[id];
+        }
+        this->createCell(nodes, MappedReader::at< int32 >(s.cellMarker, i));
+        count += s.cellVerts[i];
+    }
+
+    //** create bounds, they have been unique when saved so the search
+    //** for an existing boundary is skipped
+    count = 0;
+    Index nSides = 0;
+    boundaryVector_.reserve(s.nBounds);
+    for (Index i = 0; i < s.nBounds; i ++){
+        nodes.resize(s.boundVerts[i]);
+        for (Index j = 0; j < nodes.size(); j ++){
+            uint32 id = MappedReader::at< uint32 >(s.boundIdx, count + j);
+            if (id >= s.nNodes){
+                throwError(1, WHERE_AM_I + " " + fileName + ": boundary " + str(i) +
+                           " node index out of range " + str(id));
+            }
+            nodes[j] = nodeVector_[id];
+        }
+
+        Boundary * bound = this->createBoundaryUnchecked_(nodes, MappedReader::at< int32 >(s.boundMarker, i));
+        count += s.boundVerts[i];
+
+        int32 left = MappedReader::at< int32 >(s.leftCells, i);
+        int32 right = MappedReader::at< int32 >(s.rightCells, i);
+        if (left >= (int32)cellCount() || right >= (int32)cellCount()){
+            throwError(1, WHERE_AM_I + " " + fileName + ": boundary " + str(i) +
+                       " cell index out of range " + str(left) + " " + str(right));
+        }
+        if (left > -1) { bound->setLeftCell(cellVector_[left]); nSides ++; }
+        if (right > -1) { bound->setRightCell(cellVector_[right]); nSides ++; }
+    }
+
+    //** if every cell face has a stored boundary with its cells, the
+    //** neighbour infos are complete and createNeighbourInfos can be skipped
+    Index nFaces = 0;
+    for (Index i = 0; i < cellCount(); i ++) nFaces += cellVector_[i]->boundaryCount();
+
+    if (nFaces > 0 && nFaces == nSides){
+        Index nThreads = std::max(Index(1), std::min(Index(threadCount()),
+                                                      Index(s.nBounds / 10000)));
+        std::vector < int > complete(nThreads, 1);
+        distributeCalc(NeighbourCellsMT(boundaryVector_, complete), s.nBounds, nThreads);
+
+        if (std::find(complete.begin(), complete.end(), 0) == complete.end()){
+            neighboursKnown_ = true;
+        } else {
+            for (Index i = 0; i < cellCount(); i ++) cellVector_[i]->cleanNeighbourInfos();
+        }
+    }
+}
+
 void Mesh::loadBinaryV2(const std::string & fbody) {
     this->clear();
     std::string fileName(fbody.substr(0, fbody.rfind(MESHBINSUFFIX)) + MESHBINSUFFIX);
 
-    FILE *file;
-    file = fopen(fileName.c_str(), "r+b");
-
-    if (!file) {
-        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": " + strerror(errno));
-    }
+    //** the sections are read directly from the mapped file
+    MappedFile file(fileName);
+    MappedReader in(file);
 
-    uint8 dim; readFromFile(file, dim);
+    uint8 dim = in.read< uint8 >();
     if (dim !=2 && dim !=3){
         throwError(1, WHERE_AM_I + " cannot determine dimension " + toStr(dim));
     }
+    uint8 version = in.read< uint8 >();
+    if (version == 3){
+        return loadBinaryV3(fbody);
+    }
+    if (version != 2){
+        throwError(1, WHERE_AM_I + " " + fileName + ": unknown format version " + toStr(int(version)));
+    }
     this->setDimension(dim);
-    uint8 version; readFromFile(file, version);
+
+    MeshFileSections s;
 
     //** read nodes
-    uint32 nVerts; readFromFile(file, nVerts);
+    s.nNodes = in.read< uint32 >();
 
-    if (nVerts > 1e9){
-        throwError(1, WHERE_AM_I + " probably something wrong: nVerts > 1e9 " + toStr(nVerts));
+    if (s.nNodes > 1e9){
+        throwError(1, WHERE_AM_I + " probably something wrong: nVerts > 1e9 " + toStr(s.nNodes));
     }
 
-    double * coord = new double[3 * nVerts]; readFromFile(file, coord[0], 3 * nVerts);
-    int32 * marker = new int32[nVerts]; readFromFile(file, marker[0], nVerts);
+    s.coord = in.section< double >(3 * s.nNodes);
+    s.nodeMarker = in.section< int32 >(s.nNodes);
 
-    nodeVector_.reserve(nVerts);
-    for (uint i = 0; i < nVerts; i ++) {
-        this->createNode(coord[i * 3], coord[i * 3 + 1], coord[i * 3 + 2], marker[i]);
+    //** read cells
+    s.nCells = in.read< uint32 >();
+    s.cellVerts = (const uint8 *)in.section< uint8 >(s.nCells);
+    Index nCellIdx = 0; for (Index i = 0; i < s.nCells; i ++) nCellIdx += s.cellVerts[i];
+    s.cellIdx = in.section< uint32 >(nCellIdx);
+    s.cellMarker = in.section< int32 >(s.nCells);
+
+    //** read bounds
+    s.nBounds = in.read< uint32 >();
+    s.boundVerts = (const uint8 *)in.section< uint8 >(s.nBounds);
+    Index nBoundIdx = 0; for (Index i = 0; i < s.nBounds; i ++) nBoundIdx += s.boundVerts[i];
+    s.boundIdx = in.section< uint32 >(nBoundIdx);
+    s.boundMarker = in.section< int32 >(s.nBounds);
+    s.leftCells = in.section< int32 >(s.nBounds);
+    s.rightCells = in.section< int32 >(s.nBounds);
+
+    this->createFromSections_(s, fileName);
+
+    if (!in.eof()) readExportData__< size_t >(in, *this);
+}
+
+//** sections of the binary format v3
+enum BinaryV3Section{ V3NodePos, V3NodeMarker,
+                      V3CellVerts, V3CellIdx, V3CellMarker,
+                      V3BoundVerts, V3BoundIdx, V3BoundMarker, V3BoundLeft, V3BoundRight,
+                      V3SectionCount };
+
+//** the entities a section is chunked by: 0 nodes, 1 cells, 2 boundaries
+static const int v3SectionEntity__[V3SectionCount] = {0, 0, 1, 1, 1, 2, 2, 2, 2, 2};
+
+//** variable length unsigned integer, 7 bit per byte, low bits first
+inline void putVarUInt__(std::vector < uint8 > & buf, uint64 v){
+    while (v >= 0x80){
+        buf.push_back(uint8(v | 0x80));
+        v >>= 7;
     }
+    buf.push_back(uint8(v));
+}
 
-    //** read cells
-    uint32 nCells; readFromFile(file, nCells);
-    uint8 * cellVerts = new uint8[nCells]; readFromFile(file, cellVerts[0], nCells);
-    uint nCellIdx = 0; for (uint i = 0; i < nCells; i ++) nCellIdx += cellVerts[i];
-    uint32 * cellIdx = new uint32[nCellIdx];   readFromFile(file, cellIdx[0], nCellIdx);
-    int32 * cellMarker = new int32[nCells]; readFromFile(file, cellMarker[0], nCells);
+//** zigzag mapping, so small negative values are small unsigned values too
+inline void putVarInt__(std::vector < uint8 > & buf, int64 v){
+    putVarUInt__(buf, (uint64(v) << 1) ^ uint64(v >> 63));
+}
 
-    //** create cells
-    uint count = 0;
-    cellVector_.reserve(nCells);
-    for (uint i = 0; i < nCells; i ++){
-        std::vector < Node * > nodes(cellVerts[i]);
-        for (uint j = 0; j < nodes.size(); j ++) nodes[j] = & node(cellIdx[count + j]);
-        this->createCell(nodes, cellMarker[i]);
-        count += cellVerts[i];
+//** runs of equal values, stored as difference to the previous run and length
+template < class Get > void putRuns__(std::vector < uint8 > & buf,
+                                      Index start, Index end, Get get){
+    int64 last = 0;
+    for (Index i = start; i < end;){
+        int64 v = get(i);
+        Index run = 1;
+        while (i + run < end && get(i + run) == v) run ++;
+        putVarInt__(buf, v - last);
+        putVarUInt__(buf, run);
+        last = v;
+        i += run;
     }
+}
 
-    //** read bounds
-    uint32 nBound;                                  readFromFile(file, nBound);
-    uint8 * boundVerts = new uint8[nBound];       readFromFile(file, boundVerts[0], nBound);
-    uint nBoundIdx = 0; for (uint i = 0; i < nBound; i ++) nBoundIdx += boundVerts[i];
-    uint32 * boundIdx = new uint32[nBoundIdx];    readFromFile(file, boundIdx[0], nBoundIdx);
-    int32 * boundMarker = new int32[nBound];      readFromFile(file, boundMarker[0], nBound);
-    int32 * leftCells = new int32[nBound];        readFromFile(file, leftCells[0], nBound);
-    int32 * rightCells = new int32[nBound];       readFromFile(file, rightCells[0], nBound);
+//** differences to the previous value
+template < class Get > void putDeltas__(std::vector < uint8 > & buf,
+                                        Index start, Index end, Get get){
+    int64 last = 0;
+    for (Index i = start; i < end; i ++){
+        int64 v = get(i);
+        putVarInt__(buf, v - last);
+        last = v;
+    }
+}
 
-    //** create cells
-    count = 0;
-    boundaryVector_.reserve(nBound);
-    for (uint i = 0; i < nBound; i ++){
-        std::vector < Node * > nodes(boundVerts[i]);
-        for (uint j = 0; j < nodes.size(); j ++) nodes[j] = & node(boundIdx[count + j]);
+//** bounds checked reader for one chunk of the binary format v3
+class BinaryV3Chunk{
+public:
+    BinaryV3Chunk(const char * data, Index size)
+        : data_((const uint8 *)data), size_(size), pos_(0){
+    }
 
-        Boundary * bound = this->createBoundary(nodes, boundMarker[i]);
-        count += boundVerts[i];
+    inline uint8 byte(){
+        if (pos_ >= size_) throwError(1, WHERE_AM_I + " corrupt chunk");
+        return data_[pos_ ++];
+    }
+
+    inline uint64 varUInt(){
+        uint64 v = 0;
+        for (Index shift = 0; shift < 64; shift += 7){
+            uint8 b = byte();
+            v |= uint64(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throwError(1, WHERE_AM_I + " corrupt chunk");
+        return v;
+    }
+
+    inline int64 varInt(){
+        uint64 u = varUInt();
+        return int64(u >> 1) ^ -int64(u & 1);
+    }
+
+    template < class ValueType > void runs(ValueType * out, Index n){
+        int64 last = 0;
+        for (Index i = 0; i < n;){
+            last += varInt();
+            uint64 run = varUInt();
+            if (run == 0 || run > n - i) throwError(1, WHERE_AM_I + " corrupt chunk");
+            std::fill(out + i, out + i + run, ValueType(last));
+            i += run;
+        }
+    }
+
+    template < class ValueType > void deltas(ValueType * out, Index n){
+        int64 last = 0;
+        for (Index i = 0; i < n; i ++){
+            last += varInt();
+            out[i] = ValueType(last);
+        }
+    }
+
+    inline bool end() const { return pos_ == size_; }
+
+protected:
+    const uint8 * data_;
+    Index size_;
+    Index pos_;
+};
+
+//** lossless coordinates: xor with the previous coordinate, the leading
+//** and trailing zero bytes are skipped and counted in a control byte
+inline void putXorDouble__(std::vector < uint8 > & buf, double v, uint64 & last){
+    uint64 bits; std::memcpy(&bits, &v, sizeof(double));
+    uint64 x = bits ^ last;
+    last = bits;
+    if (x == 0){
+        buf.push_back(0);
+        return;
+    }
+    Index lead = 0, trail = 0;
+    while (!(x >> (56 - 8 * lead) & 0xff)) lead ++;
+    while (!(x >> (8 * trail) & 0xff)) trail ++;
+    buf.push_back(uint8(1 + 8 * lead + trail));
+    for (Index i = trail; i < 8 - lead; i ++) buf.push_back(uint8(x >> (8 * i)));
+}
+
+inline double getXorDouble__(BinaryV3Chunk & in, uint64 & last){
+    uint8 ctrl = in.byte();
+    if (ctrl > 0){
+        Index lead = (ctrl - 1) / 8, trail = (ctrl - 1) % 8;
+        if (lead + trail > 7) throwError(1, WHERE_AM_I + " corrupt chunk");
+        uint64 x = 0;
+        for (Index i = trail; i < 8 - lead; i ++) x |= uint64(in.byte()) << (8 * i);
+        last ^= x;
+    }
+    double v; std::memcpy(&v, &last, sizeof(double));
+    return v;
+}
+
+//** header of the binary format v3 with the chunk index of all sections
+class BinaryV3Header{
+public:
+    //** read and check the header, the reader is left at the payload
+    BinaryV3Header(MappedReader & in, const std::string & fileName)
+        : fileName_(fileName){
+        dim = in.read< uint8 >();
+        if (dim !=2 && dim !=3){
+            throwError(1, WHERE_AM_I + " cannot determine dimension " + toStr(dim));
+        }
+        uint8 version = in.read< uint8 >();
+        if (version != 3){
+            throwError(1, WHERE_AM_I + " " + fileName + ": unknown format version " + toStr(int(version)));
+        }
+        in.read< uint8 >(); in.read< uint8 >(); // reserved
+        nEntities[0] = in.read< uint64 >();
+        nEntities[1] = in.read< uint64 >();
+        nEntities[2] = in.read< uint64 >();
+        chunkSize = in.read< uint64 >();
+        quantum = in.read< double >();
+        //** the bounds keep the chunk counts and first values free of overflows
+        if (chunkSize == 0 || chunkSize > 4e9 ||
+            nEntities[0] > 4e9 || nEntities[1] > 4e9 || nEntities[2] > 4e9){
+            throwError(1, WHERE_AM_I + " " + fileName + ": corrupt header");
+        }
+        if (in.read< uint32 >() != V3SectionCount){
+            throwError(1, WHERE_AM_I + " " + fileName + ": unknown section count");
+        }
+
+        //** offset in the payload and position of the first value of
+        //** every chunk, the last entry holds the size and the value count
+        for (Index s = 0; s < V3SectionCount; s ++){
+            Index nChunks = this->chunkCount(s);
+            offset[s].resize(nChunks + 1);
+            first[s].resize(nChunks + 1);
+            const char * table = in.section< uint64 >(2 * (nChunks + 1));
+            for (Index k = 0; k <= nChunks; k ++){
+                offset[s][k] = MappedReader::at< uint64 >(table, 2 * k);
+                first[s][k] = MappedReader::at< uint64 >(table, 2 * k + 1);
+                if (k > 0 && (offset[s][k] < offset[s][k - 1] || first[s][k] < first[s][k - 1])){
+                    throwError(1, WHERE_AM_I + " " + fileName + ": corrupt chunk index");
+                }
+            }
+            if (first[s][0] != 0 || offset[s][0] != (s > 0 ? offset[s - 1].back() : 0)){
+                throwError(1, WHERE_AM_I + " " + fileName + ": corrupt chunk index");
+            }
+            //** all sections but the node indices have fixed value counts
+            Index n = nEntities[v3SectionEntity__[s]];
+            if (s == V3CellIdx || s == V3BoundIdx){
+                if (first[s].back() > 255 * n){
+                    throwError(1, WHERE_AM_I + " " + fileName + ": corrupt chunk index");
+                }
+            } else {
+                if (first[s].back() != n * (s == V3NodePos ? 3 : 1)){
+                    throwError(1, WHERE_AM_I + " " + fileName + ": corrupt chunk index");
+                }
+                for (Index k = 0; k <= nChunks; k ++){
+                    Index f = std::min(k * chunkSize, n) * (s == V3NodePos ? 3 : 1);
+                    if (first[s][k] != f){
+                        throwError(1, WHERE_AM_I + " " + fileName + ": corrupt chunk index");
+                    }
+                }
+            }
+        }
+        payload = in.section< uint8 >(offset[V3SectionCount - 1].back());
+    }
+
+    inline Index chunkCount(Index s) const {
+        return (nEntities[v3SectionEntity__[s]] + chunkSize - 1) / chunkSize;
+    }
+
+    inline Index valueCount(Index s) const { return first[s].back(); }
+
+    /*! Decode chunk k of section s into out, the array for all values of
+     * the section. */
+    void decode(Index s, Index k, void * out) const {
+        BinaryV3Chunk in(payload + offset[s][k], offset[s][k + 1] - offset[s][k]);
+        Index pos = first[s][k];
+        Index n = first[s][k + 1] - pos;
+
+        switch (s){
+        case V3NodePos:{
+            double * coord = (double *)out + pos;
+            Index nNodes = n / 3;
+            for (Index d = 0; d < 3; d ++){
+                uint64 last = 0;
+                for (Index i = 0; i < nNodes; i ++){
+                    if (quantum > 0.0){
+                        last += in.varInt();
+                        coord[3 * i + d] = int64(last) * quantum;
+                    } else {
+                        coord[3 * i + d] = getXorDouble__(in, last);
+                    }
+                }
+            }
+        } break;
+        case V3CellVerts:
+        case V3BoundVerts:
+            in.runs((uint8 *)out + pos, n); break;
+        case V3CellIdx:
+        case V3BoundIdx:
+            in.deltas((uint32 *)out + pos, n); break;
+        case V3BoundLeft:
+        case V3BoundRight:
+            in.deltas((int32 *)out + pos, n); break;
+        default: // markers
+            in.runs((int32 *)out + pos, n); break;
+        }
+        if (!in.end()){
+            throwError(1, WHERE_AM_I + " " + fileName_ + ": corrupt chunk " + str(k) +
+                       " of section " + str(s));
+        }
+    }
+
+    /*! Throw if the node counts in chunk k of section s (cell or boundary
+     * nodes) don't match the size of the node index chunk. */
+    void checkVerts(Index s, Index k, const uint8 * verts) const {
+        Index sum = 0;
+        Index start = k * chunkSize;
+        Index end = std::min(start + chunkSize, Index(nEntities[v3SectionEntity__[s]]));
+        for (Index i = start; i < end; i ++) sum += verts[i];
+        if (sum != first[s + 1][k + 1] - first[s + 1][k]){
+            throwError(1, WHERE_AM_I + " " + fileName_ + ": corrupt node count in chunk " + str(k));
+        }
+    }
+
+    uint8 dim;
+    Index nEntities[3];
+    Index chunkSize;
+    double quantum;
+    std::vector < uint64 > offset[V3SectionCount];
+    std::vector < uint64 > first[V3SectionCount];
+    const char * payload;
+
+protected:
+    std::string fileName_;
+};
+
+/*! Encode the chunks given as pairs of section and chunk index. */
+class EncodeBinaryV3MT : public BaseCalcMT{
+public:
+    EncodeBinaryV3MT(const Mesh & mesh, const std::vector < Index > & tasks,
+                     Index chunkSize, double quantum,
+                     std::vector < std::vector < uint8 > > & bufs,
+                     bool verbose=false)
+        : BaseCalcMT(1, verbose), mesh_(&mesh), tasks_(&tasks),
+          chunkSize_(chunkSize), quantum_(quantum), bufs_(&bufs){
+    }
+
+    virtual ~EncodeBinaryV3MT(){}
+
+    virtual void calc(Index tNr=0){
+        const Mesh & m = *mesh_;
+        for (Index t = start_; t < end_; t ++){
+            Index s = (*tasks_)[2 * t];
+            Index k = (*tasks_)[2 * t + 1];
+            std::vector < uint8 > & buf = (*bufs_)[t];
+
+            Index n = 0;
+            switch (v3SectionEntity__[s]){
+                case 0: n = m.nodeCount(); break;
+                case 1: n = m.cellCount(); break;
+                case 2: n = m.boundaryCount(); break;
+            }
+            Index start = k * chunkSize_;
+            Index end = std::min(start + chunkSize_, n);
+
+            switch (s){
+            case V3NodePos:
+                for (Index d = 0; d < 3; d ++){
+                    int64 lastQ = 0;
+                    uint64 last = 0;
+                    for (Index i = start; i < end; i ++){
+                        double v = m.node(i).pos()[d];
+                        if (quantum_ > 0.0){
+                            int64 q = (int64)std::floor(v / quantum_ + 0.5);
+                            putVarInt__(buf, q - lastQ);
+                            lastQ = q;
+                        } else {
+                            putXorDouble__(buf, v, last);
+                        }
+                    }
+                } break;
+            case V3NodeMarker:
+                putRuns__(buf, start, end, [&](Index i){ return int64(m.node(i).marker()); }); break;
+            case V3CellVerts:
+                putRuns__(buf, start, end, [&](Index i){ return int64(m.cell(i).nodeCount()); }); break;
+            case V3CellMarker:
+                putRuns__(buf, start, end, [&](Index i){ return int64(m.cell(i).marker()); }); break;
+            case V3BoundVerts:
+                putRuns__(buf, start, end, [&](Index i){ return int64(m.boundary(i).nodeCount()); }); break;
+            case V3BoundMarker:
+                putRuns__(buf, start, end, [&](Index i){ return int64(m.boundary(i).marker()); }); break;
+            case V3BoundLeft:
+                putDeltas__(buf, start, end, [&](Index i){
+                    Boundary & b = m.boundary(i);
+                    return b.leftCell() ? int64(b.leftCell()->id()) : int64(-1); }); break;
+            case V3BoundRight:
+                putDeltas__(buf, start, end, [&](Index i){
+                    Boundary & b = m.boundary(i);
+                    return b.rightCell() ? int64(b.rightCell()->id()) : int64(-1); }); break;
+            case V3CellIdx:{
+                int64 last = 0;
+                for (Index i = start; i < end; i ++){
+                    const Cell & c = m.cell(i);
+                    for (Index j = 0; j < c.nodeCount(); j ++){
+                        putVarInt__(buf, int64(c.node(j).id()) - last);
+                        last = c.node(j).id();
+                    }
+                }
+            } break;
+            case V3BoundIdx:{
+                int64 last = 0;
+                for (Index i = start; i < end; i ++){
+                    const Boundary & b = m.boundary(i);
+                    for (Index j = 0; j < b.nodeCount(); j ++){
+                        putVarInt__(buf, int64(b.node(j).id()) - last);
+                        last = b.node(j).id();
+                    }
+                }
+            } break;
+            }
+        }
+    }
+
+protected:
+    const Mesh * mesh_;
+    const std::vector < Index > * tasks_;
+    Index chunkSize_;
+    double quantum_;
+    std::vector < std::vector < uint8 > > * bufs_;
+};
+
+/*! Decode the chunks given as pairs of section and chunk index into the
+ * arrays of the sections. The first error is rethrown by \ref distributeCalc. */
+class DecodeBinaryV3MT : public BaseCalcMT{
+public:
+    DecodeBinaryV3MT(const BinaryV3Header & header, const std::vector < Index > & tasks,
+                     const std::vector < void * > & arrays, bool verbose=false)
+        : BaseCalcMT(1, verbose), header_(&header), tasks_(&tasks), arrays_(&arrays){
+    }
+
+    virtual ~DecodeBinaryV3MT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index t = start_; t < end_; t ++){
+            Index s = (*tasks_)[2 * t];
+            header_->decode(s, (*tasks_)[2 * t + 1], (*arrays_)[s]);
+        }
+    }
+
+protected:
+    const BinaryV3Header * header_;
+    const std::vector < Index > * tasks_;
+    const std::vector < void * > * arrays_;
+};
+
+//** decoded sections of the binary format v3
+class BinaryV3Arrays{
+public:
+    BinaryV3Arrays(const BinaryV3Header & header)
+        : ptr(V3SectionCount, (void *)NULL), header_(&header){
+    }
+
+    //** allocate the array for section s
+    void resize(Index s){
+        Index n = header_->valueCount(s);
+        switch (s){
+            case V3NodePos: coord.resize(n); ptr[s] = coord.data(); break;
+            case V3NodeMarker: nodeMarker.resize(n); ptr[s] = nodeMarker.data(); break;
+            case V3CellVerts: cellVerts.resize(n); ptr[s] = cellVerts.data(); break;
+            case V3CellIdx: cellIdx.resize(n); ptr[s] = cellIdx.data(); break;
+            case V3CellMarker: cellMarker.resize(n); ptr[s] = cellMarker.data(); break;
+            case V3BoundVerts: boundVerts.resize(n); ptr[s] = boundVerts.data(); break;
+            case V3BoundIdx: boundIdx.resize(n); ptr[s] = boundIdx.data(); break;
+            case V3BoundMarker: boundMarker.resize(n); ptr[s] = boundMarker.data(); break;
+            case V3BoundLeft: left.resize(n); ptr[s] = left.data(); break;
+            case V3BoundRight: right.resize(n); ptr[s] = right.data(); break;
+        }
+    }
+
+    //** decode the chunks given as pairs of section and chunk index
+    void decode(const std::vector < Index > & tasks, Index nThreads){
+        Index nTasks = tasks.size() / 2;
+        if (nTasks == 0) return;
+        if (nThreads == 0) nThreads = threadCount();
+        nThreads = std::max(Index(1), std::min(nThreads, nTasks));
+
+        distributeCalc(DecodeBinaryV3MT(*header_, tasks, ptr), nTasks, nThreads);
+    }
+
+    std::vector < double > coord;
+    std::vector < int32 > nodeMarker, cellMarker, boundMarker, left, right;
+    std::vector < uint8 > cellVerts, boundVerts;
+    std::vector < uint32 > cellIdx, boundIdx;
+
+    //** start of the array of every section, NULL if not allocated
+    std::vector < void * > ptr;
+
+protected:
+    const BinaryV3Header * header_;
+};
+
+void Mesh::saveBinaryV3(const std::string & fbody, double quantum,
+                        Index chunkSize, Index nThreads) const {
+//   uint8[1] dimension
+//   uint8[1] file format version (3)
+//   uint8[2] reserved
+//   uint64[3] number of nodes, cells and boundaries
+//   uint64[1] chunkSize, number of nodes, cells or boundaries per chunk
+//   double[1] quantum of the coordinates, 0 for lossless coordinates
+//   uint32[1] number of sections (10)
+//   for every section: uint64[2 * (nChunks + 1)] payload offset and first
+//       value of every chunk, the last pair holds the end of the section
+//       and its value count
+//   uint8[] payload, the chunks of the sections:
+//       coordinates x, y, z of the nodes one after another,
+//       node markers, cell node counts, cell node indices, cell markers,
+//       boundary node counts, boundary node indices, boundary markers,
+//       left cells, right cells (-1 if none)
+//   uint64[1] nData, then for every export data
+//       uint64[1] name length, char[] name, uint64[1] length, double[] values
+    std::string fileName(fbody.substr(0, fbody.rfind(MESHBINSUFFIX)) + MESHBINSUFFIX);
+
+    if (chunkSize == 0 || chunkSize > 4e9){
+        throwError(1, WHERE_AM_I + " chunkSize must be in [1, 4e9]: " + str(chunkSize));
+    }
+    if (quantum > 0.0){
+        double maxAbs = 0.0;
+        for (Index i = 0; i < this->nodeCount(); i ++){
+            for (Index d = 0; d < 3; d ++) maxAbs = std::max(maxAbs, std::fabs(node(i).pos()[d]));
+        }
+        if (maxAbs / quantum > 4e18){
+            throwError(1, WHERE_AM_I + " quantum too small for the mesh extent: " + str(quantum));
+        }
+    }
+
+    Index n[3] = {this->nodeCount(), this->cellCount(), this->boundaryCount()};
+
+    std::vector < Index > tasks;
+    for (Index s = 0; s < V3SectionCount; s ++){
+        Index nChunks = (n[v3SectionEntity__[s]] + chunkSize - 1) / chunkSize;
+        for (Index k = 0; k < nChunks; k ++){
+            tasks.push_back(s);
+            tasks.push_back(k);
+        }
+    }
+    Index nTasks = tasks.size() / 2;
 
-        if (leftCells[i] > -1) bound->setLeftCell(&this->cell(leftCells[i]));
-        if (rightCells[i] > -1) bound->setRightCell(&this->cell(rightCells[i]));
+    std::vector < std::vector < uint8 > > bufs(nTasks);
+    if (nTasks > 0){
+        if (nThreads == 0) nThreads = threadCount();
+        nThreads = std::max(Index(1), std::min(nThreads, nTasks));
+        distributeCalc(EncodeBinaryV3MT(*this, tasks, chunkSize, quantum, bufs),
+                       nTasks, nThreads);
     }
 
-    size_t nData; readFromFile(file, nData);
+    FILE *file;
+    file = fopen(fileName.c_str(), "w+b");
+    if (!file) {
+        throwError(EXIT_OPEN_FILE, WHERE_AM_I + " " + fileName + ": " + strerror(errno));
+    }
 
-    for (uint i = 0; i < nData; i ++){
-        size_t strLen; readFromFile(file, strLen);
-        std::string str; str.resize(strLen); readFromFile(file, str[0], strLen);
-        size_t datLen; readFromFile(file, datLen);
+    writeToFile(file, uint8(this->dimension()));
+    writeToFile(file, uint8(3));
+    writeToFile(file, uint8(0));
+    writeToFile(file, uint8(0));
+    for (Index i = 0; i < 3; i ++) writeToFile(file, uint64(n[i]));
+    writeToFile(file, uint64(chunkSize));
+    writeToFile(file, quantum);
+    writeToFile(file, uint32(V3SectionCount));
+
+    //** the chunk index
+    uint64 offset = 0;
+    Index t = 0;
+    std::vector < uint64 > table;
+    for (Index s = 0; s < V3SectionCount; s ++){
+        uint64 first = 0;
+        table.clear();
+        Index start = 0;
+        for (; t < nTasks && tasks[2 * t] == s; t ++){
+            table.push_back(offset);
+            table.push_back(first);
+            offset += bufs[t].size();
+
+            Index end = std::min(start + chunkSize, n[v3SectionEntity__[s]]);
+            switch (s){
+                case V3NodePos: first += 3 * (end - start); break;
+                case V3CellIdx:
+                    for (Index i = start; i < end; i ++) first += cell(i).nodeCount();
+                    break;
+                case V3BoundIdx:
+                    for (Index i = start; i < end; i ++) first += boundary(i).nodeCount();
+                    break;
+                default: first += end - start; break;
+            }
+            start = end;
+        }
+        table.push_back(offset);
+        table.push_back(first);
+        writeToFile(file, table[0], table.size());
+    }
 
-        RVector dat(datLen); readFromFile(file, dat[0], datLen);
-        this->addData(str, dat);
-        //delete [] str;
+    for (Index i = 0; i < nTasks; i ++){
+        writeToFile(file, bufs[i][0], bufs[i].size());
+    }
+
+    writeToFile(file, uint64(exportDataMap_.size()));
+    for (std::map < std::string, RVector >::const_iterator it = exportDataMap_.begin(); it != exportDataMap_.end(); it ++){
+        writeToFile(file, uint64(it->first.length()));
+        writeToFile(file, it->first[0], it->first.length());
+        writeToFile(file, uint64(it->second.size()));
+        writeToFile(file, it->second[0], it->second.size());
     }
 
     fclose(file);
+}
 
-    delete [] coord;
-    delete [] marker;
-    delete [] cellVerts;
-    delete [] cellIdx;
-    delete [] cellMarker;
-    delete [] boundVerts;
-    delete [] boundIdx;
-    delete [] boundMarker;
-    delete [] leftCells;
-    delete [] rightCells;
+void Mesh::loadBinaryV3(const std::string & fbody, Index nThreads) {
+    this->clear();
+    std::string fileName(fbody.substr(0, fbody.rfind(MESHBINSUFFIX)) + MESHBINSUFFIX);
+
+    MappedFile file(fileName);
+    MappedReader in(file);
+    BinaryV3Header header(in, fileName);
+    this->setDimension(header.dim);
+
+    //** all chunks are independent, decode everything at once
+    BinaryV3Arrays a(header);
+    std::vector < Index > tasks;
+    for (Index s = 0; s < V3SectionCount; s ++){
+        a.resize(s);
+        for (Index k = 0; k < header.chunkCount(s); k ++){
+            tasks.push_back(s);
+            tasks.push_back(k);
+        }
+    }
+    a.decode(tasks, nThreads);
+
+    for (Index k = 0; k < header.chunkCount(V3CellVerts); k ++){
+        header.checkVerts(V3CellVerts, k, (const uint8 *)a.ptr[V3CellVerts]);
+    }
+    for (Index k = 0; k < header.chunkCount(V3BoundVerts); k ++){
+        header.checkVerts(V3BoundVerts, k, (const uint8 *)a.ptr[V3BoundVerts]);
+    }
+
+    MeshFileSections s;
+    s.nNodes = header.nEntities[0];
+    s.coord = (const char *)a.ptr[V3NodePos];
+    s.nodeMarker = (const char *)a.ptr[V3NodeMarker];
+    s.nCells = header.nEntities[1];
+    s.cellVerts = (const uint8 *)a.ptr[V3CellVerts];
+    s.cellIdx = (const char *)a.ptr[V3CellIdx];
+    s.cellMarker = (const char *)a.ptr[V3CellMarker];
+    s.nBounds = header.nEntities[2];
+    s.boundVerts = (const uint8 *)a.ptr[V3BoundVerts];
+    s.boundIdx = (const char *)a.ptr[V3BoundIdx];
+    s.boundMarker = (const char *)a.ptr[V3BoundMarker];
+    s.leftCells = (const char *)a.ptr[V3BoundLeft];
+    s.rightCells = (const char *)a.ptr[V3BoundRight];
+
+    this->createFromSections_(s, fileName);
+
+    readExportData__< uint64 >(in, *this);
+}
+
+void Mesh::loadBinaryV3Cells(const std::string & fbody, Index start, Index end,
+                             Index nThreads) {
+    this->clear();
+    std::string fileName(fbody.substr(0, fbody.rfind(MESHBINSUFFIX)) + MESHBINSUFFIX);
+
+    MappedFile file(fileName);
+    MappedReader in(file);
+    BinaryV3Header header(in, fileName);
+    this->setDimension(header.dim);
+
+    if (start > end || end > header.nEntities[1]){
+        throwError(1, WHERE_AM_I + " " + fileName + ": cell range [" + str(start) +
+                   ", " + str(end) + ") exceeds the " + str(header.nEntities[1]) + " cells");
+    }
+
+    //** the cell chunks that hold the range
+    BinaryV3Arrays a(header);
+    Index kStart = start / header.chunkSize;
+    Index kEnd = (end + header.chunkSize - 1) / header.chunkSize;
+    std::vector < Index > tasks;
+    const Index cellSections[3] = {V3CellVerts, V3CellIdx, V3CellMarker};
+    for (Index i = 0; i < 3; i ++){
+        a.resize(cellSections[i]);
+        for (Index k = kStart; k < kEnd; k ++){
+            tasks.push_back(cellSections[i]);
+            tasks.push_back(k);
+        }
+    }
+    a.decode(tasks, nThreads);
+    for (Index k = kStart; k < kEnd; k ++){
+        header.checkVerts(V3CellVerts, k, a.cellVerts.data());
+    }
 
+    //** the used nodes in their original order and the chunks that hold them
+    Index idxStart = header.first[V3CellIdx][kStart];
+    for (Index i = kStart * header.chunkSize; i < start; i ++) idxStart += a.cellVerts[i];
+    Index idxEnd = idxStart;
+    for (Index i = start; i < end; i ++) idxEnd += a.cellVerts[i];
+
+    std::vector < uint32 > nodeIds(a.cellIdx.begin() + idxStart, a.cellIdx.begin() + idxEnd);
+    std::sort(nodeIds.begin(), nodeIds.end());
+    nodeIds.erase(std::unique(nodeIds.begin(), nodeIds.end()), nodeIds.end());
+    if (!nodeIds.empty() && nodeIds.back() >= header.nEntities[0]){
+        throwError(1, WHERE_AM_I + " " + fileName + ": node index out of range " + str(nodeIds.back()));
+    }
+
+    tasks.clear();
+    a.resize(V3NodePos);
+    a.resize(V3NodeMarker);
+    for (Index i = 0; i < nodeIds.size(); i ++){
+        Index k = nodeIds[i] / header.chunkSize;
+        if (tasks.empty() || tasks.back() != k){
+            tasks.push_back(V3NodePos);
+            tasks.push_back(k);
+        }
+    }
+    Index nNodeChunks = tasks.size() / 2;
+    for (Index i = 0; i < nNodeChunks; i ++){
+        tasks.push_back(V3NodeMarker);
+        tasks.push_back(tasks[2 * i + 1]);
+    }
+    a.decode(tasks, nThreads);
+
+    //** compact the used nodes and renumber the cell node indices
+    std::vector < double > coord(3 * nodeIds.size());
+    std::vector < int32 > nodeMarker(nodeIds.size());
+    for (Index i = 0; i < nodeIds.size(); i ++){
+        std::copy(&a.coord[3 * nodeIds[i]], &a.coord[3 * nodeIds[i]] + 3, &coord[3 * i]);
+        nodeMarker[i] = a.nodeMarker[nodeIds[i]];
+    }
+    std::vector < uint32 > cellIdx(idxEnd - idxStart);
+    for (Index i = 0; i < cellIdx.size(); i ++){
+        cellIdx[i] = std::lower_bound(nodeIds.begin(), nodeIds.end(),
+                                      a.cellIdx[idxStart + i]) - nodeIds.begin();
+    }
+
+    MeshFileSections s;
+    s.nNodes = nodeIds.size();
+    s.coord = (const char *)coord.data();
+    s.nodeMarker = (const char *)nodeMarker.data();
+    s.nCells = end - start;
+    s.cellVerts = a.cellVerts.data() + start;
+    s.cellIdx = (const char *)cellIdx.data();
+    s.cellMarker = (const char *)(a.cellMarker.data() + start);
+    s.nBounds = 0;
+
+    this->createFromSections_(s, fileName);
+}
+
+IVector loadCellMarkersBinaryV3(const std::string & fbody, Index nThreads){
+    std::string fileName(fbody.substr(0, fbody.rfind(MESHBINSUFFIX)) + MESHBINSUFFIX);
+
+    MappedFile file(fileName);
+    MappedReader in(file);
+    BinaryV3Header header(in, fileName);
+
+    BinaryV3Arrays a(header);
+    std::vector < Index > tasks;
+    a.resize(V3CellMarker);
+    for (Index k = 0; k < header.chunkCount(V3CellMarker); k ++){
+        tasks.push_back(V3CellMarker);
+        tasks.push_back(k);
+    }
+    a.decode(tasks, nThreads);
+
+    IVector ret(a.cellMarker.size());
+    for (Index i = 0; i < ret.size(); i ++) ret[i] = a.cellMarker[i];
+    return ret;
 }
 
 int Mesh::exportSimple(const std::string & fbody, const RVector & data) const {
@@ -762,9 +1587,9 @@ void Mesh::exportVTK(const std::string & fbody,
                     case MESH_TETRAHEDRON_RTTI: file   << "10 "; break;
                     case MESH_TETRAHEDRON10_RTTI: file << "24 "; break;
                     case MESH_TRIPRISM_RTTI: file      << "13 "; break;
-                    case MESH_TRIPRISM15_RTTI: file    << "13 "; break;
+                    case MESH_TRIPRISM15_RTTI: file    << "26 "; break;
                     case MESH_PYRAMID_RTTI: file       << "14 "; break;
-                    case MESH_PYRAMID13_RTTI: file     << "14 "; break;
+                    case MESH_PYRAMID13_RTTI: file     << "27 "; break;
                     case MESH_HEXAHEDRON_RTTI: file    << "12 "; break;
                     case MESH_HEXAHEDRON20_RTTI: file  << "25 "; break;
                     default:
@@ -1179,15 +2004,292 @@ void Mesh::importVTU(const std::string & fbody) {
     THROW_TO_IMPL
 }
 
+//** VTK cell type of a mesh entity, 0 if unknown
+inline uint8 vtkCellType__(uint rtti){
+    switch (rtti){
+        case MESH_BOUNDARY_NODE_RTTI: return 1;
+        case MESH_EDGE_CELL_RTTI:
+        case MESH_EDGE_RTTI: return 3;
+        case MESH_EDGE3_CELL_RTTI:
+        case MESH_EDGE3_RTTI: return 21;
+        case MESH_TRIANGLEFACE_RTTI:
+        case MESH_TRIANGLE_RTTI: return 5;
+        case MESH_TRIANGLEFACE6_RTTI:
+        case MESH_TRIANGLE6_RTTI: return 22;
+        case MESH_QUADRANGLEFACE_RTTI:
+        case MESH_QUADRANGLE_RTTI: return 9;
+        case MESH_QUADRANGLEFACE8_RTTI:
+        case MESH_QUADRANGLE8_RTTI: return 23;
+        case MESH_TETRAHEDRON_RTTI: return 10;
+        case MESH_TETRAHEDRON10_RTTI: return 24;
+        case MESH_TRIPRISM_RTTI: return 13;
+        //** the edge nodes of the quadratic prism and pyramid are in VTK order
+        case MESH_TRIPRISM15_RTTI: return 26;
+        case MESH_PYRAMID_RTTI: return 14;
+        case MESH_PYRAMID13_RTTI: return 27;
+        case MESH_HEXAHEDRON_RTTI: return 12;
+        case MESH_HEXAHEDRON20_RTTI: return 25;
+        default: return 0;
+    }
+}
+
+/*! Writes consecutive ranges of cells (or boundaries of a boundary mesh)
+ * with the data arrays as VTU files. All arrays are stored as raw binary
+ * blocks in the appended data section, so no value is formatted. */
+class VTUAppendedWriter{
+public:
+    VTUAppendedWriter(const Mesh & mesh, const std::map < std::string, RVector > & data)
+        : mesh_(&mesh), cellsAreBoundaries_(false){
+        if (mesh.cellCount() == 0 && mesh.boundaryCount() > 0){
+            cellsAreBoundaries_ = true;
+            cells_.reserve(mesh.boundaryCount());
+            for (Index i = 0; i < mesh.boundaryCount(); i ++) cells_.push_back(& mesh.boundary(i));
+        } else {
+            cells_.reserve(mesh.cellCount());
+            for (Index i = 0; i < mesh.cellCount(); i ++) cells_.push_back(& mesh.cell(i));
+        }
+
+        for (std::map < std::string, RVector >::const_iterator it = data.begin();
+             it != data.end(); it ++){
+            //** node count == cell count for cellsAreBoundaries (2d)
+            if (it->second.size() == mesh.nodeCount() && !cellsAreBoundaries_) {
+                nodeData_.push_back(it);
+            } else if (it->second.size() == cells_.size()) {
+                cellData_.push_back(it);
+            } else {
+                std::cerr << WHERE_AM_I << " dont know how to handle data array: " << it->first
+                          << " with size " << it->second.size() << " nodesize = " << mesh.nodeCount()
+                          << " cellsize = " << cells_.size() << std::endl;
+            }
+        }
+    }
+
+    inline Index cellCount() const { return cells_.size(); }
+
+    /*! Write the cells [start, end) to fileName. If they are all cells,
+     * all nodes are written in their order, else only the nodes of the
+     * cells. Return false if the file cannot be written. */
+    bool write(const std::string & fileName, Index start, Index end) const {
+        const Mesh & mesh = *mesh_;
+        bool full = (start == 0 && end == cells_.size());
+
+        //** the global ids of the written nodes, sorted
+        std::vector < Index > nodes;
+        if (!full){
+            for (Index i = start; i < end; i ++){
+                for (Index j = 0; j < cells_[i]->nodeCount(); j ++){
+                    nodes.push_back(cells_[i]->node(j).id());
+                }
+            }
+            std::sort(nodes.begin(), nodes.end());
+            nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        }
+        Index nNodes = full ? mesh.nodeCount() : nodes.size();
+
+        std::vector < double > points(3 * nNodes);
+        for (Index i = 0; i < nNodes; i ++){
+            const RVector3 & p = mesh.node(full ? i : nodes[i]).pos();
+            points[3 * i] = p[0];
+            points[3 * i + 1] = p[1];
+            points[3 * i + 2] = p[2];
+        }
+
+        std::vector < int64 > connectivity;
+        std::vector < int64 > offsets(end - start);
+        std::vector < uint8 > types(end - start);
+        static const Index tet10[10] = {0, 1, 2, 3, 4, 7, 5, 6, 9, 8};
+        for (Index i = start; i < end; i ++){
+            const MeshEntity & cell = *cells_[i];
+            for (Index j = 0; j < cell.nodeCount(); j ++){
+                Index k = (cell.rtti() == MESH_TETRAHEDRON10_RTTI) ? tet10[j] : j;
+                Index id = cell.node(k).id();
+                if (!full) id = std::lower_bound(nodes.begin(), nodes.end(), id) - nodes.begin();
+                connectivity.push_back(id);
+            }
+            offsets[i - start] = connectivity.size();
+            types[i - start] = vtkCellType__(cell.rtti());
+            if (types[i - start] == 0){
+                std::cerr << WHERE_AM_I << " nothing know about." << cell.rtti() << std::endl;
+            }
+        }
+
+        //** node data of a part has to be gathered, cell data is a slice
+        std::vector < std::vector < double > > nodeValues(full ? 0 : nodeData_.size());
+        for (Index d = 0; d < nodeValues.size(); d ++){
+            const RVector & v = nodeData_[d]->second;
+            nodeValues[d].resize(nNodes);
+            for (Index i = 0; i < nNodes; i ++) nodeValues[d][i] = v[nodes[i]];
+        }
+
+        std::vector < const char * > blocks;
+        std::vector < uint64 > blockSize;
+        std::stringstream xml;
+        uint64 offset = 0;
+        xml << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" "
+               "byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+            << "<UnstructuredGrid>\n"
+            << "<Piece NumberOfPoints=\"" << nNodes << "\" NumberOfCells=\"" << end - start << "\">\n"
+            << "<Points>\n";
+        addArray_(xml, blocks, blockSize, offset, "Float64", "", 3,
+                  (const char *)points.data(), points.size() * sizeof(double));
+        xml << "</Points>\n" << "<Cells>\n";
+        addArray_(xml, blocks, blockSize, offset, "Int64", "connectivity", 1,
+                  (const char *)connectivity.data(), connectivity.size() * sizeof(int64));
+        addArray_(xml, blocks, blockSize, offset, "Int64", "offsets", 1,
+                  (const char *)offsets.data(), offsets.size() * sizeof(int64));
+        addArray_(xml, blocks, blockSize, offset, "UInt8", "types", 1,
+                  (const char *)types.data(), types.size());
+        xml << "</Cells>\n";
+
+        if (nodeData_.size() > 0){
+            xml << "<PointData>\n";
+            for (Index d = 0; d < nodeData_.size(); d ++){
+                const char * p = full ? (const char *)&nodeData_[d]->second[0]
+                                      : (const char *)nodeValues[d].data();
+                addArray_(xml, blocks, blockSize, offset, "Float64", nodeData_[d]->first, 1,
+                          p, nNodes * sizeof(double));
+            }
+            xml << "</PointData>\n";
+        }
+        if (cellData_.size() > 0){
+            xml << "<CellData>\n";
+            for (Index d = 0; d < cellData_.size(); d ++){
+                addArray_(xml, blocks, blockSize, offset, "Float64", cellData_[d]->first, 1,
+                          (const char *)(&cellData_[d]->second[0] + start),
+                          (end - start) * sizeof(double));
+            }
+            xml << "</CellData>\n";
+        }
+        xml << "</Piece>\n" << "</UnstructuredGrid>\n"
+            << "<AppendedData encoding=\"raw\">\n_";
+
+        FILE * file = fopen(fileName.c_str(), "wb");
+        if (!file) return false;
+        std::string head(xml.str());
+        bool ok = fwrite(head.c_str(), 1, head.size(), file) == head.size();
+        for (Index i = 0; i < blocks.size() && ok; i ++){
+            ok = fwrite(&blockSize[i], sizeof(uint64), 1, file) == 1;
+            if (ok && blockSize[i] > 0) ok = fwrite(blocks[i], 1, blockSize[i], file) == blockSize[i];
+        }
+        std::string tail("\n</AppendedData>\n</VTKFile>\n");
+        if (ok) ok = fwrite(tail.c_str(), 1, tail.size(), file) == tail.size();
+        return (fclose(file) == 0) && ok;
+    }
+
+    /*! Write the declarations of the arrays for the .pvtu index file. */
+    void writeParallelHeader(std::ostream & xml) const {
+        if (nodeData_.size() > 0){
+            xml << "<PPointData>\n";
+            for (Index d = 0; d < nodeData_.size(); d ++){
+                xml << "<PDataArray type=\"Float64\" Name=\"" << nodeData_[d]->first << "\"/>\n";
+            }
+            xml << "</PPointData>\n";
+        }
+        if (cellData_.size() > 0){
+            xml << "<PCellData>\n";
+            for (Index d = 0; d < cellData_.size(); d ++){
+                xml << "<PDataArray type=\"Float64\" Name=\"" << cellData_[d]->first << "\"/>\n";
+            }
+            xml << "</PCellData>\n";
+        }
+        xml << "<PPoints>\n"
+            << "<PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n"
+            << "</PPoints>\n";
+    }
+
+protected:
+    void addArray_(std::ostream & xml, std::vector < const char * > & blocks,
+                   std::vector < uint64 > & blockSize, uint64 & offset,
+                   const std::string & type, const std::string & name, Index nComponents,
+                   const char * data, uint64 size) const {
+        xml << "<DataArray type=\"" << type << "\"";
+        if (!name.empty()) xml << " Name=\"" << name << "\"";
+        if (nComponents > 1) xml << " NumberOfComponents=\"" << nComponents << "\"";
+        xml << " format=\"appended\" offset=\"" << offset << "\"/>\n";
+        blocks.push_back(data);
+        blockSize.push_back(size);
+        offset += sizeof(uint64) + size;
+    }
+
+    typedef std::map < std::string, RVector >::const_iterator DataIter;
+
+    const Mesh * mesh_;
+    bool cellsAreBoundaries_;
+    std::vector < MeshEntity * > cells_;
+    std::vector < DataIter > nodeData_;
+    std::vector < DataIter > cellData_;
+};
+
+class ExportPVTUPiecesMT : public BaseCalcMT{
+public:
+    ExportPVTUPiecesMT(const VTUAppendedWriter & writer,
+                       const std::vector < std::string > & fileNames,
+                       std::vector < int > & ok, bool verbose=false)
+        : BaseCalcMT(1, verbose), writer_(&writer), fileNames_(&fileNames), ok_(&ok){
+    }
+
+    virtual ~ExportPVTUPiecesMT(){}
+
+    virtual void calc(Index tNr=0){
+        Index nParts = fileNames_->size();
+        Index nCells = writer_->cellCount();
+        for (Index i = start_; i < end_; i ++){
+            (*ok_)[i] = writer_->write((*fileNames_)[i], i * nCells / nParts,
+                                       (i + 1) * nCells / nParts);
+        }
+    }
+
+protected:
+    const VTUAppendedWriter * writer_;
+    const std::vector < std::string > * fileNames_;
+    std::vector < int > * ok_;
+};
+
+void Mesh::exportPVTU(const std::string & fbody, Index nParts, Index nThreads) const {
+    std::string body(fbody.substr(0, fbody.rfind(".pvtu")));
+    std::string base(body.substr(body.find_last_of("/\\") + 1));
+
+    std::map< std::string, RVector > data(exportDataMap_);
+    if (cellCount() > 0){
+        RVector tmp(cellCount());
+        std::transform(cellVector_.begin(), cellVector_.end(), &tmp[0], std::mem_fun(&Cell::marker));
+        if (!data.count("_Marker")) data.insert(std::make_pair("_Marker",  tmp));
+        if (!data.count("_Attribute")) data.insert(std::make_pair("_Attribute",  cellAttributes()));
+    }
+    VTUAppendedWriter writer(*this, data);
+
+    if (nThreads == 0) nThreads = threadCount();
+    if (nParts == 0) nParts = nThreads;
+    nParts = std::max(Index(1), std::min(nParts, writer.cellCount()));
+    nThreads = std::max(Index(1), std::min(nThreads, nParts));
+
+    std::vector < std::string > fileNames(nParts);
+    for (Index i = 0; i < nParts; i ++) fileNames[i] = body + "_" + str(i) + ".vtu";
+
+    std::vector < int > ok(nParts, 0);
+    distributeCalc(ExportPVTUPiecesMT(writer, fileNames, ok), nParts, nThreads);
+    for (Index i = 0; i < nParts; i ++){
+        if (!ok[i]) throwError(EXIT_OPEN_FILE, WHERE_AM_I + " cannot write " + fileNames[i]);
+    }
+
+    std::fstream file; if (!openOutFile(body + ".pvtu", & file)) { return ; }
+    file << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" "
+            "byte_order=\"LittleEndian\" header_type=\"UInt64\">" << std::endl;
+    file << "<PUnstructuredGrid GhostLevel=\"0\">" << std::endl;
+    writer.writeParallelHeader(file);
+    for (Index i = 0; i < nParts; i ++){
+        file << "<Piece Source=\"" << base << "_" << i << ".vtu\"/>" << std::endl;
+    }
+    file << "</PUnstructuredGrid>" << std::endl;
+    file << "</VTKFile>" << std::endl;
+    file.close();
+}
+
 void Mesh::exportVTU(const std::string & fbody, bool binary) const {
     std::string filename(fbody);
     if (filename.rfind(".vtu") == std::string::npos){
         filename = fbody.substr(0, filename.rfind(".vtk")) + ".vtu";
     }
-    std::fstream file; if (!openOutFile(filename, & file)) { return ; }
-    file.precision(14);
-    file << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl;
-    file << "<UnstructuredGrid>" << std::endl;
 
     std::map< std::string, RVector > data(exportDataMap_);
     if (cellCount() > 0){
@@ -1196,6 +2298,20 @@ void Mesh::exportVTU(const std::string & fbody, bool binary) const {
         if (!data.count("_Marker")) data.insert(std::make_pair("_Marker",  tmp));
         if (!data.count("_Attribute")) data.insert(std::make_pair("_Attribute",  cellAttributes()));
     }
+
+    if (binary){
+        VTUAppendedWriter writer(*this, data);
+        if (!writer.write(filename, 0, writer.cellCount())){
+            throwError(EXIT_OPEN_FILE, WHERE_AM_I + " cannot write " + filename);
+        }
+        return;
+    }
+
+    std::fstream file; if (!openOutFile(filename, & file)) { return ; }
+    file.precision(14);
+    file << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl;
+    file << "<UnstructuredGrid>" << std::endl;
+
     addVTUPiece_(file, *this, data);
 
     file << "</UnstructuredGrid>" << std::endl;
@@ -1208,11 +2324,6 @@ void Mesh::exportBoundaryVTU(const std::string & fbody, bool binary) const {
     if (filename.rfind(".vtu") == std::string::npos){
         filename = fbody.substr(0, filename.rfind(".vtk")) + ".vtu";
     }
-    std::fstream file; if (!openOutFile(filename, & file)) { return ; }
-
-    file << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl;
-    file << "<UnstructuredGrid>" << std::endl;
-
     std::vector < Boundary * > bs;
     for (uint i = 0; i < boundaryCount(); i ++) {
         if (boundary(i).marker() != 0.0) {
@@ -1236,6 +2347,19 @@ void Mesh::exportBoundaryVTU(const std::string & fbody, bool binary) const {
 
     if (!boundData.count("_BoundaryMarker")) boundData.insert(std::make_pair("_BoundaryMarker",  tmp));
 
+    if (binary){
+        VTUAppendedWriter writer(boundMesh, boundData);
+        if (!writer.write(filename, 0, writer.cellCount())){
+            throwError(EXIT_OPEN_FILE, WHERE_AM_I + " cannot write " + filename);
+        }
+        return;
+    }
+
+    std::fstream file; if (!openOutFile(filename, & file)) { return ; }
+
+    file << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl;
+    file << "<UnstructuredGrid>" << std::endl;
+
     //boundMesh.exportVTK(fbody, boundData);
     addVTUPiece_(file, boundMesh, boundData);
 
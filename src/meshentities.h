@@ -232,6 +232,10 @@ public:
      * in neighbourCells_. */
     virtual void findNeighbourCell(uint i);
 
+    /*! Set the neighbor cell regarding to the i-th Boundary. Used by
+     * \ref Mesh::createNeighbourInfos, which finds all neighbors at once. */
+    inline void setNeighbourCell(uint i, Cell * cell){ neighbourCells_[i] = cell; }
+
     inline double attribute() const { return attribute_; }
 
     inline void setAttribute(double attr) { attribute_ = attr; }
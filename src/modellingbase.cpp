@@ -221,42 +221,56 @@ void ModellingBase::setMultiThreadJacobian(Index nThreads){
     nThreadsJacobian_ = max(1, nThreads);
 }
 
+/*! Worker for the brute force Jacobian. Every part of \ref distributeCalc
+ * owns one model copy and is handed one column after another (chunk size
+ * 1), taking columns from the other parts once its own share is done, so
+ * expensive columns do not stall the others. */
 class JacobianBaseMT : public GIMLI::BaseCalcMT{
 public:
-    JacobianBaseMT(MatrixBase * J,
+    JacobianBaseMT(RMatrix & J,
                    const ModellingBase & fop,
                    const RVector & resp,
                    const RVector & model,
-                   Index count,
+                   double fak,
                    bool verbose)
-    : BaseCalcMT(count, verbose), J_(J), fop_(&fop), resp_(&resp),
-    model_(&model) {
+    : BaseCalcMT(1, verbose), J_(&J), fop_(&fop), resp_(&resp),
+    model_(&model), fak_(fak) {
 
     }
 
     virtual ~JacobianBaseMT(){}
 
     virtual void calc(Index tNr=0){
-        RVector modelChange(*model_);
-        modelChange[tNr] *= 1.05;
-        __MS(tNr)
-        fop_->response_mt(modelChange, tNr);
-//         RVector respChange();
+        const RVector & model = *model_;
+        //** kept over the chunks of this copy, restored after every column
+        if (modelChange_.size() != model.size()) modelChange_ = model;
+        RVector & modelChange = modelChange_;
 
-        //J_->setCol(tNr, (respChange - *resp_)/(modelChange[tNr] - (*model_)[tNr]));
+        for (Index i = start_; i < end_; i ++){
+            modelChange[i] *= fak_;
+
+            if (::fabs(modelChange[i] - model[i]) > TOLERANCE){
+                RVector respChange(fop_->response_mt(modelChange, tNr));
+                J_->setCol(i, (respChange - *resp_) / (modelChange[i] - model[i]));
+            } else {
+                J_->setCol(i, RVector(resp_->size(), 0.0));
+            }
+            modelChange[i] = model[i];
+        }
     }
 
 protected:
-    MatrixBase              * J_;
+    RMatrix                 * J_;
     const ModellingBase     * fop_;
     const RVector           * resp_;
     const RVector           * model_;
+    double                  fak_;
+    RVector                 modelChange_;
 };
 
 
 void ModellingBase::createJacobian_mt(const RVector & model,
                                       const RVector & resp){
-    THROW_TO_IMPL
     if (verbose_) std::cout << "Create Jacobian matrix (brute force, mt) ...";
 
     Stopwatch swatch(true);
@@ -266,12 +280,17 @@ void ModellingBase::createJacobian_mt(const RVector & model,
         this->initJacobian();
     }
     RMatrix *J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J){
+        throwError(1, WHERE_AM_I + " brute force Jacobian needs a RMatrix.");
+    }
     if (J->rows() != resp.size()){ J->resize(resp.size(), model.size()); }
 
+    //** every column costs a forward call, so they are fetched one by one
+    Index nThreads = std::max(Index(1), std::min(nThreadsJacobian_, model.size()));
 
     ALLOW_PYTHON_THREADS
-    distributeCalc(JacobianBaseMT(jacobian_, *this, resp, model, 0, verbose_),
-                   jacobian_->rows(), nThreadsJacobian_, verbose_);
+    distributeCalc(JacobianBaseMT(*J, *this, resp, model, fak, verbose_),
+                   model.size(), nThreads, verbose_, 1);
     swatch.stop();
     if (verbose_) std::cout << " ... " << swatch.duration() << " s." << std::endl;
 }
@@ -0,0 +1,417 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "pcgWrapper.h"
+
+#include "calculateMultiThread.h"
+#include "matrix.h"
+#include "sparsematrix.h"
+
+#include <vector>
+
+namespace GIMLI{
+
+inline double abs2__(double a){ return a * a; }
+inline double abs2__(const Complex & a){ return std::norm(a); }
+
+//** a pivot is valid if it doesn't lose all digits of the diagonal
+inline bool validPivot__(double s, double a){
+    return s > 1e-12 * std::fabs(a);
+}
+inline bool validPivot__(const Complex & s, const Complex & a){
+    return std::abs(s) > 1e-12 * std::abs(a);
+}
+
+//! System matrix and IC(0) preconditioner in compressed row storage.
+template < class ValueType > class PCGSystem{
+public:
+    PCGSystem(const SparseMatrix < ValueType > & S){
+        build(S);
+    }
+
+    /*! Copy S with full storage and sorted columns, and build the pattern
+     * of the lower factor. */
+    void build(const SparseMatrix < ValueType > & S){
+        n = S.rows();
+        const std::vector < int > & cp = S.vecColPtr();
+        const std::vector < int > & ri = S.vecRowIdx();
+        const Vector < ValueType > & sv = S.vecVals();
+
+        if (S.stype() == 0){
+            ptr.assign(cp.begin(), cp.end());
+            idx.assign(ri.begin(), ri.end());
+            vals.resize(sv.size());
+            for (Index k = 0; k < sv.size(); k ++) vals[k] = sv[k];
+        } else {
+            //** triangle storage: stored (i, J) is conj(v), mirrored (J, i) is v
+            ptr.assign(n + 1, 0);
+            for (Index i = 0; i < n; i ++){
+                for (int k = cp[i]; k < cp[i + 1]; k ++){
+                    ptr[i + 1] ++;
+                    if (Index(ri[k]) != i) ptr[ri[k] + 1] ++;
+                }
+            }
+            for (Index i = 0; i < n; i ++) ptr[i + 1] += ptr[i];
+            idx.resize(ptr[n]);
+            vals.resize(ptr[n]);
+            std::vector < Index > fill(ptr.begin(), ptr.end() - 1);
+            for (Index i = 0; i < n; i ++){
+                for (int k = cp[i]; k < cp[i + 1]; k ++){
+                    Index j = ri[k];
+                    Index pos = fill[i] ++;
+                    idx[pos] = j;
+                    vals[pos] = conj(sv[k]);
+                    if (j != i){
+                        pos = fill[j] ++;
+                        idx[pos] = i;
+                        vals[pos] = sv[k];
+                    }
+                }
+            }
+        }
+
+        //** the factor needs the columns of each row in ascending order
+        for (Index i = 0; i < n; i ++){
+            for (Index k = ptr[i] + 1; k < ptr[i + 1]; k ++){
+                Index j = idx[k];
+                ValueType v = vals[k];
+                Index m = k;
+                for (; m > ptr[i] && idx[m - 1] > j; m --){
+                    idx[m] = idx[m - 1];
+                    vals[m] = vals[m - 1];
+                }
+                idx[m] = j;
+                vals[m] = v;
+            }
+        }
+
+        //** lower triangle with the diagonal as last entry of each row
+        lPtr.assign(n + 1, 0);
+        lIdx.clear();
+        aPos.clear();
+        for (Index i = 0; i < n; i ++){
+            for (Index k = ptr[i]; k < ptr[i + 1] && idx[k] <= i; k ++){
+                lIdx.push_back(idx[k]);
+                aPos.push_back(k);
+            }
+            lPtr[i + 1] = lIdx.size();
+            if (lPtr[i + 1] == lPtr[i] || lIdx.back() != i){
+                throwError(1, WHERE_AM_I + " missing diagonal entry in row " + str(i));
+            }
+        }
+        lVals.resize(lIdx.size());
+        factorise();
+    }
+
+    /*! Take the values of S, which has the pattern of the last build. */
+    void setValues(const SparseMatrix < ValueType > & S){
+        if (S.stype() != 0){
+            build(S);
+            return;
+        }
+        //** the rows were sorted in place, so only a sorted S can be copied
+        const std::vector < int > & cp = S.vecColPtr();
+        const std::vector < int > & ri = S.vecRowIdx();
+        for (Index i = 0; i < n; i ++){
+            for (int k = cp[i] + 1; k < cp[i + 1]; k ++){
+                if (ri[k - 1] > ri[k]){
+                    build(S);
+                    return;
+                }
+            }
+        }
+        const Vector < ValueType > & sv = S.vecVals();
+        for (Index k = 0; k < sv.size(); k ++) vals[k] = sv[k];
+        factorise();
+    }
+
+    /*! IC(0) with a growing diagonal shift until no pivot breaks down.
+     * Ends with a diagonal (Jacobi) preconditioner if that fails too. */
+    void factorise(){
+        double shift = 0.0;
+        while (!factorise_(shift)){
+            shift = (shift == 0.0) ? 1e-3 : shift * 2.0;
+            if (shift > 1.0){
+                std::cerr << WHERE_AM_I << " incomplete Cholesky fails, "
+                          << "use diagonal preconditioner." << std::endl;
+                for (Index i = 0; i < n; i ++){
+                    for (Index p = lPtr[i]; p < lPtr[i + 1] - 1; p ++) lVals[p] = 0.0;
+                    lVals[lPtr[i + 1] - 1] = std::sqrt(vals[aPos[lPtr[i + 1] - 1]]);
+                }
+                break;
+            }
+        }
+    }
+
+    /*! z = (L L^T)^-1 r */
+    void precondition(const ValueType * r, ValueType * z) const {
+        for (Index i = 0; i < n; i ++){
+            Index d = lPtr[i + 1] - 1;
+            ValueType s(r[i]);
+            for (Index p = lPtr[i]; p < d; p ++) s -= lVals[p] * z[lIdx[p]];
+            z[i] = s / lVals[d];
+        }
+        for (Index i = n; i -- > 0;){
+            Index d = lPtr[i + 1] - 1;
+            z[i] /= lVals[d];
+            for (Index p = lPtr[i]; p < d; p ++) z[lIdx[p]] -= lVals[p] * z[i];
+        }
+    }
+
+    /*! Solve A x = b with x as start vector. The dot products are not
+     * conjugated, which is CG for real and COCG for complex symmetric
+     * matrices. Return true if |b - A x| <= tol |b|. */
+    bool solve(const ValueType * b, ValueType * x, double tol, Index maxIter,
+               Index nThreads, Index & iter) const {
+        iter = 0;
+        double bNorm = 0.0;
+        for (Index i = 0; i < n; i ++) bNorm += abs2__(b[i]);
+        if (bNorm == 0.0){
+            for (Index i = 0; i < n; i ++) x[i] = 0.0;
+            return true;
+        }
+        double tol2 = tol * tol * bNorm;
+
+        std::vector < ValueType > r(n), z(n), p(n), q(n);
+        compressedRowMult(&ptr[0], &idx[0], &vals[0], x, &q[0], n, nThreads);
+        double rNorm = 0.0;
+        for (Index i = 0; i < n; i ++){
+            r[i] = b[i] - q[i];
+            rNorm += abs2__(r[i]);
+        }
+        if (rNorm <= tol2) return true;
+
+        precondition(&r[0], &z[0]);
+        ValueType rz(0.0);
+        for (Index i = 0; i < n; i ++){
+            p[i] = z[i];
+            rz += r[i] * z[i];
+        }
+
+        while (iter < maxIter){
+            iter ++;
+            compressedRowMult(&ptr[0], &idx[0], &vals[0], &p[0], &q[0], n, nThreads);
+            ValueType pq(0.0);
+            for (Index i = 0; i < n; i ++) pq += p[i] * q[i];
+            if (pq == ValueType(0.0)) return false;
+
+            ValueType alpha(rz / pq);
+            rNorm = 0.0;
+            for (Index i = 0; i < n; i ++){
+                x[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+                rNorm += abs2__(r[i]);
+            }
+            if (rNorm <= tol2) return true;
+
+            precondition(&r[0], &z[0]);
+            ValueType rzNew(0.0);
+            for (Index i = 0; i < n; i ++) rzNew += r[i] * z[i];
+            if (rzNew == ValueType(0.0)) return false;
+
+            ValueType beta(rzNew / rz);
+            rz = rzNew;
+            for (Index i = 0; i < n; i ++) p[i] = z[i] + beta * p[i];
+        }
+        return false;
+    }
+
+    Index n;
+    //** the matrix, full storage
+    std::vector < Index > ptr;
+    std::vector < Index > idx;
+    std::vector < ValueType > vals;
+    //** the lower factor on the pattern of the lower triangle of the matrix
+    std::vector < Index > lPtr;
+    std::vector < Index > lIdx;
+    std::vector < Index > aPos;
+    std::vector < ValueType > lVals;
+
+protected:
+    bool factorise_(double shift){
+        for (Index i = 0; i < n; i ++){
+            Index d = lPtr[i + 1] - 1;
+            for (Index p = lPtr[i]; p < d; p ++){
+                Index j = lIdx[p];
+                ValueType s(vals[aPos[p]]);
+                //** s -= sum_k L(i, k) L(j, k) over the common columns k < j
+                Index a = lPtr[i];
+                Index b = lPtr[j], bEnd = lPtr[j + 1] - 1;
+                while (a < p && b < bEnd){
+                    if (lIdx[a] == lIdx[b]){
+                        s -= lVals[a] * lVals[b];
+                        a ++; b ++;
+                    } else if (lIdx[a] < lIdx[b]){
+                        a ++;
+                    } else {
+                        b ++;
+                    }
+                }
+                lVals[p] = s / lVals[bEnd];
+            }
+            ValueType diag(vals[aPos[d]] * (1.0 + shift));
+            ValueType s(diag);
+            for (Index p = lPtr[i]; p < d; p ++) s -= lVals[p] * lVals[p];
+            if (!validPivot__(s, diag)) return false;
+            lVals[d] = std::sqrt(s);
+        }
+        return true;
+    }
+};
+
+/*! Solve the rows [start_, end_) of a blocked rhs, one row per thread
+ * with serial matrix products. */
+template < class ValueType > class PCGSolveMT : public BaseCalcMT{
+public:
+    PCGSolveMT(const PCGSystem < ValueType > & sys,
+               const Matrix < ValueType > & rhs, Matrix < ValueType > & sol,
+               double tol, Index maxIter, Index * iter, int * converged,
+               bool verbose=false)
+        : BaseCalcMT(1, verbose), sys_(&sys), rhs_(&rhs), sol_(&sol),
+          tol_(tol), maxIter_(maxIter), iter_(iter), converged_(converged){
+    }
+
+    virtual ~PCGSolveMT(){}
+
+    virtual void calc(Index tNr=0){
+        Index end = std::min(end_, rhs_->rows());
+        for (Index i = start_; i < end; i ++){
+            converged_[i] = sys_->solve(&(*rhs_)[i][0], &(*sol_)[i][0],
+                                        tol_, maxIter_, 1, iter_[i]);
+        }
+    }
+
+protected:
+    const PCGSystem < ValueType > * sys_;
+    const Matrix < ValueType > * rhs_;
+    Matrix < ValueType > * sol_;
+    double tol_;
+    Index maxIter_;
+    Index * iter_;
+    int * converged_;
+};
+
+template < class ValueType >
+int solvePCG_(const PCGSystem < ValueType > & sys,
+              const Vector < ValueType > & rhs, Vector < ValueType > & solution,
+              double tol, Index maxIter, Index & iterations, bool verbose){
+    if (solution.size() != sys.n) solution.resize(sys.n);
+    if (sys.n == 0) return 1;
+    bool converged = sys.solve(&rhs[0], &solution[0], tol, maxIter, 0, iterations);
+    if (verbose) std::cout << "PCG: " << iterations << " iterations." << std::endl;
+    if (!converged){
+        std::cerr << WHERE_AM_I << " no convergence after " << iterations
+                  << " iterations." << std::endl;
+    }
+    return converged;
+}
+
+template < class ValueType >
+int solvePCG_(const PCGSystem < ValueType > & sys,
+              const Matrix < ValueType > & rhs, Matrix < ValueType > & solution,
+              double tol, Index maxIter, Index & iterations, bool verbose){
+    //** resize keeps the values of a solution with the right size as start
+    if (solution.rows() != rhs.rows() || solution.cols() != sys.n){
+        solution.resize(rhs.rows(), sys.n);
+    }
+    iterations = 0;
+    if (rhs.rows() == 0 || sys.n == 0) return 1;
+    if (rhs.rows() == 1) {
+        return solvePCG_(sys, rhs[0], solution[0], tol, maxIter, iterations, verbose);
+    }
+
+    std::vector < Index > iter(rhs.rows(), 0);
+    std::vector < int > converged(rhs.rows(), 0);
+    Index nThreads = std::max(Index(1), std::min(threadCount(), rhs.rows()));
+    distributeCalc(PCGSolveMT< ValueType >(sys, rhs, solution, tol, maxIter,
+                                           &iter[0], &converged[0]),
+                   rhs.rows(), nThreads);
+
+    int ret = 1;
+    for (Index i = 0; i < rhs.rows(); i ++){
+        iterations = std::max(iterations, iter[i]);
+        if (!converged[i]) ret = 0;
+    }
+    if (verbose) std::cout << "PCG: " << iterations << " iterations (max of "
+                           << rhs.rows() << ")." << std::endl;
+    if (!ret){
+        std::cerr << WHERE_AM_I << " no convergence for at least one rhs."
+                  << std::endl;
+    }
+    return ret;
+}
+
+PCGWrapper::PCGWrapper(RSparseMatrix & S, bool verbose)
+    : SolverWrapper(S, verbose), rSystem_(NULL), cSystem_(NULL), iterations_(0){
+    tolerance_ = 1e-10;
+    maxiter_ = std::max(Index(100), Index(dim_));
+    rSystem_ = new PCGSystem< double >(S);
+}
+
+PCGWrapper::PCGWrapper(CSparseMatrix & S, bool verbose)
+    : SolverWrapper(S, verbose), rSystem_(NULL), cSystem_(NULL), iterations_(0){
+    if (S.stype() != 0){
+        throwError(1, WHERE_AM_I + " complex matrices need full storage.");
+    }
+    tolerance_ = 1e-10;
+    maxiter_ = std::max(Index(100), Index(dim_));
+    cSystem_ = new PCGSystem< Complex >(S);
+}
+
+PCGWrapper::~PCGWrapper(){
+    if (rSystem_) delete rSystem_;
+    if (cSystem_) delete cSystem_;
+}
+
+int PCGWrapper::refactorise(RSparseMatrix & S){
+    if (!rSystem_) return 0;
+    rSystem_->setValues(S);
+    return 1;
+}
+
+int PCGWrapper::refactorise(CSparseMatrix & S){
+    if (!cSystem_ || S.stype() != 0) return 0;
+    cSystem_->setValues(S);
+    return 1;
+}
+
+int PCGWrapper::solve(const RVector & rhs, RVector & solution){
+    if (!rSystem_) throwError(1, WHERE_AM_I + " the matrix is complex.");
+    return solvePCG_(*rSystem_, rhs, solution, tolerance_, Index(maxiter_),
+                     iterations_, verbose_);
+}
+
+int PCGWrapper::solve(const CVector & rhs, CVector & solution){
+    if (!cSystem_) throwError(1, WHERE_AM_I + " the matrix is real.");
+    return solvePCG_(*cSystem_, rhs, solution, tolerance_, Index(maxiter_),
+                     iterations_, verbose_);
+}
+
+int PCGWrapper::solve(const RMatrix & rhs, RMatrix & solution){
+    if (!rSystem_) throwError(1, WHERE_AM_I + " the matrix is complex.");
+    return solvePCG_(*rSystem_, rhs, solution, tolerance_, Index(maxiter_),
+                     iterations_, verbose_);
+}
+
+int PCGWrapper::solve(const CMatrix & rhs, CMatrix & solution){
+    if (!cSystem_) throwError(1, WHERE_AM_I + " the matrix is real.");
+    return solvePCG_(*cSystem_, rhs, solution, tolerance_, Index(maxiter_),
+                     iterations_, verbose_);
+}
+
+} //namespace GIMLI;
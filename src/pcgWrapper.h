@@ -0,0 +1,89 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_PCGWRAPPER__H
+#define _GIMLI_PCGWRAPPER__H
+
+#include "gimli.h"
+#include "solverWrapper.h"
+
+namespace GIMLI{
+
+template < class ValueType > class PCGSystem;
+
+//! Preconditioned conjugate gradient solver for sparse symmetric matrices.
+/*! Iterative alternative to the direct solvers for large 3D meshes where
+ * the fill-in of a sparse factor exceeds the available memory. The
+ * preconditioner is an incomplete Cholesky factor without fill-in (IC(0))
+ * on the lower triangle of the matrix. If it breaks down, the diagonal is
+ * shifted until it succeeds.
+ * Matrices with full storage are used as they are and have to be
+ * symmetric, real matrices with triangle storage are expanded. Complex
+ * matrices have to be complex symmetric (not Hermitian) and are solved
+ * with the conjugate orthogonal CG (COCG).
+ * A solution of matching size is used as start vector, e.g., the
+ * potentials of the last forward call. Several right hand sides are
+ * solved concurrently, a single one uses threads for the matrix products. */
+class DLLEXPORT PCGWrapper : public SolverWrapper {
+public:
+    PCGWrapper(RSparseMatrix & S, bool verbose=false);
+
+    PCGWrapper(CSparseMatrix & S, bool verbose=false);
+
+    virtual ~PCGWrapper();
+
+    /*! Always true, the solver has no external dependency. */
+    static bool valid(){ return true; }
+
+    virtual int solve(const RVector & rhs, RVector & solution);
+
+    virtual int solve(const CVector & rhs, CVector & solution);
+
+    /*! Solve for all right hand sides given as rows of rhs in parallel. */
+    virtual int solve(const RMatrix & rhs, RMatrix & solution);
+
+    /*! Solve for all right hand sides given as rows of rhs in parallel. */
+    virtual int solve(const CMatrix & rhs, CMatrix & solution);
+
+    /*! Copy the values of S and recompute the preconditioner. */
+    virtual int refactorise(RSparseMatrix & S);
+
+    /*! Copy the values of S and recompute the preconditioner. */
+    virtual int refactorise(CSparseMatrix & S);
+
+    /*! Set the relative residual norm |b - A x| / |b| to stop at.
+     * Default is 1e-10. */
+    inline void setTolerance(double tol) { tolerance_ = tol; }
+
+    /*! Set the maximum number of iterations per right hand side.
+     * Default is the matrix dimension. */
+    inline void setMaxIter(Index maxIter) { maxiter_ = maxIter; }
+
+    /*! Return the iterations of the last solve, the maximum over all
+     * right hand sides of a blocked solve. */
+    inline Index iterations() const { return iterations_; }
+
+protected:
+    PCGSystem< double > * rSystem_;
+    PCGSystem< Complex > * cSystem_;
+    Index iterations_;
+};
+
+} //namespace GIMLI;
+
+#endif // _GIMLI_PCGWRAPPER__H
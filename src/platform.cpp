@@ -63,4 +63,21 @@ int numberOfCPU(){
     return nprocs_max;
 }
 
+double physicalMemory(){
+#if defined(WINDOWS) || defined(_WIN32)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        return double(status.ullTotalPhys) / (1024.0 * 1024.0);
+    }
+#elif defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && pageSize > 0) {
+        return double(pages) * double(pageSize) / (1024.0 * 1024.0);
+    }
+#endif
+    return 0.0;
+}
+
 } // namespace GIMLI{
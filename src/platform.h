@@ -67,6 +67,11 @@
 namespace GIMLI{
 DLLEXPORT int numberOfCPU();
 
+/*!
+ * Return the physical memory of this system in MByte, 0 if unknown.
+ */
+DLLEXPORT double physicalMemory();
+
 // Microsoft Visual C++ 10 does not provide some C99 functions
 #if defined(_MSC_VER)
 template< typename T > T rint( T x ){ return std::floor(x + 0.5); }
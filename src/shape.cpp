@@ -236,11 +236,8 @@ void Shape::createJacobian(RMatrix3 & J) const {
         z[i] = nodeVector_[i]->pos()[2];
     }
 
-    if (ShapeFunctionCache::instance().RMatrixCache(rtti()).size() < 1){
-        ShapeFunctionCache::instance().RMatrixCache(rtti()).push_back(RMatrix(3, nodeCount()));
-    }
-
-    RMatrix & MdNdrst = ShapeFunctionCache::instance().cachedRMatrix(rtti(), 0);
+    //** no shared scratch matrix here, shapes may be evaluated in parallel
+    RMatrix MdNdrst(3, nodeCount());
     this->dNdrst(RVector3(0.0, 0.0, 0.0), MdNdrst);
 //     RMatrix MdNdrst(this->dNdrst(RVector3(0.0, 0.0, 0.0)));
 
@@ -297,12 +294,9 @@ void Shape::rst2xyz(const RVector3 & rst, RVector3 & xyz) const{
 
 const RMatrix3 & Shape::invJacobian() const {
     if (!invJacobian_.valid()){
-       if (ShapeFunctionCache::instance().RMatrix3Cache().size() < 1){
-           ShapeFunctionCache::instance().RMatrix3Cache().push_back(RMatrix3());
-       }
-
-       this->createJacobian(ShapeFunctionCache::instance().cachedRMatrix3(0));
-       inv(ShapeFunctionCache::instance().cachedRMatrix3(0), invJacobian_);
+       RMatrix3 J;
+       this->createJacobian(J);
+       inv(J, invJacobian_);
        invJacobian_.setValid(true);
     }
 //     if (invJacobian_.rows() != 3) {
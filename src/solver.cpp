@@ -0,0 +1,142 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *   Thomas Günther thomas@resistivity.net                                    *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+#include "solver.h"
+#include "calculateMultiThread.h"
+#include "sparsematrix.h"
+
+namespace GIMLI{
+
+//** y = A * x for row range or A^T * x for column range of dense row major A
+class DenseScaledMultMT : public BaseCalcMT{
+public:
+    DenseScaledMultMT(const double * A, Index rows, Index cols,
+                      const double * x, const double * scale, double * ret,
+                      bool trans, bool verbose)
+        : BaseCalcMT(1, verbose), A_(A), rows_(rows), cols_(cols),
+          x_(x), scale_(scale), ret_(ret), trans_(trans){
+    }
+
+    virtual ~DenseScaledMultMT(){}
+
+    virtual void calc(Index tNr=0){
+        const double * x = x_;
+        const double * scale = scale_;
+        double * ret = ret_;
+
+        if (trans_){
+            //** every thread owns the columns start_ .. end_ of all rows
+            for (Index j = start_; j < end_; j ++) ret[j] = 0.0;
+            for (Index i = 0; i < rows_; i ++){
+                double xi = x[i];
+                if (xi == 0.0) continue;
+                const double * a = A_ + i * cols_;
+                for (Index j = start_; j < end_; j ++) ret[j] += a[j] * xi;
+            }
+            for (Index j = start_; j < end_; j ++) ret[j] *= scale[j];
+        } else {
+            for (Index i = start_; i < end_; i ++){
+                const double * a = A_ + i * cols_;
+                double sum = 0.0;
+                for (Index j = 0; j < cols_; j ++) sum += a[j] * x[j];
+                ret[i] = sum * scale[i];
+            }
+        }
+    }
+
+protected:
+    const double * A_;
+    Index rows_;
+    Index cols_;
+    const double * x_;
+    const double * scale_;
+    double * ret_;
+    bool trans_;
+};
+
+static Index denseMultThreads_(Index rows, Index cols, Index nCalcs, Index nThreads){
+    //** threads only pay off for larger matrices, explicit requests are kept
+    if (nThreads == 0){
+        nThreads = std::min(threadCount(), rows * cols / 100000);
+    }
+    return std::max(Index(1), std::min(nThreads, nCalcs));
+}
+
+void scaledMult(const MatrixBase & A, const RVector & x,
+                const RVector & colScale, const RVector & rowScale,
+                RVector & ret, RVector & work, Index nThreads){
+    const RMatrix * M = dynamic_cast< const RMatrix * >(&A);
+    if (M && M->data()){
+        if (x.size() != A.cols() || colScale.size() != A.cols() ||
+            rowScale.size() != A.rows()){
+            throwLengthError(1, WHERE_AM_I + " " + toStr(A.rows()) + "x"
+                            + toStr(A.cols()) + " " + toStr(x.size()) + " "
+                            + toStr(colScale.size()) + " " + toStr(rowScale.size()));
+        }
+        work = x * colScale;
+        ret.resize(M->rows());
+        Index nT = denseMultThreads_(M->rows(), M->cols(), M->rows(), nThreads);
+        distributeCalc(DenseScaledMultMT(M->data(), M->rows(), M->cols(),
+                                         &work[0], &rowScale[0], &ret[0],
+                                         false, false),
+                       M->rows(), nT);
+        return;
+    }
+    work = x * colScale;
+    const RSparseMapMatrix * C = dynamic_cast< const RSparseMapMatrix * >(&A);
+    if (C){
+        C->mult(work, ret);
+        ret *= rowScale;
+        return;
+    }
+    ret = A.mult(work);
+    ret *= rowScale;
+}
+
+void scaledTransMult(const MatrixBase & A, const RVector & y,
+                     const RVector & rowScale, const RVector & colScale,
+                     RVector & ret, RVector & work, Index nThreads){
+    const RMatrix * M = dynamic_cast< const RMatrix * >(&A);
+    if (M && M->data()){
+        if (y.size() != A.rows() || rowScale.size() != A.rows() ||
+            colScale.size() != A.cols()){
+            throwLengthError(1, WHERE_AM_I + " " + toStr(A.rows()) + "x"
+                            + toStr(A.cols()) + " " + toStr(y.size()) + " "
+                            + toStr(rowScale.size()) + " " + toStr(colScale.size()));
+        }
+        work = y * rowScale;
+        ret.resize(M->cols());
+        Index nT = denseMultThreads_(M->rows(), M->cols(), M->cols(), nThreads);
+        distributeCalc(DenseScaledMultMT(M->data(), M->rows(), M->cols(),
+                                         &work[0], &colScale[0], &ret[0],
+                                         true, false),
+                       M->cols(), nT);
+        return;
+    }
+    work = y * rowScale;
+    const RSparseMapMatrix * C = dynamic_cast< const RSparseMapMatrix * >(&A);
+    if (C){
+        C->transMult(work, ret);
+        ret *= colScale;
+        return;
+    }
+    ret = A.transMult(work);
+    ret *= colScale;
+}
+
+} // namespace GIMLI
@@ -26,6 +26,22 @@
 
 namespace GIMLI{
 
+/*! ret = rowScale * (A * (colScale * x)). work is a workspace of size
+ * x.size() that can be reused between calls. Dense \ref RMatrix are
+ * multiplied in one fused multi threaded pass (nThreads=0 uses
+ * \ref threadCount() for matrices large enough to pay off),
+ * \ref RSparseMapMatrix write directly into ret,
+ * all other matrices use A.mult.
+ * ret and work must not share memory with x. */
+DLLEXPORT void scaledMult(const MatrixBase & A, const RVector & x,
+                          const RVector & colScale, const RVector & rowScale,
+                          RVector & ret, RVector & work, Index nThreads=0);
+
+/*! ret = colScale * (A^T * (rowScale * y)). See \ref scaledMult. */
+DLLEXPORT void scaledTransMult(const MatrixBase & A, const RVector & y,
+                               const RVector & rowScale, const RVector & colScale,
+                               RVector & ret, RVector & work, Index nThreads=0);
+
 template < class Vec >
 int solveCGLSCDWWhtrans(const MatrixBase & S, const MatrixBase & C,
                         const Vec & dWeight, const Vec & b, Vec & x,
@@ -52,11 +68,33 @@ int solveCGLSCDWWhtrans(const MatrixBase & S, const MatrixBase & C,
     if (td.size() != nData) std::cerr << "td.size() != nData " << td.size() << " / " << nData << std::endl;
     if (roughness.size() != nConst) std::cerr << "roughness.size != nConst " << roughness.size() << " / " << nConst << std::endl;
 
+    //** preallocated workspaces and scalings, reused in every iteration
+    Vec dtd(dWeight * td);      // nData
+    Vec itm(1.0 / tm);          // nModel
+    Vec wml(wm * lambda);       // nModel
+    Vec wM(nModel), wD(nData), wC(nConst);
+    Vec rc(nModel);
+
 //Ch  Vec cdx(transMult(C, Vec(wc * wc * (C * Vec(wm * deltaX)))) * wm * lambda); // nModel
-    Vec cdx(transMult(C, Vec(wc * roughness)) * wm * lambda); // nModel
-    Vec z((b - S * Vec(x / tm) * td) * dWeight); // nData
-    Vec p(transMult(S, Vec(z * dWeight * td)) / tm - cdx - transMult(C, Vec(wc * wc * (C * Vec(wm * x)))) * wm * lambda);// nModel
-    Vec r(transMult(S, Vec(b * dWeight * dWeight * td)) / tm - cdx); // nModel
+    Vec cdx(nModel);
+    scaledTransMult(C, roughness, wc, wml, cdx, wC);
+
+    Vec z(nData);
+    scaledMult(S, x, itm, td, z, wM);
+    z = (b - z) * dWeight;
+
+    //** cx = wc * (C * (wm * x)) follows x by the same recursion as z
+    Vec cx(nConst);
+    scaledMult(C, x, wm, wc, cx, wM);
+
+    Vec p(nModel);
+    scaledTransMult(S, z, dtd, itm, p, wD);
+    scaledTransMult(C, cx, wc, wml, rc, wC);
+    p -= cdx + rc;
+
+    Vec r(nModel);
+    scaledTransMult(S, Vec(b * dWeight), dtd, itm, r, wD);
+    r -= cdx;
 
     double accuracy = tol;
     if (accuracy < 0.0) accuracy = max(TOLERANCE, 1e-08 * dot(r, r));
@@ -75,18 +113,22 @@ int solveCGLSCDWWhtrans(const MatrixBase & S, const MatrixBase & C,
 
     while (count < maxIter && normR2 > accuracy){
         count ++;
-        q = S * Vec(p / tm) * dWeight * td;
-        wcp = wc * (C * Vec(p * wm));
+        scaledMult(S, p, itm, dtd, q, wM);
+        scaledMult(C, p, wm, wc, wcp, wM);
 
         alpha = normR2 / (dot(q, q) + lambda * dot(wcp, wcp));
         x += p * alpha;
         if((count % 10) == -1) { // TOM
-            z = b - S * Vec(x / tm) * td; // z exakt durch extra Mult.
-            z *= dWeight;
+            scaledMult(S, x, itm, td, z, wM); // z exakt durch extra Mult.
+            z = (b - z) * dWeight;
         } else {
             z -= q * alpha;
         }
-        r = transMult(S, Vec(z * dWeight * td)) / tm - transMult(C, Vec(wc * wc * (C * Vec(wm * x)))) * wm * lambda - cdx;
+        cx += wcp * alpha;
+
+        scaledTransMult(S, z, dtd, itm, r, wD);
+        scaledTransMult(C, cx, wc, wml, rc, wC);
+        r -= rc + cdx;
 
         normR2old = normR2;
         normR2 = dot(r, r);
@@ -126,10 +168,33 @@ int solveCGLSCDWWtrans(const MatrixBase & S, const MatrixBase & C, const Vec & d
   if (tm.size() != nModel) std::cerr << "tm.size() != nModel " << tm.size() << " / " << nModel << std::endl;
   if (td.size() != nData) std::cerr << "td.size() != nData " << td.size() << " / " << nData << std::endl;
 
-  Vec cdx(transMult(C, Vec(wc * wc * (C * Vec(mc * deltaX)))) * mc * lambda); // nModel
-  Vec z((b - S * Vec(x / tm) * td) * dWeight); // nData
-  Vec p(transMult(S, Vec(z * dWeight * td)) / tm - cdx - transMult(C, Vec(wc * wc * (C * Vec(mc * x)))) * mc * lambda);// nModel
-  Vec r(transMult(S, Vec(b * dWeight * dWeight * td)) / tm - cdx); // nModel
+  //** preallocated workspaces and scalings, reused in every iteration
+  Vec dtd(dWeight * td);      // nData
+  Vec itm(1.0 / tm);          // nModel
+  Vec mcl(mc * lambda);       // nModel
+  Vec wM(nModel), wD(nData), wC(nConst);
+  Vec rc(nModel);
+
+  //** cx = wc * (C * (mc * x)) follows x by the same recursion as z
+  Vec cx(nConst);
+  Vec cdx(nModel);
+  scaledMult(C, deltaX, mc, wc, cx, wM);
+  scaledTransMult(C, cx, wc, mcl, cdx, wC); // nModel
+
+  Vec z(nData);
+  scaledMult(S, x, itm, td, z, wM);
+  z = (b - z) * dWeight;
+
+  scaledMult(C, x, mc, wc, cx, wM);
+
+  Vec p(nModel);
+  scaledTransMult(S, z, dtd, itm, p, wD);
+  scaledTransMult(C, cx, wc, mcl, rc, wC);
+  p -= cdx + rc;
+
+  Vec r(nModel);
+  scaledTransMult(S, Vec(b * dWeight), dtd, itm, r, wD);
+  r -= cdx;
 
   double accuracy = max(TOLERANCE, 1e-08 * dot(r, r));
   r = p;
@@ -145,18 +210,22 @@ int solveCGLSCDWWtrans(const MatrixBase & S, const MatrixBase & C, const Vec & d
   while (count < maxIter && normR2 > accuracy){
 
     count ++;
-    q = S * Vec(p / tm) * dWeight * td;
-    wcp = wc * (C * Vec(p * mc));
+    scaledMult(S, p, itm, dtd, q, wM);
+    scaledMult(C, p, mc, wc, wcp, wM);
 
     alpha = normR2 / (dot(q, q) + lambda * dot(wcp, wcp));
     x += p * alpha;
     if((count % 10) == -1) { // TOM
-      z = b - S * Vec(x / tm) * td; // z exakt durch extra Mult.
-      z *= dWeight;
+      scaledMult(S, x, itm, td, z, wM); // z exakt durch extra Mult.
+      z = (b - z) * dWeight;
     } else {
       z -= q * alpha;
     }
-    r = transMult(S, Vec(z * dWeight * td)) / tm - transMult(C, Vec(wc * wc * (C * Vec(mc * x)))) * mc * lambda - cdx;
+    cx += wcp * alpha;
+
+    scaledTransMult(S, z, dtd, itm, r, wD);
+    scaledTransMult(C, cx, wc, mcl, rc, wC);
+    r -= rc + cdx;
 
     normR2old = normR2;
     normR2 = dot(r, r);
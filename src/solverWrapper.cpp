@@ -17,6 +17,7 @@
  ******************************************************************************/
 
 #include "solverWrapper.h"
+#include "matrix.h"
 #include "sparsematrix.h"
 
 namespace GIMLI{
@@ -47,6 +48,25 @@ SolverWrapper::SolverWrapper(const CSparseMatrix & S,
 
 SolverWrapper::~SolverWrapper(){ }
 
+template < class ValueType >
+int solveRowByRow_(SolverWrapper & solver,
+                   const Matrix < ValueType > & rhs,
+                   Matrix < ValueType > & solution, Index dim){
+    solution.resize(rhs.rows(), dim);
+    for (Index i = 0; i < rhs.rows(); i ++){
+        if (!solver.solve(rhs[i], solution[i])) return 0;
+    }
+    return 1;
+}
+
+int SolverWrapper::solve(const RMatrix & rhs, RMatrix & solution){
+    return solveRowByRow_(*this, rhs, solution, dim_);
+}
+
+int SolverWrapper::solve(const CMatrix & rhs, CMatrix & solution){
+    return solveRowByRow_(*this, rhs, solution, dim_);
+}
+
 
 } //namespace GIMLI;
 
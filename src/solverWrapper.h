@@ -37,6 +37,24 @@ public:
 
     virtual int solve(const CVector & rhs, CVector & solution){ THROW_TO_IMPL return 0;}
 
+    /*! Solve for all right hand sides given as rows of rhs.
+     * Default is one solve per row. */
+    virtual int solve(const RMatrix & rhs, RMatrix & solution);
+
+    /*! Solve for all right hand sides given as rows of rhs.
+     * Default is one solve per row. */
+    virtual int solve(const CMatrix & rhs, CMatrix & solution);
+
+    /*! Numerical refactorisation for a matrix S that shares the sparsity
+     * pattern of the initial matrix. The symbolic analysis is reused.
+     * Return 0 if the wrapper cannot reuse its analysis. */
+    virtual int refactorise(RSparseMatrix & S){ return 0; }
+
+    /*! Numerical refactorisation for a matrix S that shares the sparsity
+     * pattern of the initial matrix. The symbolic analysis is reused.
+     * Return 0 if the wrapper cannot reuse its analysis. */
+    virtual int refactorise(CSparseMatrix & S){ return 0; }
+
 protected:
 
     bool dummy_;
@@ -0,0 +1,457 @@
+/******************************************************************************
+ *   Copyright (C) 2006-2017 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "sparsematrix.h"
+#include "calculateMultiThread.h"
+#include "meshView.h"
+
+#include <set>
+
+#if USE_BOOST_THREAD
+    #include <boost/thread.hpp>
+    /*! Lock the lazy build of the SparseMapMatrix mirrors */
+    static boost::mutex __sparseMapMirror__mutex__;
+#else
+    #include <mutex>
+    static std::mutex __sparseMapMirror__mutex__;
+#endif
+
+namespace GIMLI{
+
+/*! Collect the unique node ids coupled to the nodes [start_, end_). In the
+ * counting pass only the row lengths are written to colPtr[node + 1], in the
+ * filling pass the sorted ids are written to rowIdx[colPtr[node]..]. */
+class SparsityPatternMT : public BaseCalcMT{
+public:
+    SparsityPatternMT(const std::vector < Index > & cellNodePtr,
+                      const std::vector < Index > & cellNodes,
+                      const std::vector < Index > & nodeCellPtr,
+                      const std::vector < Index > & nodeCells,
+                      std::vector < int > & colPtr,
+                      std::vector < int > & rowIdx,
+                      bool fill, bool verbose)
+        : BaseCalcMT(1, verbose),
+          cellNodePtr_(&cellNodePtr), cellNodes_(&cellNodes),
+          nodeCellPtr_(&nodeCellPtr), nodeCells_(&nodeCells),
+          colPtr_(&colPtr), rowIdx_(&rowIdx), fill_(fill){
+    }
+
+    virtual ~SparsityPatternMT(){}
+
+    virtual void calc(Index tNr=0){
+        const std::vector < Index > & cellPtr = *cellNodePtr_;
+        const std::vector < Index > & nodes = *cellNodes_;
+        const std::vector < Index > & ptr = *nodeCellPtr_;
+        const std::vector < Index > & cells = *nodeCells_;
+        std::vector < int > & colPtr = *colPtr_;
+        Index nNodes = ptr.size() - 1;
+
+        //** last node that touched this id, avoids clearing per node.
+        //** Kept over the chunks of this copy, every node is visited once.
+        std::vector < int > & marker = marker_;
+        if (marker.size() != nNodes) marker.assign(nNodes, -1);
+        int * row = 0;
+        if (fill_ && rowIdx_->size()) row = &(*rowIdx_)[0];
+
+        for (Index n = start_; n < end_; n ++){
+            int k = fill_ ? colPtr[n] : 0;
+
+            for (Index c = ptr[n]; c < ptr[n + 1]; c ++){
+                for (Index i = cellPtr[cells[c]]; i < cellPtr[cells[c] + 1]; i ++){
+                    int id = (int)nodes[i];
+                    if (marker[id] != (int)n){
+                        marker[id] = (int)n;
+                        if (fill_) row[k] = id;
+                        k ++;
+                    }
+                }
+            }
+            if (fill_){
+                std::sort(row + colPtr[n], row + k);
+            } else {
+                colPtr[n + 1] = k;
+            }
+        }
+    }
+
+protected:
+    const std::vector < Index > * cellNodePtr_;
+    const std::vector < Index > * cellNodes_;
+    const std::vector < Index > * nodeCellPtr_;
+    const std::vector < Index > * nodeCells_;
+    std::vector < int > * colPtr_;
+    std::vector < int > * rowIdx_;
+    bool fill_;
+    std::vector < int > marker_;
+};
+
+void createSparsityPattern(const Mesh & mesh,
+                           std::vector < int > & colPtr,
+                           std::vector < int > & rowIdx,
+                           Index nThreads){
+    Index nNodes = mesh.nodeCount();
+    Index nCells = mesh.cellCount();
+
+    //** only the topology is needed, the nodes of each cell and the cells
+    //** of each node in compressed form, no geometry as in the mesh view
+    std::vector < Index > cellNodePtr(nCells + 1, 0);
+    for (Index c = 0; c < nCells; c ++){
+        cellNodePtr[c + 1] = cellNodePtr[c] + mesh.cell(c).nodeCount();
+    }
+    std::vector < Index > cellNodes(cellNodePtr[nCells]);
+    std::vector < Index > nodeCellPtr(nNodes + 1, 0);
+    for (Index c = 0; c < nCells; c ++){
+        const Cell & cell = mesh.cell(c);
+        Index * nodes = &cellNodes[cellNodePtr[c]];
+        for (Index i = 0; i < cell.nodeCount(); i ++){
+            nodes[i] = cell.node(i).id();
+            nodeCellPtr[nodes[i] + 1] ++;
+        }
+    }
+    for (Index n = 0; n < nNodes; n ++) nodeCellPtr[n + 1] += nodeCellPtr[n];
+
+    std::vector < Index > nodeCells(nodeCellPtr[nNodes]);
+    std::vector < Index > pos(nodeCellPtr.begin(), nodeCellPtr.end() - 1);
+    for (Index c = 0; c < nCells; c ++){
+        for (Index i = cellNodePtr[c]; i < cellNodePtr[c + 1]; i ++){
+            nodeCells[pos[cellNodes[i]] ++] = c;
+        }
+    }
+
+    //** threads only pay off for larger meshes
+    if (nThreads == 0) nThreads = threadCount();
+    nThreads = std::max(Index(1), std::min(nThreads, nNodes / 10000));
+
+    colPtr.assign(nNodes + 1, 0);
+    distributeCalc(SparsityPatternMT(cellNodePtr, cellNodes, nodeCellPtr, nodeCells,
+                                     colPtr, rowIdx, false, false),
+                   nNodes, nThreads);
+
+    for (Index n = 0; n < nNodes; n ++) colPtr[n + 1] += colPtr[n];
+
+    rowIdx.resize(colPtr[nNodes]);
+    distributeCalc(SparsityPatternMT(cellNodePtr, cellNodes, nodeCellPtr, nodeCells,
+                                     colPtr, rowIdx, true, false),
+                   nNodes, nThreads);
+}
+
+void ElementSlotMap::clear(){
+    slotPtr_.clear();
+    slots_.clear();
+    colorPtr_.clear();
+    colorCells_.clear();
+    nVals_ = 0;
+    stype_ = 0;
+}
+
+void ElementSlotMap::init(const Mesh & mesh,
+                          const std::vector < int > & colPtr,
+                          const std::vector < int > & rowIdx, int stype){
+    this->clear();
+    Index nCells = mesh.cellCount();
+    Index nNodes = mesh.nodeCount();
+    nVals_ = rowIdx.size();
+    stype_ = stype;
+
+    //** element entry to value slot
+    slotPtr_.resize(nCells + 1, 0);
+    for (Index c = 0; c < nCells; c ++){
+        Index n = mesh.cell(c).nodeCount();
+        slotPtr_[c + 1] = slotPtr_[c] + n * n;
+    }
+    slots_.resize(slotPtr_[nCells], -1);
+
+    for (Index c = 0; c < nCells; c ++){
+        const Cell & cell = mesh.cell(c);
+        Index n = cell.nodeCount();
+        int * slot = &slots_[slotPtr_[c]];
+
+        for (Index i = 0; i < n; i ++){
+            int row = cell.node(i).id();
+            if (row + 1 >= (int)colPtr.size()) continue;
+
+            for (Index j = 0; j < n; j ++){
+                int col = cell.node(j).id();
+                if ((stype < 0 && row > col) || (stype > 0 && row < col)) continue;
+
+                for (int k = colPtr[row]; k < colPtr[row + 1]; k ++){
+                    if (rowIdx[k] == col) {
+                        slot[i * n + j] = k;
+                        break;
+                    }
+                }
+                if (slot[i * n + j] < 0){
+                    std::cerr << WHERE_AM_I << " pos " << row << " " << col
+                              << " is not part of the sparsity pattern " << std::endl;
+                }
+            }
+        }
+    }
+
+    //** greedy coloring, cells of one color share no node
+    std::vector < int > nodeColors;
+    std::vector < Index > nodeColorPtr(nNodes + 1, 0);
+    for (Index c = 0; c < nCells; c ++){
+        const Cell & cell = mesh.cell(c);
+        for (Index i = 0; i < cell.nodeCount(); i ++){
+            nodeColorPtr[cell.node(i).id() + 1] ++;
+        }
+    }
+    for (Index n = 0; n < nNodes; n ++) nodeColorPtr[n + 1] += nodeColorPtr[n];
+    nodeColors.resize(nodeColorPtr[nNodes], -1);
+
+    //** nodeColors holds the colors of the already colored cells of a node
+    std::vector < Index > nodeColorCount(nNodes, 0);
+    std::vector < Index > used;
+    std::vector < int > cellColor(nCells, 0);
+    int nColors = 0;
+
+    for (Index c = 0; c < nCells; c ++){
+        const Cell & cell = mesh.cell(c);
+        if (used.size() < (Index)nColors + 1) used.resize(nColors + 1, -1);
+
+        for (Index i = 0; i < cell.nodeCount(); i ++){
+            Index id = cell.node(i).id();
+            for (Index k = 0; k < nodeColorCount[id]; k ++){
+                used[nodeColors[nodeColorPtr[id] + k]] = c;
+            }
+        }
+        int color = 0;
+        while (used[color] == c) color ++;
+        nColors = std::max(nColors, color + 1);
+        cellColor[c] = color;
+
+        for (Index i = 0; i < cell.nodeCount(); i ++){
+            Index id = cell.node(i).id();
+            nodeColors[nodeColorPtr[id] + nodeColorCount[id]] = color;
+            nodeColorCount[id] ++;
+        }
+    }
+
+    colorPtr_.resize(nColors + 1, 0);
+    for (Index c = 0; c < nCells; c ++) colorPtr_[cellColor[c] + 1] ++;
+    for (int i = 0; i < nColors; i ++) colorPtr_[i + 1] += colorPtr_[i];
+
+    colorCells_.resize(nCells);
+    std::vector < Index > pos(colorPtr_.begin(), colorPtr_.end() - 1);
+    for (Index c = 0; c < nCells; c ++) colorCells_[pos[cellColor[c]] ++] = c;
+}
+
+/*! Add the element matrices of the cells [start_, end_) of one color.
+ * Linear simplices are formed from the cached gradients of the mesh view,
+ * all other cells by \ref ElementMatrix. */
+template < class ValueType >
+class AssembleElementMatricesMT : public BaseCalcMT{
+public:
+    AssembleElementMatricesMT(const Mesh & mesh, const MeshView & view,
+                              const ElementSlotMap & map,
+                              const Index * cells,
+                              const Vector < ValueType > & cellScale,
+                              double stiff, double mass,
+                              Vector < ValueType > & vals, bool verbose)
+        : BaseCalcMT(1, verbose), mesh_(&mesh), view_(&view), map_(&map),
+          cells_(cells), cellScale_(&cellScale), stiff_(stiff), mass_(mass),
+          vals_(&vals){
+    }
+
+    virtual ~AssembleElementMatricesMT(){}
+
+    virtual void calc(Index tNr=0){
+        ElementMatrix < double > Su, Sx;
+        std::vector < double > S, M;
+        const Vector < ValueType > & scale = *cellScale_;
+        Vector < ValueType > & vals = *vals_;
+
+        for (Index c = start_; c < end_; c ++){
+            Index id = cells_[c];
+            ValueType s = scale[id];
+            if (s == ValueType(0.0)) continue;
+
+            Index n = view_->cellNodeCount(id);
+            S.assign(n * n, 0.0);
+
+            if (view_->hasGradients(id)){
+                if (stiff_ != 0.0){
+                    view_->stiffness(id, &S[0]);
+                    if (stiff_ != 1.0) for (Index i = 0; i < n * n; i ++) S[i] *= stiff_;
+                }
+                if (mass_ != 0.0){
+                    M.resize(n * n);
+                    view_->mass(id, &M[0]);
+                    for (Index i = 0; i < n * n; i ++) S[i] += mass_ * M[i];
+                }
+            } else {
+                const Cell & cell = mesh_->cell(id);
+                if (stiff_ != 0.0){
+                    Sx.ux2uy2uz2(cell);
+                    for (Index i = 0; i < n; i ++){
+                        for (Index j = 0; j < n; j ++) S[i * n + j] = stiff_ * Sx.getVal(i, j);
+                    }
+                }
+                if (mass_ != 0.0){
+                    Su.u2(cell);
+                    for (Index i = 0; i < n; i ++){
+                        for (Index j = 0; j < n; j ++) S[i * n + j] += mass_ * Su.getVal(i, j);
+                    }
+                }
+            }
+
+            const int * slot = &map_->slots()[map_->slotPtr()[id]];
+
+            for (Index i = 0; i < n * n; i ++){
+                if (slot[i] < 0) continue;
+                ValueType sv = s * S[i];
+                if (abs(sv) > TOLERANCE) vals[slot[i]] += sv;
+            }
+        }
+    }
+
+protected:
+    const Mesh * mesh_;
+    const MeshView * view_;
+    const ElementSlotMap * map_;
+    const Index * cells_;
+    const Vector < ValueType > * cellScale_;
+    double stiff_;
+    double mass_;
+    Vector < ValueType > * vals_;
+};
+
+template < class ValueType >
+void assembleElementMatrices_(const Mesh & mesh, const ElementSlotMap & map,
+                              const Vector < ValueType > & cellScale,
+                              double stiff, double mass,
+                              Vector < ValueType > & vals, Index nThreads){
+    if (cellScale.size() < mesh.cellCount()){
+        throwLengthError(1, WHERE_AM_I + " cell scale size missmatch " +
+                         str(cellScale.size()) + " < " + str(mesh.cellCount()));
+    }
+    if (vals.size() != map.nVals()){
+        throwLengthError(1, WHERE_AM_I + " value size missmatch " +
+                         str(vals.size()) + " != " + str(map.nVals()));
+    }
+    if (mesh.cellCount() == 0) return;
+    if (nThreads == 0) nThreads = threadCount();
+
+    const MeshView & view = mesh.view();
+
+    if (nThreads > 1){
+        //** fill the shared shape function and integration caches once
+        //** before any thread reads them
+        std::set < uint > rttis;
+        ElementMatrix < double > Se;
+        for (Index c = 0; c < mesh.cellCount(); c ++){
+            if (view.hasGradients(c)) continue;
+            const Cell & cell = mesh.cell(c);
+            if (rttis.insert(cell.rtti()).second){
+                if (mass != 0.0) Se.u2(cell);
+                if (stiff != 0.0) Se.ux2uy2uz2(cell);
+            }
+        }
+    }
+
+    for (Index i = 0; i < map.colorCount(); i ++){
+        Index nC = map.colorPtr()[i + 1] - map.colorPtr()[i];
+        Index nT = std::max(Index(1), std::min(nThreads, nC / 1000));
+        distributeCalc(AssembleElementMatricesMT< ValueType >(mesh, view, map,
+                            &map.colorCells()[map.colorPtr()[i]],
+                            cellScale, stiff, mass, vals, false),
+                       nC, nT);
+    }
+}
+
+void assembleElementMatrices(const Mesh & mesh, const ElementSlotMap & map,
+                             const RVector & cellScale,
+                             double stiff, double mass,
+                             RVector & vals, Index nThreads){
+    assembleElementMatrices_(mesh, map, cellScale, stiff, mass, vals, nThreads);
+}
+
+void assembleElementMatrices(const Mesh & mesh, const ElementSlotMap & map,
+                             const CVector & cellScale,
+                             double stiff, double mass,
+                             CVector & vals, Index nThreads){
+    assembleElementMatrices_(mesh, map, cellScale, stiff, mass, vals, nThreads);
+}
+
+/*! ret = A * x for the rows [start_, end_) of a compressed row matrix */
+template < class ValueType > class CompressedRowMultMT : public BaseCalcMT{
+public:
+    CompressedRowMultMT(const Index * ptr, const Index * idx,
+                        const ValueType * vals, const ValueType * x,
+                        ValueType * ret, bool verbose=false)
+        : BaseCalcMT(1, verbose), ptr_(ptr), idx_(idx), vals_(vals),
+          x_(x), ret_(ret){
+    }
+
+    virtual ~CompressedRowMultMT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index i = start_; i < end_; i ++){
+            ValueType s(0.0);
+            for (Index k = ptr_[i]; k < ptr_[i + 1]; k ++){
+                s += vals_[k] * x_[idx_[k]];
+            }
+            ret_[i] = s;
+        }
+    }
+
+protected:
+    const Index * ptr_;
+    const Index * idx_;
+    const ValueType * vals_;
+    const ValueType * x_;
+    ValueType * ret_;
+};
+
+//** values per thread below which the products stay serial
+static const Index compressedValsPerThread__ = 100000;
+
+template < class ValueType >
+void compressedRowMult_(const Index * ptr, const Index * idx,
+                        const ValueType * vals, const ValueType * x,
+                        ValueType * ret, Index rows, Index nThreads){
+    if (rows == 0) return;
+    if (nThreads == 0) nThreads = threadCount();
+    nThreads = std::min(nThreads, ptr[rows] / compressedValsPerThread__);
+    nThreads = std::max(Index(1), std::min(nThreads, rows));
+    distributeCalc(CompressedRowMultMT< ValueType >(ptr, idx, vals, x, ret),
+                   rows, nThreads);
+}
+
+void compressedRowMult(const Index * ptr, const Index * idx,
+                       const double * vals, const double * x,
+                       double * ret, Index rows, Index nThreads){
+    compressedRowMult_(ptr, idx, vals, x, ret, rows, nThreads);
+}
+
+void compressedRowMult(const Index * ptr, const Index * idx,
+                       const Complex * vals, const Complex * x,
+                       Complex * ret, Index rows, Index nThreads){
+    compressedRowMult_(ptr, idx, vals, x, ret, rows, nThreads);
+}
+
+SparseMapMirrorLock::SparseMapMirrorLock(){
+    __sparseMapMirror__mutex__.lock();
+}
+
+SparseMapMirrorLock::~SparseMapMirrorLock(){
+    __sparseMapMirror__mutex__.unlock();
+}
+
+} // namespace GIMLI
@@ -36,19 +36,147 @@
 #include <cassert>
 #include <iostream>
 #include <cmath>
+#include <limits>
 
 namespace GIMLI{
 
 #define SPARSE_NOT_VALID throwError(EXIT_SPARSE_INVALID, WHERE_AM_I + " no data/or sparsity pattern defined.");
 
+/*! Create the compressed node based sparsity pattern of the mesh.
+ * colPtr gets the size nodeCount() + 1, rowIdx holds the sorted unique ids
+ * of all nodes that share a cell with the node. */
+DLLEXPORT void createSparsityPattern(const Mesh & mesh,
+                                     std::vector < int > & colPtr,
+                                     std::vector < int > & rowIdx,
+                                     Index nThreads=0);
+
+/*! Map of the cell element matrix entries of a mesh to the value slots of
+ * a compressed sparsity pattern. Entry (i, j) of cell c belongs to the slot
+ * slots()[slotPtr()[c] + i * n + j] with n = cell.nodeCount() or is ignored
+ * if the slot is -1 (not in the pattern or outside the triangle of stype).
+ * The cells are greedy colored so that cells of one color share no node and
+ * can be added to the matrix concurrently. */
+class DLLEXPORT ElementSlotMap{
+public:
+    ElementSlotMap() : nVals_(0), stype_(0){ }
+
+    /*! Build the map for all cells of mesh and the given pattern. */
+    void init(const Mesh & mesh,
+              const std::vector < int > & colPtr,
+              const std::vector < int > & rowIdx, int stype=0);
+
+    /*! Return true if the map has been build for a mesh with cellCount
+     * cells and a pattern with nVals values and stype. */
+    bool valid(Index cellCount, Index nVals, int stype) const {
+        return slotPtr_.size() == cellCount + 1 && nVals_ == nVals &&
+               stype_ == stype && cellCount > 0;
+    }
+
+    void clear();
+
+    inline const std::vector < Index > & slotPtr() const { return slotPtr_; }
+    inline const std::vector < int > & slots() const { return slots_; }
+
+    /*! Value count of the pattern the map has been build for. */
+    inline Index nVals() const { return nVals_; }
+
+    /*! Number of cell colors. */
+    inline Index colorCount() const { return colorPtr_.size() - 1; }
+
+    /*! Cell indices sorted by color, color i holds the cells
+     * colorCells()[colorPtr()[i] .. colorPtr()[i + 1]). */
+    inline const std::vector < Index > & colorPtr() const { return colorPtr_; }
+    inline const std::vector < Index > & colorCells() const { return colorCells_; }
+
+protected:
+    std::vector < Index > slotPtr_;
+    std::vector < int > slots_;
+    std::vector < Index > colorPtr_;
+    std::vector < Index > colorCells_;
+    Index nVals_;
+    int stype_;
+};
+
+/*! Add the element matrices
+ * cellScale[cell.id()] * (stiff * ux2uy2uz2(cell) + mass * u2(cell))
+ * of all cells to the values vals of the pattern described by map.
+ * Cells with zero scale are skipped. Uses up to nThreads threads
+ * (0 = \ref threadCount()). */
+DLLEXPORT void assembleElementMatrices(const Mesh & mesh,
+                                       const ElementSlotMap & map,
+                                       const RVector & cellScale,
+                                       double stiff, double mass,
+                                       RVector & vals, Index nThreads=0);
+
+DLLEXPORT void assembleElementMatrices(const Mesh & mesh,
+                                       const ElementSlotMap & map,
+                                       const CVector & cellScale,
+                                       double stiff, double mass,
+                                       CVector & vals, Index nThreads=0);
+
+/*! ret[i] = sum(vals[k] * x[idx[k]]) for k = ptr[i] .. ptr[i + 1] and all
+ * i < rows, i.e., the product of a compressed row matrix with x. The rows
+ * are split over up to nThreads threads (0 = \ref threadCount()) if the
+ * matrix is large enough. */
+DLLEXPORT void compressedRowMult(const Index * ptr, const Index * idx,
+                                 const double * vals, const double * x,
+                                 double * ret, Index rows, Index nThreads=0);
+
+DLLEXPORT void compressedRowMult(const Index * ptr, const Index * idx,
+                                 const Complex * vals, const Complex * x,
+                                 Complex * ret, Index rows, Index nThreads=0);
+
+/*! Serial fallback for all other value types. */
+template < class ValueType >
+void compressedRowMult(const Index * ptr, const Index * idx,
+                       const ValueType * vals, const ValueType * x,
+                       ValueType * ret, Index rows, Index nThreads=0){
+    for (Index i = 0; i < rows; i ++){
+        ValueType s(0);
+        for (Index k = ptr[i]; k < ptr[i + 1]; k ++) s += vals[k] * x[idx[k]];
+        ret[i] = s;
+    }
+}
+
+/*! Scoped lock that serializes the lazy build of the product mirrors of
+ * \ref SparseMapMatrix, so const products can be called concurrently. */
+class DLLEXPORT SparseMapMirrorLock{
+public:
+    SparseMapMirrorLock();
+    ~SparseMapMirrorLock();
+};
+
+/*! Compressed row copy of the values of a \ref SparseMapMatrix or of its
+ * transpose, symmetric storage expanded to both triangles. */
+template < class ValueType > class SparseMapMirror{
+public:
+    SparseMapMirror() : revision(none()){ }
+
+    void clear(){
+        revision = none();
+        std::vector < Index >().swap(ptr);
+        std::vector < Index >().swap(idx);
+        std::vector < ValueType >().swap(vals);
+    }
+
+    static inline Index none(){ return std::numeric_limits< Index >::max(); }
+
+    //** revision of the matrix the copy was built from
+    Index revision;
+    std::vector < Index > ptr;
+    std::vector < Index > idx;
+    std::vector < ValueType > vals;
+};
+
 //! based on: Ulrich Breymann, Addison Wesley Longman 2000 , revised edition ISBN 0-201-67488-2, Designing Components with the C++ STL
 template< class ValueType, class IndexType, class ContainerType > class MatrixElement {
 public:
   typedef std::pair< IndexType, IndexType > IndexPair;
   typedef MatrixElement< ValueType, IndexType, ContainerType > & Reference;
 
-  MatrixElement(ContainerType & Cont, IndexType r, IndexType c)
-    : C(Cont), I(C.find(IndexPair(r, c))), row(r), column(c) {
+  /*! revision, if given, is increased on every write. */
+  MatrixElement(ContainerType & Cont, IndexType r, IndexType c, Index * revision=0)
+    : C(Cont), I(C.find(IndexPair(r, c))), row(r), column(c), revision_(revision) {
   }
 
   /* An assignment operator is required which in turn requires a
@@ -85,6 +213,7 @@ public:
      stored in the container. */
 
   Reference operator = (const ValueType & x) {
+    touch_();
     // not equal 0?
     if (x != ValueType(0)) {
       /* If the element does not yet exist, it is put, together
@@ -118,6 +247,7 @@ public:
 
   Reference operator += (const ValueType & x) {
     if (x != ValueType(0)) {
+      touch_();
       if (I == C.end()) {
         assert(C.size() < C.max_size());
         I = (C.insert(typename ContainerType::value_type(IndexPair(row, column), x))).first;
@@ -128,6 +258,7 @@ public:
 
   Reference operator -= (const ValueType & x) {
     if (x != ValueType(0)) {
+      touch_();
       if (I == C.end()) {
         assert(C.size() < C.max_size());
         I = (C.insert(typename ContainerType::value_type(IndexPair(row, column), -x))).first;
@@ -137,14 +268,24 @@ public:
   }
 
 private:
+  inline void touch_(){ if (revision_) (*revision_) ++; }
+
   ContainerType & C;
   typename ContainerType::iterator I;
   IndexType row, column;
+  Index * revision_;
 
 };  // class MatrixElement
 
 
 //! based on: Ulrich Breymann, Addison Wesley Longman 2000 , revised edition ISBN 0-201-67488-2, Designing Components with the C++ STL
+/*! The products with vectors don't walk the map. On first use a
+ * compressed row mirror of the matrix (mult) or of its transpose
+ * (transMult) is build and cached until the next change, i.e., a write
+ * through operator [], setVal, addVal, the non-const iterators or a
+ * resize. Reads don't drop the mirrors. Values changed through iterators
+ * that are kept across a product are not noticed, call a non-const
+ * access afterwards. */
 template< class ValueType, class IndexType >
 class SparseMapMatrix : public MatrixBase {
 public:
@@ -156,16 +297,16 @@ public:
 
     /*!stype .. symmetric style. stype=0 (full), stype=1 (UpperRight), stype=2 (LowerLeft)*/
     SparseMapMatrix(IndexType r=0, IndexType c=0, int stype=0)
-        : MatrixBase(), rows_(r), cols_(c), stype_(stype) {
+        : MatrixBase(), rows_(r), cols_(c), stype_(stype), nThreads_(0), revision_(0) {
     }
 
     SparseMapMatrix(const std::string & filename)
-        : MatrixBase(){
+        : MatrixBase(), nThreads_(0), revision_(0){
         this->load(filename);
     }
 
     SparseMapMatrix(const SparseMapMatrix< ValueType, IndexType > & S)
-        : MatrixBase(){
+        : MatrixBase(), nThreads_(S.nThreads_), revision_(0){
         clear();
         cols_ = S.cols();
         rows_ = S.rows();
@@ -176,14 +317,14 @@ public:
         }
     }
     SparseMapMatrix(const SparseMatrix< ValueType > & S)
-        : MatrixBase(){
+        : MatrixBase(), nThreads_(0), revision_(0){
         this->copy_(S);
     }
 
     /*! Contruct Map Matrix from 3 arrays of the same length.
      *Number of colums are max(j)+1 and Number of rows are max(i)+1.*/
     SparseMapMatrix(const IndexArray & i, const IndexArray & j, const RVector & v)
-        : MatrixBase(){
+        : MatrixBase(), nThreads_(0), revision_(0){
         ASSERT_EQUAL(i.size(), j.size())
         ASSERT_EQUAL(i.size(), v.size())
         stype_ = 0;
@@ -214,6 +355,7 @@ public:
     void resize(Index rows, Index cols){
         rows_ = rows;
         cols_ = cols;
+        invalidateMirrors_();
     }
 
     /*! Return entity rtti value. */
@@ -239,16 +381,18 @@ public:
     virtual void clear() {
         C_.clear();
         cols_ = 0; rows_ = 0; stype_ = 0;
+        rowMirror_.clear();
+        colMirror_.clear();
     }
 
     /*! symmetric type. 0 = nonsymmetric, -1 symmetric lower part, 1 symmetric upper part.*/
     inline int stype() const {return stype_;}
 
-    inline void setRows(IndexType r) { rows_ = r ; }
+    inline void setRows(IndexType r) { rows_ = r ; invalidateMirrors_(); }
     virtual IndexType rows()     const { return rows_; }
     virtual IndexType nRows()     const { return rows_; }
 
-    inline void setCols(IndexType c) { cols_ = c ; }
+    inline void setCols(IndexType c) { cols_ = c ; invalidateMirrors_(); }
     virtual IndexType cols()     const { return cols_; }
     virtual IndexType nCols()     const { return cols_; }
 
@@ -256,8 +400,8 @@ public:
     inline IndexType max_size() const { return C_.max_size(); }
     inline IndexType nVals()    const { return C_.size(); }
 
-    inline iterator begin() { return C_.begin(); }
-    inline iterator end() { return C_.end(); }
+    inline iterator begin() { invalidateMirrors_(); return C_.begin(); }
+    inline iterator end() { invalidateMirrors_(); return C_.end(); }
 
     inline const_iterator begin() const { return C_.begin(); }
     inline const_iterator end()   const { return C_.end(); }
@@ -319,8 +463,9 @@ public:
 
     class Aux {  // for index operator below
     public:
-        Aux(IndexType r, IndexType maxs, ContainerType & Cont, int stype)
-            : Row(r), maxColumns(maxs), C(Cont), stype_(stype) { }
+        Aux(IndexType r, IndexType maxs, ContainerType & Cont, int stype,
+            Index * revision=0)
+            : Row(r), maxColumns(maxs), C(Cont), stype_(stype), revision_(revision) { }
 
         MatElement operator [] (IndexType c) {
 //             __MS( stype_ << " " << c << " " << Row )
@@ -329,21 +474,52 @@ public:
                                   WHERE_AM_I + " idx = " + toStr(c) + ", " + str(Row) + " maxcol = "
                                   + toStr(maxColumns) + " stype: " + toStr(stype_));
             }
-            return MatElement(C, Row, c);
+            return MatElement(C, Row, c, revision_);
         }
     protected:
         IndexType Row, maxColumns;
         ContainerType & C;
         int stype_;
+        Index * revision_;
+    };
+
+    class ConstAux {  // read only index operator below
+    public:
+        ConstAux(IndexType r, IndexType maxs, const ContainerType & Cont, int stype)
+            : Row(r), maxColumns(maxs), C(Cont), stype_(stype) { }
+
+        ValueType operator [] (IndexType c) const {
+            if ((c < 0 || c >= maxColumns) || (stype_ < 0 && c < Row) || (stype_ > 0 && c > Row)) {
+                throwLengthError(EXIT_SPARSE_SIZE,
+                                  WHERE_AM_I + " idx = " + toStr(c) + ", " + str(Row) + " maxcol = "
+                                  + toStr(maxColumns) + " stype: " + toStr(stype_));
+            }
+            typename ContainerType::const_iterator it(C.find(IndexPair(Row, c)));
+            return it == C.end() ? ValueType(0) : it->second;
+        }
+    protected:
+        IndexType Row, maxColumns;
+        const ContainerType & C;
+        int stype_;
     };
 
+    /*! Element access, the mirrors are dropped on writes only. */
     Aux operator [] (IndexType r) {
         if (r < 0 || r >= rows_){
             throwLengthError(EXIT_SPARSE_SIZE,
                               WHERE_AM_I + " idx = " + toStr(r) + " maxrow = "
                               + toStr(rows_));
         }
-        return Aux(r, cols(), C_, stype_);
+        return Aux(r, cols(), C_, stype_, &revision_);
+    }
+
+    ConstAux operator [] (IndexType r) const {
+        if (r < 0 || r >= rows_){
+            throwLengthError(EXIT_SPARSE_SIZE,
+                              WHERE_AM_I + " idx = " + toStr(r) + " maxrow = "
+                              + toStr(rows_));
+        }
+        return ConstAux(r, cols(), C_, stype_);
     }
 
     inline IndexType idx1(const const_iterator & I) const { return (*I).first.first; }
@@ -354,9 +530,9 @@ public:
 
     inline const ValueType & val(const const_iterator & I) const { return (*I).second;  }
 
-    inline ValueType & val(const iterator & I) { return (*I).second;  }
+    inline ValueType & val(const iterator & I) { invalidateMirrors_(); return (*I).second;  }
 
-    inline ValueType getVal(IndexType i, IndexType j) { return (*this)[i][j]; }
+    inline ValueType getVal(IndexType i, IndexType j) const { return (*this)[i][j]; }
 
     inline void setVal(IndexType i, IndexType j, const ValueType & val) {
         if ((stype_ < 0 && i > j) || (stype_ > 0 && i < j)) return;
@@ -387,60 +563,34 @@ public:
 
     /*! Return this * a  */
     virtual Vector < ValueType > mult(const Vector < ValueType > & a) const {
-        Vector < ValueType > ret(this->rows(), 0.0);
-
-        ASSERT_EQUAL(this->cols(), a.size())
-
-        if (stype_ == 0){
-            for (const_iterator it = this->begin(); it != this->end(); it ++){
-                ret[it->first.first] += a[it->first.second] * it->second;
-            }
-        } else if (stype_ == -1){
-
-            for (const_iterator it = this->begin(); it != this->end(); it ++){
-                IndexType I = it->first.first;
-                IndexType J = it->first.second;
-
-                ret[I] += a[J] * conj(it->second);
-
-                if (J > I){
-                    ret[J] += a[I] * it->second;
-                }
-            }
-        } else if (stype_ ==  1){
-            for (const_iterator it = this->begin(); it != this->end(); it ++){
-                IndexType I = it->first.first;
-                IndexType J = it->first.second;
-
-                ret[I] += a[J] * conj(it->second);
-
-                if (J < I){
-                    ret[J] += a[I] * it->second;
-                }
-            }
-
-        }
+        Vector < ValueType > ret(this->rows());
+        this->mult(a, ret);
         return ret;
     }
 
     /*! Return this.T * a */
     virtual Vector < ValueType > transMult(const Vector < ValueType > & a) const {
-        Vector < ValueType > ret(this->cols(), 0.0);
+        Vector < ValueType > ret(this->cols());
+        this->transMult(a, ret);
+        return ret;
+    }
 
-        ASSERT_EQUAL(this->rows(), a.size())
+    /*! ret = this * a, ret is resized if needed. */
+    void mult(const Vector < ValueType > & a, Vector < ValueType > & ret) const {
+        ASSERT_EQUAL(this->cols(), a.size())
+        mirrorMult_(rowMirror_, false, a, ret, this->rows());
+    }
 
-        if (stype_ == 0){
-            for (const_iterator it = this->begin(); it != this->end(); it ++){
-                ret[it->first.second] += a[it->first.first] * it->second;
-            }
-        } else if (stype_ == -1){
-            THROW_TO_IMPL
-        } else if (stype_ ==  1){
-            THROW_TO_IMPL
-        }
-        return ret;
+    /*! ret = this.T * a, ret is resized if needed. */
+    void transMult(const Vector < ValueType > & a, Vector < ValueType > & ret) const {
+        ASSERT_EQUAL(this->rows(), a.size())
+        mirrorMult_(colMirror_, true, a, ret, this->cols());
     }
 
+    /*! Set the maximum number of threads for the products,
+     * 0 (default) uses \ref threadCount(). */
+    inline void setThreadCount(Index nThreads) { nThreads_ = nThreads; }
+
     virtual Vector < ValueType > col(const Index i) {
         Vector < ValueType > null(this->cols(), 0.0);
         null[i] = 1.0;
@@ -518,12 +668,74 @@ public:
         importCol(filename, dropTol, 0);
     }
 protected:
+    inline void invalidateMirrors_(){ revision_ ++; }
+
+    void mirrorMult_(SparseMapMirror< ValueType > & m, bool trans,
+                     const Vector < ValueType > & a, Vector < ValueType > & ret,
+                     Index n) const {
+        {
+            SparseMapMirrorLock lock;
+            if (m.revision != revision_) buildMirror_(m, trans);
+        }
+        if (ret.size() != n) ret.resize(n);
+        if (n == 0) return;
+        compressedRowMult(&m.ptr[0], m.idx.size() ? &m.idx[0] : NULL,
+                          m.vals.size() ? &m.vals[0] : NULL,
+                          a.size() ? &a[0] : NULL, &ret[0], n, nThreads_);
+    }
+
+    /*! Fill m with the rows of this (trans=false) or this.T (trans=true).
+     * Symmetric storage: the stored (I, J) is conj(v) and the mirrored
+     * (J, I) is v, the same as the former map based products. Entries
+     * outside the current size are ignored. */
+    void buildMirror_(SparseMapMirror< ValueType > & m, bool trans) const {
+        Index n = trans ? cols_ : rows_;
+        m.ptr.assign(n + 1, 0);
+
+        for (const_iterator it = C_.begin(); it != C_.end(); it ++){
+            Index I = it->first.first, J = it->first.second;
+            if (I >= (Index)rows_ || J >= (Index)cols_) continue;
+            m.ptr[(trans ? J : I) + 1] ++;
+            if (isMirrored_(I, J)) m.ptr[(trans ? I : J) + 1] ++;
+        }
+        for (Index i = 0; i < n; i ++) m.ptr[i + 1] += m.ptr[i];
+
+        m.idx.resize(m.ptr[n]);
+        m.vals.resize(m.ptr[n]);
+        std::vector < Index > fill(m.ptr.begin(), m.ptr.end() - 1);
+
+        for (const_iterator it = C_.begin(); it != C_.end(); it ++){
+            Index I = it->first.first, J = it->first.second;
+            if (I >= (Index)rows_ || J >= (Index)cols_) continue;
+            Index row = trans ? J : I, col = trans ? I : J;
+            Index k = fill[row] ++;
+            m.idx[k] = col;
+            m.vals[k] = stype_ == 0 ? it->second : ValueType(conj(it->second));
+            if (isMirrored_(I, J)){
+                k = fill[col] ++;
+                m.idx[k] = row;
+                m.vals[k] = it->second;
+            }
+        }
+        m.revision = revision_;
+    }
+
+    inline bool isMirrored_(Index I, Index J) const {
+        return (stype_ == -1 && J > I) || (stype_ == 1 && J < I);
+    }
 
   IndexType rows_, cols_;
   ContainerType C_;
   // 0 .. nonsymmetric, -1 symmetric lower part, 1 symmetric upper part
   int stype_;
 
+  Index nThreads_;
+  //** increased on every change, the mirrors are valid for one revision
+  Index revision_;
+  //** cached compressed rows of this and this.T for the products
+  mutable SparseMapMirror< ValueType > rowMirror_;
+  mutable SparseMapMirror< ValueType > colMirror_;
+
 
 };// class SparseMapMatrix
 
@@ -814,6 +1026,56 @@ public:
         return ret;
     }
 
+    /*! Return the products this * X[i] for all rows of X as rows of the
+     * returned matrix. The matrix is traversed only once for all rows. */
+    Matrix < ValueType > mult(const Matrix < ValueType > & X) const {
+        Index m = X.rows();
+        Matrix < ValueType > ret(m, this->rows());
+        if (m == 0) return ret;
+
+        if (X.cols() < this->cols()){
+            throwLengthError(1, WHERE_AM_I + " SparseMatrix size(): " + toStr(this->cols()) + " X.cols(): " +
+                                toStr(X.cols())) ;
+        }
+
+        //** interleave the rows of X to get contiguous inner loops
+        std::vector < ValueType > x(this->cols() * m);
+        std::vector < ValueType > y(std::max(this->rows(), this->size()) * m,
+                                    ValueType(0.0));
+        for (Index r = 0; r < m; r ++){
+            for (Index j = 0; j < this->cols(); j ++) x[j * m + r] = X[r][j];
+        }
+
+        for (Index i = 0; i < this->size(); i++){
+            ValueType * yi = &y[i * m];
+            const ValueType * xi = &x[i * m];
+
+            for (int j = colPtr_[i]; j < colPtr_[i + 1]; j ++){
+                Index J = rowIdx_[j];
+                const ValueType * xJ = &x[J * m];
+
+                if (stype_ == 0){
+                    ValueType v = vals_[j];
+                    for (Index r = 0; r < m; r ++) yi[r] += xJ[r] * v;
+                } else {
+                    ValueType v = conj(vals_[j]);
+                    for (Index r = 0; r < m; r ++) yi[r] += xJ[r] * v;
+
+                    if ((stype_ == -1 && J > i) || (stype_ == 1 && J < i)){
+                        ValueType * yJ = &y[J * m];
+                        v = vals_[j];
+                        for (Index r = 0; r < m; r ++) yJ[r] += xi[r] * v;
+                    }
+                }
+            }
+        }
+
+        for (Index r = 0; r < m; r ++){
+            for (Index i = 0; i < this->rows(); i ++) ret[r][i] = y[i * m + r];
+        }
+        return ret;
+    }
+
     /*! Return this.T * a */
     virtual Vector < ValueType > transMult(const Vector < ValueType > & a) const {
 
@@ -952,73 +1214,29 @@ public:
         valid_ = true;
     }
 
-    void buildSparsityPattern(const Mesh & mesh){
-        Stopwatch swatch(true);
-
-        colPtr_.resize(mesh.nodeCount() + 1);
-
-        //*** much to slow
-        //RSparseMapMatrix S(mesh.nodeCount(), mesh.nodeCount());
-
-        Index col = 0, row = 0;
-
-        // need unique(sort) maybe to slow
-//        std::vector < std::vector< Index > > idxMap(mesh.nodeCount());
-//         for (std::vector < std::vector< Index > >::iterator mIt = idxMap.begin(); mIt != idxMap.end(); mIt++){
-//             (*mIt).reserve(100);
-//         }
-
-// using set is by a factor of approx 5 more expensive
-        std::vector < std::set< Index > > idxMap(mesh.nodeCount());
-
-        Cell *cell = 0;
-        uint nc = 0;
-
-        for (uint c = 0; c < mesh.cellCount(); c ++){
-            cell = &mesh.cell(c);
-            nc = cell->nodeCount();
-
-            for (uint i = 0; i < nc; i ++){
-                for (uint j = 0; j < nc; j ++){
-                    row = cell->node(i).id();
-                    col = cell->node(j).id();
-                    //idxMap[col].push_back(row);
-                    idxMap[col].insert(row);
-                    //S[col][row] = 1;
-                }
-            }
-        }
-
-        int nVals = 0;
-        for (std::vector < std::set< Index > >::iterator mIt = idxMap.begin();
-             mIt != idxMap.end(); mIt++){
-            //std::sort((*mIt).begin(), (*mIt).end());
-            nVals += (*mIt).size();
-        }
-
-//         std::cout << "timwe: " << swatch.duration( true) << std::endl;
-//         exit(0);
-
-        rowIdx_.reserve(nVals);
-        rowIdx_.resize(nVals);
-        vals_.resize(nVals);
+    /*! Build the node based sparsity pattern of the mesh. All values are
+     * set to zero. Uses up to nThreads threads (0 = \ref threadCount()). */
+    void buildSparsityPattern(const Mesh & mesh, Index nThreads=0){
+        createSparsityPattern(mesh, colPtr_, rowIdx_, nThreads);
 
-        colPtr_[0] = 0;
-        Index k = 0;
-        row = 0;
-        for (std::vector < std::set< Index > >::iterator mIt = idxMap.begin(); mIt != idxMap.end(); mIt++){
-            for (std::set< Index >::iterator sIt = (*mIt).begin(); sIt != (*mIt).end(); sIt++){
-                rowIdx_[k] = (*sIt);
-                vals_[k] = (ValueType)0.0;
-                k++;
-            }
-            row++;
-            colPtr_[row] = k;
-        }
+        vals_.resize(rowIdx_.size());
+        clean();
         valid_ = true;
         cols_ = colPtr_.size() - 1;
         rows_ = max(rowIdx_) + 1;
-        //** freeing idxMap ist expensive
+    }
+
+    /*! Take the sparsity pattern of S. All values are set to zero.*/
+    template < class V >
+    void buildSparsityPattern(const SparseMatrix < V > & S){
+        colPtr_ = S.vecColPtr();
+        rowIdx_ = S.vecRowIdx();
+        vals_.resize(rowIdx_.size());
+        clean();
+        stype_ = S.stype();
+        valid_ = S.valid();
+        cols_ = S.cols();
+        rows_ = S.rows();
     }
 
     void fillStiffnessMatrix(const Mesh & mesh){
@@ -1029,13 +1247,7 @@ public:
     void fillStiffnessMatrix(const Mesh & mesh, const RVector & a){
         clean();
         buildSparsityPattern(mesh);
-        ElementMatrix < double > A_l;
-
-        for (uint i = 0; i < mesh.cellCount(); i ++){
-            A_l.ux2uy2uz2(mesh.cell(i));
-            A_l *= a[mesh.cell(i).id()];
-            *this += A_l;
-        }
+        assemble(mesh, a, 1.0, 0.0);
     }
     void fillMassMatrix(const Mesh & mesh){
         RVector a(mesh.cellCount(), 1.0);
@@ -1045,13 +1257,31 @@ public:
     void fillMassMatrix(const Mesh & mesh, const RVector & a){
         clean();
         buildSparsityPattern(mesh);
-        ElementMatrix < double > A_l;
+        assemble(mesh, a, 0.0, 1.0);
+    }
+
+    /*! Add a[cell.id()] * (stiff * ux2uy2uz2(cell) + mass * u2(cell)) for
+     * all cells of the mesh. The element to pattern slot map is build on
+     * the fly, use \ref assemble(mesh, map, ...) to reuse it. */
+    void assemble(const Mesh & mesh, const RVector & a,
+                  double stiff, double mass){
+        ElementSlotMap map;
+        map.init(mesh, colPtr_, rowIdx_, stype_);
+        Vector < ValueType > scale(a.size());
+        for (Index i = 0; i < a.size(); i ++) scale[i] = a[i];
+        assemble(mesh, map, scale, stiff, mass);
+    }
 
-        for (uint i = 0; i < mesh.cellCount(); i ++){
-            A_l.u2(mesh.cell(i));
-            A_l *= a[mesh.cell(i).id()];
-            *this += A_l;
+    /*! Add scale[cell.id()] * (stiff * ux2uy2uz2(cell) + mass * u2(cell))
+     * for all cells of the mesh using a precomputed map of this pattern. */
+    void assemble(const Mesh & mesh, const ElementSlotMap & map,
+                  const Vector < ValueType > & scale,
+                  double stiff, double mass, Index nThreads=0){
+        if (!valid_) SPARSE_NOT_VALID;
+        if (!map.valid(mesh.cellCount(), nVals(), stype_)){
+            throwLengthError(1, WHERE_AM_I + " element slot map does not fit the sparsity pattern.");
         }
+        assembleElementMatrices(mesh, map, scale, stiff, mass, vals_, nThreads);
     }
 
     /*! symmetric type. 0 = nonsymmetric, -1 symmetric lower part, 1 symmetric upper part.*/
@@ -30,80 +30,141 @@
 #include "numericbase.h"
 #include "regionManager.h"
 #include "sparsematrix.h"
+#include "calculateMultiThread.h"
 
 #include <vector>
 #include <queue>
 #include <map>
+#include <limits>
 
 namespace GIMLI {
 
-Dijkstra::Dijkstra(const Graph & graph) : graph_(graph) {
-    pathMatrix_.resize(graph.size());
+Dijkstra::Dijkstra(const Graph & graph) : root_(0) {
+    setGraph(graph);
 }
 
 RVector Dijkstra::distances() const {
-    RVector ret(0);
-    for (auto const & it: distances_){
-        ret.push_back(it.second);
-    }
+    RVector ret(distances_.size());
+    for (Index i = 0; i < distances_.size(); i ++) ret[i] = distances_[i];
     return ret;
 }
 
 void Dijkstra::setGraph(const Graph & graph) {
-    graph_ = graph;
-    pathMatrix_.clear();
-    pathMatrix_.resize(graph.size());
-}
+    Index nNodes = 0;
+    if (!graph.empty()) nNodes = graph.rbegin()->first + 1;
+    for (auto const & it: graph){
+        if (!it.second.empty()) nNodes = std::max(nNodes, Index(it.second.rbegin()->first + 1));
+    }
 
-void Dijkstra::setStartNode(Index startNode) {
-    distances_.clear();
-    root_ = startNode;
-    std::priority_queue< distancePair_,
-                         std::vector< distancePair_ >,
-                         comparePairsClass_< distancePair_ > > priQueue;
+    std::vector < Index > adjPtr(nNodes + 1, 0);
+    std::vector < Index > adjNodes;
+    std::vector < double > adjDist;
+
+    for (auto const & it: graph) adjPtr[it.first + 1] = it.second.size();
+    for (Index i = 0; i < nNodes; i ++) adjPtr[i + 1] += adjPtr[i];
+
+    adjNodes.reserve(adjPtr[nNodes]);
+    adjDist.reserve(adjPtr[nNodes]);
+    for (auto const & it: graph){
+        for (auto const & jt: it.second){
+            adjNodes.push_back(jt.first);
+            adjDist.push_back(jt.second);
+        }
+    }
+    swapGraph(adjPtr, adjNodes, adjDist);
+}
 
-    edge_ e(startNode, startNode);
-    priQueue.push(distancePair_(0.0, e));
-    distancePair_ dummy;
+void Dijkstra::swapGraph(std::vector < Index > & adjPtr,
+                         std::vector < Index > & adjNodes,
+                         std::vector < double > & adjDist) {
+    if (adjPtr.empty() || adjNodes.size() != adjPtr.back() ||
+        adjDist.size() != adjNodes.size()){
+        throwError(1, WHERE_AM_I + " Warning! Dijkstra graph invalid" );
+    }
+    adjPtr_.swap(adjPtr);
+    adjNodes_.swap(adjNodes);
+    adjDist_.swap(adjDist);
+    adjPtr.clear();
+    adjNodes.clear();
+    adjDist.clear();
 
-    while (!priQueue.empty()) {
-        dummy = priQueue.top();
+    pathMatrix_.clear();
+    distances_.clear();
+}
 
-        double distance = dummy.first;
-        int node = dummy.second.end;
-        priQueue.pop();
+void Dijkstra::swapWeights(std::vector < double > & adjDist) {
+    if (adjDist.size() != adjNodes_.size()){
+        throwError(1, WHERE_AM_I + " Warning! Dijkstra graph invalid" );
+    }
+    adjDist_.swap(adjDist);
+    pathMatrix_.clear();
+    distances_.clear();
+}
 
-        if (distances_.count(node) == 0) {
-            distances_[node] = distance;
-            if ((int)pathMatrix_.size() <= node){
-                throwError(1, WHERE_AM_I + " Warning! Dijkstra graph invalid" );
-            }
-            pathMatrix_[node] = edge_(dummy.second);
+void Dijkstra::setStartNode(Index startNode) {
+    root_ = startNode;
+    shortestPaths(startNode, distances_, pathMatrix_);
+}
 
-            NodeDistMap::iterator start = graph_[node].begin();
-            NodeDistMap::iterator stop = graph_[node].end();
+void Dijkstra::shortestPaths(Index startNode, std::vector < double > & dist,
+                             std::vector < SIndex > & pred) const {
+    Index nNodes = nodeCount();
+    if (startNode >= nNodes){
+        throwError(1, WHERE_AM_I + " Warning! Dijkstra graph invalid" );
+    }
 
-            for (; start != stop; ++start) {
-                e.start = node;
-                e.end = (*start).first;
-                priQueue.push(distancePair_(distance + (*start).second, e));
+    dist.assign(nNodes, std::numeric_limits< double >::max());
+    pred.assign(nNodes, -1);
+
+    typedef std::pair< double, Index > DistNode;
+    std::priority_queue< DistNode,
+                         std::vector< DistNode >,
+                         std::greater< DistNode > > heap;
+
+    dist[startNode] = 0.0;
+    pred[startNode] = startNode;
+    heap.push(DistNode(0.0, startNode));
+
+    while (!heap.empty()) {
+        double d = heap.top().first;
+        Index node = heap.top().second;
+        heap.pop();
+
+        //** outdated heap entry, node has been settled already
+        if (d > dist[node]) continue;
+
+        for (Index k = adjPtr_[node]; k < adjPtr_[node + 1]; k ++) {
+            Index next = adjNodes_[k];
+            double nd = d + adjDist_[k];
+            if (nd < dist[next]) {
+                dist[next] = nd;
+                pred[next] = node;
+                heap.push(DistNode(nd, next));
             }
         }
     }
+
+    for (Index i = 0; i < nNodes; i ++) if (pred[i] < 0) dist[i] = 0.0;
 }
 
 std::vector < Index > Dijkstra::shortestPathTo(Index node) const {
+    return shortestPathTo(node, pathMatrix_);
+}
+
+std::vector < Index > Dijkstra::shortestPathTo(Index node,
+                                               const std::vector < SIndex > & pred) const {
     std::vector < Index > way;
 
-    int parentNode = -1, endNode = node;
+    if (node >= pred.size() || pred[node] < 0){
+        throwError(1, WHERE_AM_I + " node " + str(node) + " is not reachable." );
+    }
 
-    while (parentNode != root_) {
-        parentNode = pathMatrix_[endNode].start;
+    Index endNode = node;
+    while (pred[endNode] != SIndex(endNode)) {
         way.push_back(endNode);
-        endNode = pathMatrix_[endNode].start;
+        endNode = pred[endNode];
     }
-
-    way.push_back(root_);
+    way.push_back(endNode);
 
     std::vector < Index > rway(way.size());
     for (Index i = 0; i < way.size(); i ++) rway[i] = way[way.size() - i - 1];
@@ -111,6 +172,52 @@ std::vector < Index > Dijkstra::shortestPathTo(Index node) const {
     return rway;
 }
 
+class DijkstraShotsMT : public BaseCalcMT{
+public:
+    DijkstraShotsMT(const Dijkstra & dijkstra,
+                    const std::vector < Index > & shotNodes,
+                    const std::vector < Index > & receNodes,
+                    RMatrix * dMap,
+                    std::vector < std::vector < std::vector < Index > > > * ways,
+                    bool verbose)
+        : BaseCalcMT(1, verbose), dijkstra_(&dijkstra), shotNodes_(&shotNodes),
+          receNodes_(&receNodes), dMap_(dMap), ways_(ways){
+    }
+
+    virtual ~DijkstraShotsMT(){}
+
+    virtual void calc(Index tNr=0){
+        //** own buffers for every thread, kept over its chunks
+        std::vector < double > & dist = dist_;
+        std::vector < SIndex > & pred = pred_;
+        const std::vector < Index > & receNodes = *receNodes_;
+
+        for (Index shot = start_; shot < end_; shot ++){
+            dijkstra_->shortestPaths((*shotNodes_)[shot], dist, pred);
+
+            if (dMap_){
+                for (Index i = 0; i < receNodes.size(); i ++) {
+                    (*dMap_)[shot][i] = dist[receNodes[i]];
+                }
+            }
+            if (ways_){
+                (*ways_)[shot].resize(receNodes.size());
+                for (Index i = 0; i < receNodes.size(); i ++) {
+                    (*ways_)[shot][i] = dijkstra_->shortestPathTo(receNodes[i], pred);
+                }
+            }
+        }
+    }
+
+protected:
+    const Dijkstra * dijkstra_;
+    const std::vector < Index > * shotNodes_;
+    const std::vector < Index > * receNodes_;
+    RMatrix * dMap_;
+    std::vector < std::vector < std::vector < Index > > > * ways_;
+    std::vector < double > dist_;
+    std::vector < SIndex > pred_;
+};
 
 //    RVector TravelTimeDijkstraModelling::operator () (const RVector & slowness, double background) {
 //        return response(slowness, background);
@@ -135,66 +242,207 @@ RVector TravelTimeDijkstraModelling::createDefaultStartModel() {
 }
 
 Graph TravelTimeDijkstraModelling::createGraph(const RVector & slownessPerCell) const {
+    std::vector < Index > adjPtr, adjNodes;
+    std::vector < double > adjDist;
+    createGraph(slownessPerCell, adjPtr, adjNodes, adjDist);
+
     Graph meshGraph;
+    for (Index i = 0; i < adjPtr.size() - 1; i ++) {
+        if (adjPtr[i] == adjPtr[i + 1]) continue;
+        NodeDistMap & row = meshGraph[i];
+        for (Index k = adjPtr[i]; k < adjPtr[i + 1]; k ++) {
+            row[adjNodes[k]] = adjDist[k];
+        }
+    }
+    return meshGraph;
+}
 
-    double dist, oldTime, newTime;
+/*! Graph topology of the mesh in compressed row storage. For every graph
+ * edge k the cells edgeCells[edgeCellPtr[k]] .. [edgeCellPtr[k + 1] - 1]
+ * define its weight in the order of the former map based graph creation.
+ * edgeCellLength holds the edge length for every of these cells, negative
+ * for updates that overwrite the former weight (tetrahedron diagonals). */
+static void createMeshGraphTopology(const Mesh & mesh,
+                                    std::vector < Index > & adjPtr,
+                                    std::vector < Index > & adjNodes,
+                                    std::vector < Index > & edgeCellPtr,
+                                    std::vector < Index > & edgeCells,
+                                    std::vector < double > & edgeCellLength){
+    Index nNodes = mesh.nodeCount();
+    Index nCells = mesh.cellCount();
+
+    //** node -> cell map in compressed row storage, cells in ascending order
+    std::vector < Index > nodeCellPtr(nNodes + 1, 0);
+    for (Index i = 0; i < nCells; i ++) {
+        const Cell & cell = mesh.cell(i);
+        if (cell.rtti() > MESH_TETRAHEDRON10_RTTI){
+            THROW_TO_IMPL
+        }
+        for (Index j = 0; j < cell.nodeCount(); j ++) nodeCellPtr[cell.node(j).id() + 1] ++;
+    }
+    for (Index n = 0; n < nNodes; n ++) nodeCellPtr[n + 1] += nodeCellPtr[n];
+
+    std::vector < Index > nodeCells(nodeCellPtr[nNodes]);
+    std::vector < Index > fill(nodeCellPtr.begin(), nodeCellPtr.end() - 1);
+    for (Index i = 0; i < nCells; i ++) {
+        const Cell & cell = mesh.cell(i);
+        for (Index j = 0; j < cell.nodeCount(); j ++) {
+            Index n = cell.node(j).id();
+            //** a node can be listed twice within a cell
+            if (fill[n] > nodeCellPtr[n] && nodeCells[fill[n] - 1] == i) continue;
+            nodeCells[fill[n] ++] = i;
+        }
+    }
 
-    for (Index i = 0; i < mesh_->cellCount(); i ++) {
-        for (Index j = 0; j < mesh_->cell(i).nodeCount(); j ++) {
-            Node *na = &mesh_->cell(i).node(j);
-            Node *nb = &mesh_->cell(i).node((j + 1)%mesh_->cell(i).nodeCount());
-            dist = na->pos().distance(nb->pos());
+    adjPtr.assign(nNodes + 1, 0);
+    adjNodes.clear();
+    edgeCellPtr.assign(1, 0);
+    edgeCells.clear();
+    edgeCellLength.clear();
+
+    //** edge updates of the current node: neighbour, cell id, signed length
+    typedef std::pair< Index, std::pair< Index, double > > EdgeUpdate;
+    std::vector < EdgeUpdate > updates;
+    Index nUnassigned = 0;
+
+    for (Index a = 0; a < nNodes; a ++) {
+        updates.clear();
+
+        //** collect the edge updates of all cells touching a in cell order
+        for (Index k = nodeCellPtr[a]; k < nodeCellPtr[a + 1]; k ++) {
+            const Cell & cell = mesh.cell(nodeCells[k]);
+            Index nc = cell.nodeCount();
+            bool isTet = (cell.rtti() == MESH_TETRAHEDRON_RTTI ||
+                          cell.rtti() == MESH_TETRAHEDRON10_RTTI);
+
+            for (Index j = 0; j < nc + (isTet ? 2 : 0); j ++) {
+                const Node * na = 0;
+                const Node * nb = 0;
+                double sign = 1.0;
+                if (j < nc){
+                    na = &cell.node(j);
+                    nb = &cell.node((j + 1) % nc);
+                } else {
+                    //** the tetrahedron diagonals overwrite former values
+                    na = &cell.node(j - nc);
+                    nb = &cell.node(j - nc + 2);
+                    sign = -1.0;
+                }
 
-            oldTime = meshGraph[na->id()][nb->id()];
-            newTime = dist * slownessPerCell[mesh_->cell(i).id()];
+                Index b = 0;
+                if (Index(na->id()) == a) b = nb->id();
+                else if (Index(nb->id()) == a) b = na->id();
+                else continue;
+                if (b == a) continue;
 
-            if (oldTime != 0) {
-                newTime = std::min(newTime, oldTime);
+                updates.push_back(EdgeUpdate(b, std::make_pair(Index(cell.id()),
+                                       sign * na->pos().distance(nb->pos()))));
             }
-
-            meshGraph[na->id()][nb->id()] = newTime;
-            meshGraph[nb->id()][na->id()] = newTime;
         }
 
-        if (mesh_->cell(i).rtti() == MESH_TETRAHEDRON_RTTI ||
-            mesh_->cell(i).rtti() == MESH_TETRAHEDRON10_RTTI) {
-
-            Node *na = &mesh_->cell(i).node(0);
-            Node *nb = &mesh_->cell(i).node(2);
+        //** sort the row by neighbour id but keep the cell order per edge
+        std::stable_sort(updates.begin(), updates.end(),
+                         [](const EdgeUpdate & l, const EdgeUpdate & r){
+                             return l.first < r.first; });
 
-            dist = na->pos().distance(nb->pos());
-            oldTime = meshGraph[na->id()][nb->id()];
-            newTime = dist * slownessPerCell[mesh_->cell(i).id()];
-
-            meshGraph[na->id()][nb->id()] = newTime;
-            meshGraph[nb->id()][na->id()] = newTime;
-
-            na = &mesh_->cell(i).node(1);
-            nb = &mesh_->cell(i).node(3);
-
-            dist = na->pos().distance(nb->pos());
-            oldTime = meshGraph[na->id()][nb->id()];
-            newTime = dist * slownessPerCell[mesh_->cell(i).id()];
-            meshGraph[na->id()][nb->id()] = newTime;
-            meshGraph[nb->id()][na->id()] = newTime;
+        for (Index k = 0; k < updates.size(); k ++) {
+            if (k == 0 || updates[k].first != updates[k - 1].first){
+                if (k > 0) edgeCellPtr.push_back(edgeCells.size());
+                adjNodes.push_back(updates[k].first);
+            }
+            edgeCells.push_back(updates[k].second.first);
+            edgeCellLength.push_back(updates[k].second.second);
         }
+        if (!updates.empty()) edgeCellPtr.push_back(edgeCells.size());
 
-        if (mesh_->cell(i).rtti() > MESH_TETRAHEDRON10_RTTI){
-            THROW_TO_IMPL
-        }
+        adjPtr[a + 1] = adjNodes.size();
+        if (updates.empty()) nUnassigned ++;
     }
 
-    if (meshGraph.size() < mesh_->nodeCount()){
+    if (nUnassigned > 0){
         std::cerr << WHERE_AM_I <<
                 " there seems to be unassigned nodes within the mesh. Dijkstra Path will be maybe invalid."
-                 << meshGraph.size() << " < " << mesh_->nodeCount() << std::endl;
-        for (Index i = 0; i < mesh_->nodeCount(); i ++){
-            if (mesh_->node(i).cellSet().empty()){
-                std::cout << mesh_->node(i) << std::endl;
+                 << nNodes - nUnassigned << " < " << nNodes << std::endl;
+        for (Index i = 0; i < nNodes; i ++){
+            if (mesh.node(i).cellSet().empty()){
+                std::cout << mesh.node(i) << std::endl;
             }
         }
     }
-    return meshGraph;
+}
+
+/*! Edge weights for the cell slowness, see \ref createMeshGraphTopology. */
+static void fillMeshGraphWeights(const RVector & slownessPerCell,
+                                 const std::vector < Index > & edgeCellPtr,
+                                 const std::vector < Index > & edgeCells,
+                                 const std::vector < double > & edgeCellLength,
+                                 std::vector < double > & adjDist){
+    Index nEdges = edgeCellPtr.size() - 1;
+    adjDist.resize(nEdges);
+
+    const Index * ptr = &edgeCellPtr[0];
+    const Index * cells = edgeCells.empty() ? 0 : &edgeCells[0];
+    const double * length = edgeCellLength.empty() ? 0 : &edgeCellLength[0];
+    const double * slowness = slownessPerCell.size() ? &slownessPerCell[0] : 0;
+
+    for (Index k = 0; k < nEdges; k ++) {
+        double time = 0.0;
+        for (Index c = ptr[k]; c < ptr[k + 1]; c ++) {
+            double newTime = std::fabs(length[c]) * slowness[cells[c]];
+            if (length[c] > 0.0 && time != 0.0) newTime = std::min(newTime, time);
+            time = newTime;
+        }
+        adjDist[k] = time;
+    }
+}
+
+void TravelTimeDijkstraModelling::createGraph(const RVector & slownessPerCell,
+                                              std::vector < Index > & adjPtr,
+                                              std::vector < Index > & adjNodes,
+                                              std::vector < double > & adjDist) const {
+    std::vector < Index > edgeCellPtr, edgeCells;
+    std::vector < double > edgeCellLength;
+
+    createMeshGraphTopology(*mesh_, adjPtr, adjNodes,
+                            edgeCellPtr, edgeCells, edgeCellLength);
+    fillMeshGraphWeights(slownessPerCell, edgeCellPtr, edgeCells, edgeCellLength,
+                         adjDist);
+}
+
+void TravelTimeDijkstraModelling::deleteMeshDependency_(){
+    edgeCellPtr_.clear();
+    edgeCells_.clear();
+    edgeCellLength_.clear();
+    graphWeights_.clear();
+}
+
+void TravelTimeDijkstraModelling::createGraphTopology_(){
+    std::vector < Index > adjPtr, adjNodes;
+    createMeshGraphTopology(*mesh_, adjPtr, adjNodes,
+                            edgeCellPtr_, edgeCells_, edgeCellLength_);
+
+    graphWeights_.assign(adjNodes.size(), 0.0);
+    dijkstra_.swapGraph(adjPtr, adjNodes, graphWeights_);
+}
+
+void TravelTimeDijkstraModelling::updateGraph_(){
+    //** the topology only changes with the mesh, the weights with the model
+    if (edgeCellPtr_.empty() || dijkstra_.nodeCount() != mesh_->nodeCount()){
+        createGraphTopology_();
+    }
+    fillMeshGraphWeights(mesh_->cellAttributes(), edgeCellPtr_, edgeCells_,
+                         edgeCellLength_, graphWeights_);
+    dijkstra_.swapWeights(graphWeights_);
+}
+
+void TravelTimeDijkstraModelling::calculateShots_(RMatrix * dMap,
+                        std::vector < std::vector < std::vector < Index > > > * ways){
+    Index nShots = shotNodeId_.size();
+    Index nThreads = std::max(Index(1), std::min(threadCount(), nShots));
+
+    distributeCalc(DijkstraShotsMT(dijkstra_, shotNodeId_, receNodeId_,
+                                   dMap, ways, false),
+                   nShots, nThreads);
 }
 
 double TravelTimeDijkstraModelling::findMedianSlowness() const {
@@ -294,6 +542,9 @@ void TravelTimeDijkstraModelling::updateMeshDependency_(){
         receNodeId_[i] = mesh_->findNearestNode(dataContainer_->sensorPosition(Index(receiver[i])));
         receiInv_[Index(receiver[i])] = i;
     }
+
+    if (verbose_) std::cout << "... creating graph topology." << std::endl;
+    createGraphTopology_();
 }
 
 RVector TravelTimeDijkstraModelling::response(const RVector & slowness) {
@@ -304,17 +555,12 @@ RVector TravelTimeDijkstraModelling::response(const RVector & slowness) {
 
     this->mapModel(slowness, background_);
 
-    dijkstra_.setGraph(createGraph(mesh_->cellAttributes()));
+    updateGraph_();
     Index nShots = shotNodeId_.size();
     Index nRecei = receNodeId_.size();
     RMatrix dMap(nShots, nRecei);
 
-    for (Index shot = 0; shot < nShots; shot ++) {
-        dijkstra_.setStartNode(shotNodeId_[shot]);
-        for (Index i = 0; i < nRecei; i ++) {
-            dMap[shot][i] = dijkstra_.distance(receNodeId_[i]);
-        }
-    }
+    calculateShots_(&dMap, 0);
 
     Index nData = dataContainer_->size();
     Index s = 0, g = 0;
@@ -354,10 +600,9 @@ void TravelTimeDijkstraModelling::createJacobian(RSparseMapMatrix & jacobian,
     }
 
     this->mapModel(slowness, background_);
-    dijkstra_.setGraph(createGraph(mesh_->cellAttributes()));
+    updateGraph_();
 
     Index nShots = shotNodeId_.size();
-    Index nRecei = receNodeId_.size();
     Index nData = dataContainer_->size();
     Index nModel = slowness.size();
 
@@ -368,13 +613,7 @@ void TravelTimeDijkstraModelling::createJacobian(RSparseMapMatrix & jacobian,
     //** for each shot: vector<  way(shot->geoph) >;
     std::vector < std::vector < std::vector < Index > > > wayMatrix(nShots);
 
-    for (Index shot = 0; shot < nShots; shot ++) {
-        dijkstra_.setStartNode(shotNodeId_[shot]);
-
-        for (Index i = 0; i < nRecei; i ++) {
-            wayMatrix[shot].push_back(dijkstra_.shortestPathTo(receNodeId_[i]));
-        }
-    }
+    calculateShots_(0, &wayMatrix);
 
     for (Index dataIdx = 0; dataIdx < nData; dataIdx ++) {
         Index s = shotsInv_[Index((*dataContainer_)("s")[dataIdx])];
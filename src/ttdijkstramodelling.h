@@ -31,10 +31,14 @@ typedef std::map< int, double > NodeDistMap;
 //** sorted matrix
 typedef std::map< int, NodeDistMap > Graph;
 
-/*! Dijkstra's shortest path finding*/
+/*! Dijkstra's shortest path finding.
+ * The graph is stored in compressed row storage and the shortest path tree
+ * is found with a binary heap. \ref shortestPaths works on caller owned
+ * buffers and can be called from several threads for different start
+ * nodes at once. */
 class DLLEXPORT Dijkstra {
 public:
-    Dijkstra(){}
+    Dijkstra() : root_(0){}
 
     Dijkstra(const Graph & graph);
 
@@ -42,45 +46,53 @@ public:
 
     void setGraph(const Graph & graph);
 
-    void setStartNode(Index startNode);
+    /*! Set the graph in compressed row storage. The neighbours of node i are
+     * adjNodes[adjPtr[i]] .. adjNodes[adjPtr[i + 1] - 1] with the edge
+     * weights adjDist. The vectors are swapped into this Dijkstra and are
+     * empty afterwards. */
+    void swapGraph(std::vector < Index > & adjPtr,
+                   std::vector < Index > & adjNodes,
+                   std::vector < double > & adjDist);
 
-    std::vector < Index > shortestPathTo(Index node) const;
+    /*! Replace the edge weights of the current graph topology. adjDist
+     * need the size of adjNodes from \ref swapGraph and gets the former
+     * weights. */
+    void swapWeights(std::vector < double > & adjDist);
 
-    inline double distance(int node) { return distances_[node]; }
+    /*! Return the number of graph nodes. */
+    inline Index nodeCount() const {
+        return adjPtr_.empty() ? 0 : adjPtr_.size() - 1;
+    }
 
-    RVector distances() const;
+    void setStartNode(Index startNode);
 
+    /*! Find the shortest paths from startNode to all nodes. dist and pred
+     * are resized to \ref nodeCount(), pred holds the predecessor of every
+     * node, -1 for unreachable nodes and startNode for startNode itself.
+     * Unreachable nodes get the distance 0.0. */
+    void shortestPaths(Index startNode, std::vector < double > & dist,
+                       std::vector < SIndex > & pred) const;
 
-    class edge_ : std::pair< int, int > {
-    public:
-        edge_() : start(0), end(0) {}
-        edge_(int a, int b) : start(a), end(b) {}
-        int start;
-        int end;
-    };
+    std::vector < Index > shortestPathTo(Index node) const;
 
-    /*! Definition for the priority queue */
-    class distancePair_ : std::pair< float, edge_ > { // weigth, vertex;
-    public:
-        distancePair_() : first(0.0) {}
-        distancePair_(double f, edge_ & s) : first(f), second(s) {}
+    /*! Return the shortest path to node for a predecessor list from
+     * \ref shortestPaths. */
+    std::vector < Index > shortestPathTo(Index node,
+                                         const std::vector < SIndex > & pred) const;
 
-        double first;
-        edge_ second;
-    };
+    inline double distance(int node) { return distances_[node]; }
 
-    template < class T > class comparePairsClass_ : public std::binary_function< T, T, T > {
-    public:
-        bool operator() (const T & lhs, const T & rhs) {
-            return lhs.first > rhs.first;
-        }
-    };
+    /*! Return the distances of all nodes for the current start node. */
+    RVector distances() const;
 
 protected:
-    std::vector < edge_ > pathMatrix_;
-    NodeDistMap distances_;
-    Graph graph_;
-    int root_;
+    std::vector < Index > adjPtr_;
+    std::vector < Index > adjNodes_;
+    std::vector < double > adjDist_;
+
+    std::vector < SIndex > pathMatrix_;
+    std::vector < double > distances_;
+    Index root_;
 };
 
 //! Modelling class for travel time problems using the Dijkstra algorithm
@@ -110,6 +122,13 @@ public:
 
     Graph createGraph(const RVector & slownessPerCell) const;
 
+    /*! Create the mesh graph for the given cell slowness in compressed row
+     * storage, see \ref Dijkstra::swapGraph. */
+    void createGraph(const RVector & slownessPerCell,
+                     std::vector < Index > & adjPtr,
+                     std::vector < Index > & adjNodes,
+                     std::vector < double > & adjDist) const;
+
 //     RVector calculate();
 
     double findMedianSlowness() const;
@@ -123,6 +142,20 @@ protected:
     /*! Automatically looking for shot and receiver points if the mesh is changed. */
     virtual void updateMeshDependency_();
 
+    virtual void deleteMeshDependency_();
+
+    /*! Build the Dijkstra graph topology and the cells per graph edge. */
+    void createGraphTopology_();
+
+    /*! Update the Dijkstra edge weights for the cell slowness of the mesh. */
+    void updateGraph_();
+
+    /*! Run Dijkstra for all shots distributed over \ref threadCount()
+     * threads. Fill the shot x receiver traveltimes into dMap and/or the
+     * shot to receiver paths into ways if they are not NULL. */
+    void calculateShots_(RMatrix * dMap,
+                         std::vector < std::vector < std::vector < Index > > > * ways);
+
     Dijkstra dijkstra_;
     double background_;
 
@@ -138,6 +171,14 @@ protected:
     /*! Map receiver id to sequential receiver node number of receNodeId_ */
     std::map< Index, Index > receiInv_;
 
+    /*! Cells and their edge length for each graph edge, see createGraphTopology_. */
+    std::vector < Index > edgeCellPtr_;
+    std::vector < Index > edgeCells_;
+    std::vector < double > edgeCellLength_;
+
+    /*! Edge weight buffer, swapped with the weights of dijkstra_. */
+    std::vector < double > graphWeights_;
+
 };
 
 /*! New Class derived from standard travel time modelling */
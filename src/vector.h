@@ -679,8 +679,12 @@ DEFINE_UNARY_MOD_OPERATOR__(*, MULT)
         if (newCapacity != capacity_) {
             ValueType * buffer = new ValueType[newCapacity];
 
-            std::memcpy(buffer, data_, sizeof(ValueType) * min(capacity_, newCapacity));
-            if (data_)  delete [] data_;
+            //** a bound vector (see bind_) has no capacity but size_ values
+            Index nCopy = min(capacity_, newCapacity);
+            if (capacity_ == 0) nCopy = min(size_, newCapacity);
+
+            std::memcpy(buffer, data_, sizeof(ValueType) * nCopy);
+            if (data_ && capacity_ > 0) delete [] data_;
             data_  = buffer;
             capacity_ = newCapacity;
             //std::copy(&tmp[0], &tmp[min(tmp.size(), n)], data_);
@@ -872,11 +876,22 @@ protected:
 
     void free_(){
         size_ = 0;
+        if (data_ && capacity_ > 0) delete [] data_;
         capacity_ = 0;
-        if (data_)  delete [] data_;
         data_  = NULL;
     }
 
+    template < class T > friend class Matrix;
+
+    /*! Use the external memory [data, data + n) without owning it, i.e.,
+     * capacity_ stays 0. Used for the rows of the contiguous \ref Matrix.
+     * A later resize to another size copies into own memory. */
+    void bind_(ValueType * data, Index n){
+        free_();
+        data_ = data;
+        size_ = n;
+    }
+
     void copy_(const Vector< ValueType > & v){
         if (v.size()) {
             resize(v.size());
@@ -0,0 +1,205 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <gimli.h>
+#include <elementmatrix.h>
+#include <mesh.h>
+#include <meshgenerators.h>
+#include <bert/bertDataContainer.h>
+#include <bert/bertJacobian.h>
+#include <bert/dcfemmodelling.h>
+
+class DCFEMTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(DCFEMTest);
+    CPPUNIT_TEST(testDCSRThreads);
+    CPPUNIT_TEST(testSensitivity);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp(){
+        GIMLI::RVector x(33), y(17);
+        for (GIMLI::Index i = 0; i < x.size(); i ++) x[i] = -16.0 + i;
+        for (GIMLI::Index i = 0; i < y.size(); i ++) y[i] = -16.0 + i;
+        mesh_ = GIMLI::createMesh2D(x, y);
+
+        //** dipole-dipole on 8 electrodes
+        for (GIMLI::Index i = 0; i < 8; i ++) data_.createSensor(GIMLI::RVector3(-7.0 + 2.0 * i, 0.0));
+        for (GIMLI::Index a = 0; a < 5; a ++){
+            for (GIMLI::Index n = 1; n < 3 && a + n + 2 < 8; n ++){
+                GIMLI::Index k = data_.size();
+                data_.resize(k + 1);
+                data_.createFourPointData(k, a, a + 1, a + n + 1, a + n + 2);
+            }
+        }
+        data_.set("k", GIMLI::RVector(data_.size(), 1.0));
+
+        rho_ = GIMLI::RVector(mesh_.cellCount());
+        for (GIMLI::Index i = 0; i < rho_.size(); i ++){
+            rho_[i] = mesh_.cell(i).center()[1] > -5.0 ? 50.0 : 200.0;
+        }
+    }
+
+    void testDCSRThreads(){
+        GIMLI::Index nThreads = GIMLI::threadCount();
+
+        //** the secondary field is assembled on a copy of the mesh, the
+        //** wavenumbers are solved concurrently with more than one thread
+        GIMLI::DCSRMultiElectrodeModelling fop(mesh_, data_, false);
+        GIMLI::setThreadCount(1);
+        GIMLI::RVector response1(fop.response(rho_));
+        GIMLI::setThreadCount(4);
+        GIMLI::RVector response4(fop.response(rho_));
+        GIMLI::RVector response4Again(fop.response(rho_));
+        GIMLI::setThreadCount(nThreads);
+
+        CPPUNIT_ASSERT(response1.size() == data_.size());
+        CPPUNIT_ASSERT(GIMLI::min(response1) > 0.0);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(response4 - response1)) < 1e-10 * GIMLI::max(response1));
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(response4Again - response1)) < 1e-10 * GIMLI::max(response1));
+    }
+
+    /*! Sensitivity by the former per datum loop, for every cell and
+     * wavenumber (S_x + k^2 S_u)(a - b)(m - n). */
+    template < class ValueType >
+    void referenceSensitivity(GIMLI::Matrix < ValueType > & S, const GIMLI::Mesh & mesh,
+                              const GIMLI::DataContainerERT & data,
+                              const GIMLI::Matrix < ValueType > & pots,
+                              const GIMLI::RVector & weights, const GIMLI::RVector & k){
+        GIMLI::Index nElecs = data.sensorCount();
+        S.resize(data.size(), GIMLI::max(mesh.cellMarkers()) + 1);
+        S *= ValueType(0);
+        GIMLI::Vector < ValueType > dummy(mesh.nodeCount(), ValueType(0));
+        GIMLI::ElementMatrix < double > S_i, S1_i;
+
+        for (GIMLI::Index c = 0; c < mesh.cellCount(); c ++){
+            const GIMLI::Cell & cell = mesh.cell(c);
+            if (cell.marker() < 0) continue;
+            S1_i.ux2uy2uz2(cell);
+            for (GIMLI::Index kIdx = 0; kIdx < weights.size(); kIdx ++){
+                S_i.u2(cell);
+                S_i *= k[kIdx] * k[kIdx];
+                S_i += S1_i;
+                for (GIMLI::Index i = 0; i < data.size(); i ++){
+                    int e[4] = {int(data("a")[i]), int(data("b")[i]),
+                                int(data("m")[i]), int(data("n")[i])};
+                    const GIMLI::Vector < ValueType > * v[4];
+                    for (int j = 0; j < 4; j ++){
+                        v[j] = e[j] > -1 ? &pots[e[j] + nElecs * kIdx] : &dummy;
+                    }
+                    S[i][cell.marker()] += S_i.mult(*v[0], *v[1], *v[2], *v[3]) * weights[kIdx];
+                }
+            }
+        }
+    }
+
+    template < class ValueType >
+    void compareSensitivity(GIMLI::Mesh & mesh, const GIMLI::DataContainerERT & data){
+        //** some cells share a model parameter, some are no parameter
+        for (GIMLI::Index i = 0; i < mesh.cellCount(); i ++){
+            mesh.cell(i).setMarker(i % 7 == 5 ? -1 : int(i / 3));
+        }
+
+        GIMLI::RVector k(3), weights(3);
+        k[0] = 0.1; k[1] = 0.5; k[2] = 2.0;
+        weights[0] = 0.3; weights[1] = 0.5; weights[2] = 0.2;
+
+        GIMLI::Matrix < ValueType > pots(data.sensorCount() * k.size(), mesh.nodeCount());
+        for (GIMLI::Index i = 0; i < pots.rows(); i ++){
+            for (GIMLI::Index j = 0; j < pots.cols(); j ++){
+                pots[i][j] = potential_(std::sin(0.3 * i + 0.7 * j + 0.1 * i * j),
+                                        std::cos(0.2 * i - 0.4 * j), ValueType(0));
+            }
+        }
+
+        GIMLI::Matrix < ValueType > S, R;
+        std::vector < std::pair < GIMLI::Index, GIMLI::Index > > clusterIds;
+        GIMLI::createSensitivityCol(S, mesh, data, pots, weights, k, clusterIds, 3, false);
+        referenceSensitivity(R, mesh, data, pots, weights, k);
+
+        CPPUNIT_ASSERT(S.rows() == R.rows() && S.cols() == R.cols());
+        double maxR = 0.0;
+        for (GIMLI::Index i = 0; i < R.rows(); i ++) maxR = std::max(maxR, GIMLI::max(GIMLI::abs(R[i])));
+        CPPUNIT_ASSERT(maxR > 0.0);
+        for (GIMLI::Index i = 0; i < R.rows(); i ++){
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(S[i] - R[i])) < 1e-12 * maxR);
+        }
+    }
+
+    /*! Electrode kernel (many data on few electrodes) and direct products
+     * (few data on many electrodes), with pole electrodes. */
+    void compareSensitivity(GIMLI::Mesh & mesh){
+        GIMLI::DataContainerERT kernel;
+        for (GIMLI::Index i = 0; i < 4; i ++) kernel.createSensor(GIMLI::RVector3(double(i), 0.0));
+        for (GIMLI::Index i = 0; i < 18; i ++){
+            kernel.resize(i + 1);
+            kernel.createFourPointData(i, i % 4, i % 5 == 0 ? -1 : (i + 1) % 4,
+                                       (i + 2) % 4, i % 3 == 0 ? -1 : (i + 3) % 4);
+        }
+        GIMLI::DataContainerERT direct;
+        for (GIMLI::Index i = 0; i < 8; i ++) direct.createSensor(GIMLI::RVector3(double(i), 0.0));
+        for (GIMLI::Index i = 0; i < 6; i ++){
+            direct.resize(i + 1);
+            direct.createFourPointData(i, i, i == 2 ? -1 : i + 1, i + 2, i == 4 ? -1 : (i + 3) % 8);
+        }
+
+        compareSensitivity< double >(mesh, kernel);
+        compareSensitivity< double >(mesh, direct);
+        compareSensitivity< GIMLI::Complex >(mesh, kernel);
+        compareSensitivity< GIMLI::Complex >(mesh, direct);
+    }
+
+    void testSensitivity(){
+        //** linear simplices use the gradients of the mesh view
+        GIMLI::Mesh quads(GIMLI::createMesh2D(4u, 3u));
+        GIMLI::Mesh tri(2);
+        for (GIMLI::Index i = 0; i < quads.nodeCount(); i ++){
+            const GIMLI::RVector3 & p = quads.node(i).pos();
+            tri.createNode(GIMLI::RVector3(p[0] + 0.3 * p[1] * p[1], p[1] * (1.0 + 0.2 * p[0])));
+        }
+        for (GIMLI::Index i = 0; i < quads.cellCount(); i ++){
+            const GIMLI::Cell & c = quads.cell(i);
+            tri.createTriangle(tri.node(c.node(0).id()), tri.node(c.node(1).id()),
+                               tri.node(c.node(2).id()));
+            tri.createTriangle(tri.node(c.node(0).id()), tri.node(c.node(2).id()),
+                               tri.node(c.node(3).id()));
+        }
+        CPPUNIT_ASSERT(tri.view().hasGradients(0));
+        compareSensitivity(tri);
+
+        GIMLI::Mesh hex(GIMLI::createMesh3D(2u, 2u, 1u));
+        GIMLI::Mesh tet(3);
+        for (GIMLI::Index i = 0; i < hex.nodeCount(); i ++){
+            const GIMLI::RVector3 & p = hex.node(i).pos();
+            tet.createNode(GIMLI::RVector3(p[0] + 0.2 * p[2], p[1] * (1.0 + 0.1 * p[0]), p[2]));
+        }
+        //** six tetrahedra around the diagonal 0-6 of every hexahedron
+        static const int kuhn[6][2] = {{1, 2}, {2, 3}, {3, 7}, {7, 4}, {4, 5}, {5, 1}};
+        for (GIMLI::Index i = 0; i < hex.cellCount(); i ++){
+            const GIMLI::Cell & c = hex.cell(i);
+            for (GIMLI::Index j = 0; j < 6; j ++){
+                tet.createTetrahedron(tet.node(c.node(0).id()), tet.node(c.node(kuhn[j][0]).id()),
+                                      tet.node(c.node(kuhn[j][1]).id()), tet.node(c.node(6).id()));
+            }
+        }
+        CPPUNIT_ASSERT(GIMLI::min(tet.cellSizes()) > 1e-3);
+        CPPUNIT_ASSERT(tet.view().hasGradients(0));
+        compareSensitivity(tet);
+
+        //** other cells take the element matrices
+        CPPUNIT_ASSERT(!quads.view().hasGradients(0));
+        compareSensitivity(quads);
+        CPPUNIT_ASSERT(!hex.view().hasGradients(0));
+        compareSensitivity(hex);
+    }
+
+private:
+    static double potential_(double re, double, double){ return re; }
+    static GIMLI::Complex potential_(double re, double im, GIMLI::Complex){
+        return GIMLI::Complex(re, im);
+    }
+
+    GIMLI::Mesh mesh_;
+    GIMLI::DataContainerERT data_;
+    GIMLI::RVector rho_;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DCFEMTest);
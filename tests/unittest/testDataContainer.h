@@ -7,6 +7,7 @@
 #include <datacontainer.h>
 #include <pos.h>
 
+#include <fstream>
 #include <stdexcept>
 
 using namespace GIMLI;
@@ -93,7 +94,59 @@ public:
     }   
     
     void testIO(){
-        
+        std::ofstream file("testIO.dat");
+        file << "3 # sensors\n# x z\n0 0\n1.5 -0.25\r\n\n2 0.125 7\n"
+             << "4\n#a b u i\n"
+             << "1 2 0.1 1e3\n  # comment\n\n"
+             << "2\t3 -2.5e-3 0x10 99 # more than the format\n"
+             << "3 1 123456789012345678901 \n"
+             << "1 3\n"
+             << "1\n# x y z\n5 6 7";
+        file.close();
+
+        DataContainer data;
+        data.registerSensorIndex("a");
+        data.registerSensorIndex("b");
+        data.load("testIO.dat", true, false);
+        CPPUNIT_ASSERT(data.sensorCount() == 3);
+        CPPUNIT_ASSERT(data.sensorPositions()[1] == RVector3(1.5, 0.0, -0.25));
+        CPPUNIT_ASSERT(data.size() == 4);
+        CPPUNIT_ASSERT(data("a") == RVector(std::vector< double >{0., 1., 2., 0.}));
+        CPPUNIT_ASSERT(data("u")[0] == 0.1);
+        CPPUNIT_ASSERT(data("u")[1] == -2.5e-3);
+        CPPUNIT_ASSERT(data("u")[2] == std::strtod("123456789012345678901", NULL));
+        CPPUNIT_ASSERT(data("u")[3] == 0.0);
+        CPPUNIT_ASSERT(data("i")[1] == 16.0);
+        CPPUNIT_ASSERT(data.additionalPoints().size() == 1);
+        CPPUNIT_ASSERT(data.additionalPoints()[0] == RVector3(5.0, 6.0, 7.0));
+
+        //** too few data
+        file.open("testIO.dat");
+        file << "1\n0 0\n3\n#a u\n1 2\n1 3\n";
+        file.close();
+        DataContainer data2;
+        CPPUNIT_ASSERT_THROW(data2.load("testIO.dat"), std::exception);
+
+        //** binary round trip keeps everything, invalid data too
+        data.markInvalid(IndexArray(1, 2));
+        data.setDataDescription("u", "potential");
+        data.set("u", data("u") / 3.0);
+        data.saveBinary("testIO.bdc");
+        DataContainer data3;
+        data3.loadBinary("testIO.bdc");
+        CPPUNIT_ASSERT(data3.size() == data.size());
+        CPPUNIT_ASSERT(data3.sensorPositions() == data.sensorPositions());
+        CPPUNIT_ASSERT(data3.additionalPoints() == data.additionalPoints());
+        CPPUNIT_ASSERT(data3.tokenList() == data.tokenList());
+        CPPUNIT_ASSERT(data3.isSensorIndex("b"));
+        CPPUNIT_ASSERT(data3("u") == data("u"));
+        CPPUNIT_ASSERT(data3("valid") == data("valid"));
+        CPPUNIT_ASSERT(data3.dataDescription("u") == "potential");
+        CPPUNIT_ASSERT(data3.inputFormatString() == data.inputFormatString());
+
+        //** load detects the binary format
+        DataContainer data4("testIO.bdc", true, false);
+        CPPUNIT_ASSERT(data4("a") == data("a"));
     }
     
     void testEdit(){
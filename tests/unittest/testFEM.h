@@ -7,6 +7,13 @@
 #include <meshentities.h>
 #include <elementmatrix.h>
 #include <integration.h>
+#include <meshgenerators.h>
+#include <sparsematrix.h>
+#include <pcgWrapper.h>
+#include <linSolver.h>
+#include <stopwatch.h>
+
+#include <set>
 
 class FEMTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST_SUITE(FEMTest);
@@ -17,6 +24,14 @@ class FEMTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST(testFEM2D);
     CPPUNIT_TEST(testFEM3D);
 
+    CPPUNIT_TEST(testSparsityPattern);
+    CPPUNIT_TEST(testAssembly);
+    CPPUNIT_TEST(testPCG);
+#if CHOLMOD_FOUND
+    CPPUNIT_TEST(testLinSolverRefactorise);
+    CPPUNIT_TEST(testLinSolverBlocked);
+#endif
+
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -68,6 +83,264 @@ public:
         testStiffness3D();
     }
 
+    /*! Compare the sparsity pattern against the former std::set based
+     * construction and report the timings of both. */
+    void testSparsityPattern(){
+        GIMLI::Mesh mesh2(GIMLI::createMesh2D(300u, 300u));
+        GIMLI::Mesh mesh3(GIMLI::createMesh3D(40u, 40u, 40u));
+
+        compareSparsityPattern(mesh2);
+        compareSparsityPattern(mesh3);
+    }
+
+    /*! Compare the colored slot map assembly with adding the element
+     * matrices one by one. */
+    void testAssembly(){
+        //** large enough that every color is assembled by 4 threads
+        GIMLI::Mesh mesh(GIMLI::createMesh3D(32u, 32u, 32u));
+        GIMLI::RVector a(mesh.cellCount());
+        for (GIMLI::Index i = 0; i < a.size(); i ++) a[i] = 1.0 + (i % 7);
+
+        GIMLI::RSparseMatrix S;
+        S.buildSparsityPattern(mesh);
+        GIMLI::ElementMatrix < double > Su, Sx;
+        for (GIMLI::Index i = 0; i < mesh.cellCount(); i ++){
+            Su.u2(mesh.cell(i));
+            Su *= 0.25;
+            Su += Sx.ux2uy2uz2(mesh.cell(i));
+            S.add(Su, a[mesh.cell(i).id()]);
+        }
+
+        GIMLI::ElementSlotMap map;
+        map.init(mesh, S.vecColPtr(), S.vecRowIdx(), S.stype());
+        for (GIMLI::Index i = 0; i < map.colorCount(); i ++){
+            CPPUNIT_ASSERT(map.colorPtr()[i + 1] - map.colorPtr()[i] >= 4000);
+        }
+
+        for (GIMLI::Index nThreads = 1; nThreads < 5; nThreads += 3){
+            GIMLI::RSparseMatrix A;
+            A.buildSparsityPattern(S);
+            A.assemble(mesh, map, a, 1.0, 0.25, nThreads);
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(A.vecVals() - S.vecVals())) < TOLERANCE);
+        }
+    }
+
+    /*! Solve a Helmholtz like system with PCG, real and complex symmetric,
+     * for a single and blocked right hand sides. */
+    void testPCG(){
+        GIMLI::Mesh mesh(GIMLI::createMesh3D(12u, 12u, 12u));
+        GIMLI::RVector a(mesh.cellCount());
+        for (GIMLI::Index i = 0; i < a.size(); i ++) a[i] = 1.0 + (i % 7);
+
+        GIMLI::RSparseMatrix S;
+        S.buildSparsityPattern(mesh);
+        S.assemble(mesh, a, 1.0, 0.01);
+
+        GIMLI::PCGWrapper solver(S);
+        GIMLI::RMatrix b(3, S.rows());
+        for (GIMLI::Index i = 0; i < b.rows(); i ++) b[i][i * 100] = 1.0;
+
+        GIMLI::RVector x;
+        CPPUNIT_ASSERT(solver.solve(b[0], x));
+        CPPUNIT_ASSERT(GIMLI::norml2(S * x - b[0]) < 1e-9);
+        GIMLI::Index iter = solver.iterations();
+
+        //** the solution as start vector needs no iterations
+        CPPUNIT_ASSERT(solver.solve(b[0], x));
+        CPPUNIT_ASSERT(solver.iterations() < iter);
+
+        GIMLI::RMatrix X;
+        CPPUNIT_ASSERT(solver.solve(b, X));
+        for (GIMLI::Index i = 0; i < b.rows(); i ++){
+            CPPUNIT_ASSERT(GIMLI::norml2(S * X[i] - b[i]) < 1e-9);
+        }
+
+        //** new values on the same pattern
+        S.vecVals() *= 2.0;
+        CPPUNIT_ASSERT(solver.refactorise(S));
+        CPPUNIT_ASSERT(solver.solve(b[1], x));
+        CPPUNIT_ASSERT(GIMLI::norml2(S * x - b[1]) < 1e-9);
+
+        //** complex symmetric
+        GIMLI::CSparseMatrix C;
+        C.buildSparsityPattern(S);
+        C.vecVals() = GIMLI::toComplex(S.vecVals(), GIMLI::RVector(S.vecVals() * 0.1));
+        GIMLI::PCGWrapper cSolver(C);
+        GIMLI::CVector cb(GIMLI::toComplex(b[2], b[1]));
+        GIMLI::CVector cx;
+        CPPUNIT_ASSERT(cSolver.solve(cb, cx));
+        CPPUNIT_ASSERT(GIMLI::norml2(C * cx - cb) < 1e-9);
+    }
+
+#if CHOLMOD_FOUND
+    /*! Refactorise new values on the same pattern with the symbolic
+     * analysis of the first matrix and compare with a fresh factorisation. */
+    void testLinSolverRefactorise(){
+        GIMLI::Mesh mesh(GIMLI::createMesh3D(8u, 8u, 8u));
+        GIMLI::RVector a(mesh.cellCount());
+        for (GIMLI::Index i = 0; i < a.size(); i ++) a[i] = 1.0 + (i % 7);
+
+        GIMLI::RSparseMatrix S;
+        S.buildSparsityPattern(mesh);
+        S.assemble(mesh, a, 1.0, 0.01);
+        GIMLI::RVector b(S.rows());
+        for (GIMLI::Index i = 0; i < b.size(); i ++) b[i] = std::sin(0.1 * i);
+
+        GIMLI::LinSolver solver;
+        solver.setSolverType(GIMLI::CHOLMOD);
+        solver.setMatrix(S);
+        CPPUNIT_ASSERT(solver.solverType() == GIMLI::CHOLMOD);
+        GIMLI::RVector x;
+        solver.solve(b, x);
+        CPPUNIT_ASSERT(GIMLI::norml2(S * x - b) < 1e-9 * GIMLI::norml2(b));
+
+        //** other values, not only scaled, on the same pattern
+        for (GIMLI::Index i = 0; i < a.size(); i ++) a[i] = 1.0 + (i % 5) * 3.0;
+        GIMLI::RSparseMatrix S2;
+        S2.buildSparsityPattern(S);
+        S2.assemble(mesh, a, 1.0, 0.5);
+        solver.refactorise(S2);
+        solver.solve(b, x);
+
+        GIMLI::LinSolver fresh;
+        fresh.setSolverType(GIMLI::CHOLMOD);
+        fresh.setMatrix(S2);
+        GIMLI::RVector xf;
+        fresh.solve(b, xf);
+        CPPUNIT_ASSERT(GIMLI::norml2(S2 * xf - b) < 1e-9 * GIMLI::norml2(b));
+        CPPUNIT_ASSERT(GIMLI::norml2(x - xf) < 1e-10 * GIMLI::norml2(xf));
+
+        //** complex symmetric values on the same pattern
+        GIMLI::CSparseMatrix C;
+        C.buildSparsityPattern(S);
+        C.vecVals() = GIMLI::toComplex(S.vecVals(), GIMLI::RVector(S.vecVals() * 0.1));
+        GIMLI::CVector cb(GIMLI::toComplex(b, GIMLI::RVector(b * 0.5)));
+        GIMLI::LinSolver cSolver;
+        cSolver.setSolverType(GIMLI::CHOLMOD);
+        cSolver.setMatrix(C);
+        C.vecVals() = GIMLI::toComplex(S2.vecVals(), GIMLI::RVector(S2.vecVals() * 0.3));
+        cSolver.refactorise(C);
+        GIMLI::CVector cx;
+        cSolver.solve(cb, cx);
+
+        GIMLI::LinSolver cFresh;
+        cFresh.setSolverType(GIMLI::CHOLMOD);
+        cFresh.setMatrix(C);
+        GIMLI::CVector cxf;
+        cFresh.solve(cb, cxf);
+        CPPUNIT_ASSERT(GIMLI::norml2(C * cxf - cb) < 1e-9 * GIMLI::norml2(cb));
+        CPPUNIT_ASSERT(GIMLI::norml2(cx - cxf) < 1e-10 * GIMLI::norml2(cxf));
+
+        //** another pattern falls back to a new analysis
+        GIMLI::Mesh mesh2(GIMLI::createMesh3D(6u, 7u, 8u));
+        GIMLI::RSparseMatrix S3;
+        S3.buildSparsityPattern(mesh2);
+        S3.assemble(mesh2, GIMLI::RVector(mesh2.cellCount(), 2.0), 1.0, 0.01);
+        GIMLI::RVector b3(S3.rows(), 1.0);
+        solver.refactorise(S3);
+        solver.solve(b3, x);
+        CPPUNIT_ASSERT(GIMLI::norml2(S3 * x - b3) < 1e-9 * GIMLI::norml2(b3));
+    }
+
+    /*! Solve all right hand sides at once and compare with one solve for
+     * each of them. */
+    void testLinSolverBlocked(){
+        GIMLI::Mesh mesh(GIMLI::createMesh3D(8u, 8u, 8u));
+        GIMLI::RVector a(mesh.cellCount());
+        for (GIMLI::Index i = 0; i < a.size(); i ++) a[i] = 1.0 + (i % 7);
+
+        GIMLI::RSparseMatrix S;
+        S.buildSparsityPattern(mesh);
+        S.assemble(mesh, a, 1.0, 0.01);
+
+        GIMLI::RMatrix b(5, S.rows());
+        for (GIMLI::Index i = 0; i < b.rows(); i ++){
+            b[i][i * 100] = 1.0;
+            for (GIMLI::Index j = 0; j < b.cols(); j ++) b[i][j] += 0.01 * std::cos(0.3 * i * j);
+        }
+
+        GIMLI::LinSolver solver;
+        solver.setSolverType(GIMLI::CHOLMOD);
+        solver.setMatrix(S);
+        GIMLI::RMatrix X;
+        solver.solve(b, X);
+        CPPUNIT_ASSERT(X.rows() == b.rows() && X.cols() == S.rows());
+
+        GIMLI::RVector x;
+        for (GIMLI::Index i = 0; i < b.rows(); i ++){
+            solver.solve(b[i], x);
+            CPPUNIT_ASSERT(GIMLI::norml2(S * x - b[i]) < 1e-9 * GIMLI::norml2(b[i]));
+            CPPUNIT_ASSERT(GIMLI::norml2(X[i] - x) < 1e-10 * GIMLI::norml2(x));
+        }
+
+        //** complex symmetric
+        GIMLI::CSparseMatrix C;
+        C.buildSparsityPattern(S);
+        C.vecVals() = GIMLI::toComplex(S.vecVals(), GIMLI::RVector(S.vecVals() * 0.1));
+        GIMLI::CMatrix cb(b.rows(), C.rows());
+        for (GIMLI::Index i = 0; i < b.rows(); i ++){
+            cb[i] = GIMLI::toComplex(b[i], b[(i + 1) % b.rows()]);
+        }
+
+        GIMLI::LinSolver cSolver;
+        cSolver.setSolverType(GIMLI::CHOLMOD);
+        cSolver.setMatrix(C);
+        GIMLI::CMatrix cX;
+        cSolver.solve(cb, cX);
+        CPPUNIT_ASSERT(cX.rows() == cb.rows() && cX.cols() == C.rows());
+
+        GIMLI::CVector cx;
+        for (GIMLI::Index i = 0; i < cb.rows(); i ++){
+            cSolver.solve(cb[i], cx);
+            CPPUNIT_ASSERT(GIMLI::norml2(C * cx - cb[i]) < 1e-9 * GIMLI::norml2(cb[i]));
+            CPPUNIT_ASSERT(GIMLI::norml2(cX[i] - cx) < 1e-10 * GIMLI::norml2(cx));
+        }
+    }
+#endif
+
+    void compareSparsityPattern(const GIMLI::Mesh & mesh){
+        GIMLI::Stopwatch swatch(true);
+        std::vector < std::set< GIMLI::Index > > idxMap(mesh.nodeCount());
+        for (GIMLI::Index c = 0; c < mesh.cellCount(); c ++){
+            const GIMLI::Cell & cell = mesh.cell(c);
+            for (GIMLI::Index i = 0; i < cell.nodeCount(); i ++){
+                for (GIMLI::Index j = 0; j < cell.nodeCount(); j ++){
+                    idxMap[cell.node(j).id()].insert(cell.node(i).id());
+                }
+            }
+        }
+        std::vector < int > colPtr(1, 0);
+        std::vector < int > rowIdx;
+        for (GIMLI::Index i = 0; i < idxMap.size(); i ++){
+            rowIdx.insert(rowIdx.end(), idxMap[i].begin(), idxMap[i].end());
+            colPtr.push_back(rowIdx.size());
+        }
+        double tSet = swatch.duration(true);
+
+        GIMLI::RSparseMatrix S;
+        S.buildSparsityPattern(mesh, 1);
+        double tSerial = swatch.duration(true);
+
+        GIMLI::RSparseMatrix SMT;
+        SMT.buildSparsityPattern(mesh);
+        double tMT = swatch.duration(true);
+
+        if (GIMLI::getEnvironment("GIMLI_UNITTEST_BENCHMARK", false)){
+            std::cout << std::endl << "sparsity pattern (" << mesh.dim() << "D, "
+                      << mesh.nodeCount() << " nodes): set: " << tSet
+                      << "s serial: " << tSerial << "s threaded: " << tMT << "s"
+                      << std::endl;
+        }
+
+        CPPUNIT_ASSERT(S.vecColPtr() == colPtr);
+        CPPUNIT_ASSERT(S.vecRowIdx() == rowIdx);
+        CPPUNIT_ASSERT(SMT.vecColPtr() == colPtr);
+        CPPUNIT_ASSERT(SMT.vecRowIdx() == rowIdx);
+        CPPUNIT_ASSERT(S.nVals() == rowIdx.size());
+        CPPUNIT_ASSERT(S.rows() == mesh.nodeCount());
+        CPPUNIT_ASSERT(S.cols() == mesh.nodeCount());
+    }
+
     void testStiffness1D(){
         
         std::vector < GIMLI::Node * > n(2);
@@ -8,10 +8,42 @@
 #include <memwatch.h>
 
 #include <matrix.h>
+#include <dc1dmodelling.h>
+#include <em1dmodelling.h>
+#include <solver.h>
+#include <ttdijkstramodelling.h>
+#include <sparsematrix.h>
+#include <calculateMultiThread.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #include <polynomial.h>
 #include <pos.h>
 
+//** counts the calls of every index, the first indices are expensive
+class CountCallsMT : public GIMLI::BaseCalcMT{
+public:
+    CountCallsMT(std::vector < std::atomic < int > > & hits, GIMLI::Index nExpensive)
+        : GIMLI::BaseCalcMT(1), hits_(&hits), nExpensive_(nExpensive){ }
+
+    virtual void calc(GIMLI::Index tNr=0){
+        for (GIMLI::Index i = start_; i < end_; i ++){
+            if (i < nExpensive_){
+                volatile double x = 0.0;
+                for (int j = 0; j < 20000; j ++) x += std::sqrt(double(j));
+            }
+            if (i == 777) GIMLI::throwError(1, "index failed");
+            (*hits_)[i] ++;
+        }
+    }
+
+protected:
+    std::vector < std::atomic < int > > * hits_;
+    GIMLI::Index nExpensive_;
+};
+
 class GIMLIMiscTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST_SUITE(GIMLIMiscTest);
     CPPUNIT_TEST(testGimliMisc);
@@ -21,6 +53,11 @@ class GIMLIMiscTest : public CppUnit::TestFixture  {
     //CPPUNIT_TEST(testIPCSHM);
     CPPUNIT_TEST(testMemWatch);
     CPPUNIT_TEST(testPolynomialFunction);
+    CPPUNIT_TEST(testMultiThreadJacobian);
+    CPPUNIT_TEST(testThreadPool);
+    CPPUNIT_TEST(testDistributeCalc);
+    CPPUNIT_TEST(testScaledMult);
+    CPPUNIT_TEST(testDijkstra);
 //     CPPUNIT_TEST(testRotationByQuaternion);
     
 	//CPPUNIT_TEST_EXCEPTION(funct, exception);
@@ -118,6 +155,219 @@ public:
         GIMLI::MemWatch::pInstance()->info(WHERE);
     }
     
+    void testMultiThreadJacobian(){
+        GIMLI::RVector ab2(GIMLI::increasingRange(1.0, 100.0, 20));
+        GIMLI::RVector mn2(ab2.size(), 0.5);
+        GIMLI::DC1dModelling fop(4, ab2, mn2);
+        GIMLI::RVector model(fop.createDefaultStartModel());
+        model[4] = 10.0; model[5] = 1000.0;
+
+        compareMultiThreadJacobian(fop, model);
+
+        GIMLI::RVector periods(12);
+        for (GIMLI::Index i = 0; i < periods.size(); i ++) periods[i] = 0.01 * std::pow(3.0, double(i));
+        GIMLI::MT1dModelling mt(periods, 3);
+        GIMLI::RVector mtModel(5, 100.0);
+        mtModel[0] = 20.0; mtModel[1] = 50.0; mtModel[3] = 10.0;
+        compareMultiThreadJacobian(mt, mtModel);
+
+        GIMLI::RVector freqs(10);
+        for (GIMLI::Index i = 0; i < freqs.size(); i ++) freqs[i] = 110.0 * std::pow(2.0, double(i));
+        GIMLI::FDEM1dModelling fdem(3, freqs, 50.0, 1.0);
+        compareMultiThreadJacobian(fdem, mtModel);
+
+        GIMLI::RVector zvec(GIMLI::increasingRange(0.5, 60.0, 30));
+        GIMLI::RMatrix KR(15, 30), KI(15, 30);
+        for (GIMLI::Index i = 0; i < KR.rows(); i ++){
+            for (GIMLI::Index j = 0; j < KR.cols(); j ++){
+                KR[i][j] = std::sin(0.3 * (i + 1) * (j + 1));
+                KI[i][j] = std::cos(0.2 * (i + 1) * (j + 2));
+            }
+        }
+        GIMLI::MRS1dBlockModelling mrs(3, KR, KI, zvec);
+        GIMLI::RVector mrsModel(5);
+        mrsModel[0] = 5.0; mrsModel[1] = 10.0;
+        mrsModel[2] = 0.1; mrsModel[3] = 0.3; mrsModel[4] = 0.05;
+        compareMultiThreadJacobian(mrs, mrsModel);
+    }
+
+    void compareMultiThreadJacobian(GIMLI::ModellingBase & fop, const GIMLI::RVector & model){
+        fop.setMultiThreadJacobian(1);
+        fop.createJacobian(model);
+        GIMLI::RMatrix J(*dynamic_cast< GIMLI::RMatrix * >(fop.jacobian()));
+
+        fop.setMultiThreadJacobian(3);
+        fop.createJacobian(model);
+        GIMLI::RMatrix & Jmt = *dynamic_cast< GIMLI::RMatrix * >(fop.jacobian());
+
+        CPPUNIT_ASSERT(Jmt.rows() == J.rows() && Jmt.cols() == J.cols());
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(J[0])) > 0.0);
+        for (GIMLI::Index i = 0; i < J.rows(); i ++){
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(Jmt[i] - J[i])) < TOLERANCE);
+        }
+    }
+
+    void testThreadPool(){
+        GIMLI::Index nThreads = GIMLI::threadCount();
+
+        //** start more workers than used below, as on a larger machine
+        GIMLI::setThreadCount(8);
+        GIMLI::TaskGroup start;
+        GIMLI::threadPool().submit(start, [](){});
+        GIMLI::threadPool().wait(start);
+        GIMLI::setThreadCount(4);
+
+        //** limited group, every task submits and waits for a group of its own
+        std::vector < double > sums(20, 0.0);
+        std::atomic < int > running(0), maxRunning(0);
+        GIMLI::TaskGroup tasks(2);
+        for (GIMLI::Index i = 0; i < sums.size(); i ++){
+            GIMLI::threadPool().submit(tasks, [&, i](){
+                int r = ++running;
+                int m = maxRunning;
+                while (r > m && !maxRunning.compare_exchange_weak(m, r)){}
+
+                std::vector < double > parts(10, 0.0);
+                GIMLI::TaskGroup inner;
+                for (GIMLI::Index j = 0; j < parts.size(); j ++){
+                    GIMLI::threadPool().submit(inner, [&, i, j](){ parts[j] = i * j; });
+                }
+                GIMLI::threadPool().wait(inner);
+                for (GIMLI::Index j = 0; j < parts.size(); j ++) sums[i] += parts[j];
+                --running;
+            });
+        }
+        GIMLI::threadPool().wait(tasks);
+        CPPUNIT_ASSERT(maxRunning <= 2);
+        for (GIMLI::Index i = 0; i < sums.size(); i ++) CPPUNIT_ASSERT(sums[i] == 45.0 * i);
+        CPPUNIT_ASSERT(GIMLI::threadPool().workerCount() == 3);
+
+        //** the first exception is passed to the waiting thread
+        GIMLI::TaskGroup failing;
+        for (GIMLI::Index i = 0; i < 5; i ++){
+            GIMLI::threadPool().submit(failing, [i](){
+                if (i == 3) GIMLI::throwError(1, "task failed");
+            });
+        }
+        CPPUNIT_ASSERT_THROW(GIMLI::threadPool().wait(failing), std::exception);
+
+        //** a smaller thread count idles the surplus workers
+        GIMLI::setThreadCount(2);
+        CPPUNIT_ASSERT(GIMLI::threadPool().workerCount() == 1);
+        running = 0; maxRunning = 0;
+        GIMLI::TaskGroup few;
+        for (GIMLI::Index i = 0; i < 20; i ++){
+            GIMLI::threadPool().submit(few, [&](){
+                int r = ++running;
+                int m = maxRunning;
+                while (r > m && !maxRunning.compare_exchange_weak(m, r)){}
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                --running;
+            });
+        }
+        GIMLI::threadPool().wait(few);
+        CPPUNIT_ASSERT(maxRunning <= 2);
+
+        GIMLI::setThreadCount(nThreads);
+    }
+
+    void testDistributeCalc(){
+        GIMLI::Index nThreads = GIMLI::threadCount();
+        GIMLI::setThreadCount(4);
+
+        //** every index exactly once, for any chunk size and part count
+        GIMLI::Index n = 500;
+        for (GIMLI::Index parts = 1; parts < 9; parts ++){
+            for (GIMLI::Index chunk = 0; chunk < 3; chunk ++){
+                std::vector < std::atomic < int > > hits(n);
+                for (GIMLI::Index i = 0; i < n; i ++) hits[i] = 0;
+                GIMLI::distributeCalc(CountCallsMT(hits, 50), n, parts, false, chunk);
+                for (GIMLI::Index i = 0; i < n; i ++) CPPUNIT_ASSERT(hits[i] == 1);
+            }
+        }
+
+        //** the parts steal from each other
+        GIMLI::WorkRanges ranges(10, 2, 2);
+        GIMLI::Index start, end;
+        CPPUNIT_ASSERT(ranges.next(1, start, end) && start == 5 && end == 7);
+        CPPUNIT_ASSERT(ranges.next(1, start, end) && start == 7 && end == 9);
+        CPPUNIT_ASSERT(ranges.next(1, start, end) && start == 9 && end == 10);
+        CPPUNIT_ASSERT(ranges.next(1, start, end) && start == 2 && end == 4);
+        CPPUNIT_ASSERT(ranges.next(0, start, end) && start == 0 && end == 2);
+        CPPUNIT_ASSERT(ranges.next(0, start, end) && start == 4 && end == 5);
+        CPPUNIT_ASSERT(!ranges.next(0, start, end));
+        CPPUNIT_ASSERT(!ranges.next(1, start, end));
+
+        std::vector < std::atomic < int > > hits(1000);
+        CPPUNIT_ASSERT_THROW(GIMLI::distributeCalc(CountCallsMT(hits, 0), 1000, 4),
+                             std::exception);
+
+        GIMLI::setThreadCount(nThreads);
+    }
+
+    void testScaledMult(){
+        GIMLI::Index nD = 400, nM = 300;
+        GIMLI::RMatrix S(nD, nM);
+        for (GIMLI::Index i = 0; i < nD; i ++){
+            for (GIMLI::Index j = 0; j < nM; j ++) S[i][j] = std::sin(0.3 * i * i + 1.3 * j);
+        }
+        GIMLI::RVector x(nM), cs(nM), y(nD), rs(nD), ret, work;
+        for (GIMLI::Index j = 0; j < nM; j ++){ x[j] = 0.1 * j; cs[j] = 1.0 / (1.0 + j); }
+        for (GIMLI::Index i = 0; i < nD; i ++){ y[i] = std::cos(i); rs[i] = 2.0 + i; }
+
+        // dense matrix, forced to use 2 threads
+        GIMLI::scaledMult(S, x, cs, rs, ret, work, 2);
+        GIMLI::RVector Sx(S.mult(GIMLI::RVector(x * cs)) * rs);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(ret - Sx)) < TOLERANCE * GIMLI::max(GIMLI::abs(Sx)));
+
+        GIMLI::scaledTransMult(S, y, rs, cs, ret, work, 2);
+        GIMLI::RVector STy(S.transMult(GIMLI::RVector(y * rs)) * cs);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(ret - STy)) < TOLERANCE * GIMLI::max(GIMLI::abs(STy)));
+
+        // sparse map matrix, follows changes between the products
+        GIMLI::RSparseMapMatrix C(nM - 1, nM);
+        for (GIMLI::Index i = 0; i < nM - 1; i ++){
+            C.setVal(i, i, -1.0); C.setVal(i, i + 1, 1.0);
+        }
+        GIMLI::RVector cr(nM - 1, 1.5);
+        GIMLI::scaledMult(C, x, cs, cr, ret, work);
+        CPPUNIT_ASSERT(ret == GIMLI::RVector(C.mult(GIMLI::RVector(x * cs)) * cr));
+        C.setVal(3, 4, 7.0);
+        GIMLI::scaledMult(C, x, cs, cr, ret, work);
+        CPPUNIT_ASSERT(std::fabs(ret[3] - (7.0 * x[4] * cs[4] - x[3] * cs[3]) * 1.5) < TOLERANCE);
+        GIMLI::scaledTransMult(C, cr, cr, cs, ret, work);
+        CPPUNIT_ASSERT(std::fabs(ret[4] - (7.0 - 1.0) * 1.5 * 1.5 * cs[4]) < TOLERANCE);
+
+        try{ GIMLI::scaledMult(S, y, cs, rs, ret, work); CPPUNIT_ASSERT(0); } catch(...){}
+    }
+
+    void testDijkstra(){
+        // 0 -1- 1 -1- 2
+        //  \         /
+        //   ----5----
+        GIMLI::Graph graph;
+        graph[0][1] = 1.0; graph[1][0] = 1.0;
+        graph[1][2] = 1.0; graph[2][1] = 1.0;
+        graph[0][2] = 5.0; graph[2][0] = 5.0;
+        graph[3][3] = 0.0; // isolated node
+
+        GIMLI::Dijkstra dijkstra(graph);
+        CPPUNIT_ASSERT(dijkstra.nodeCount() == 4);
+
+        dijkstra.setStartNode(2);
+        CPPUNIT_ASSERT(dijkstra.distance(0) == 2.0);
+        CPPUNIT_ASSERT(dijkstra.distance(3) == 0.0);
+        std::vector < GIMLI::Index > way(dijkstra.shortestPathTo(0));
+        CPPUNIT_ASSERT(way.size() == 3 && way[0] == 2 && way[1] == 1 && way[2] == 0);
+
+        std::vector < double > dist;
+        std::vector < GIMLI::SIndex > pred;
+        dijkstra.shortestPaths(0, dist, pred);
+        CPPUNIT_ASSERT(dist[2] == 2.0 && pred[2] == 1 && pred[3] == -1);
+        CPPUNIT_ASSERT(dijkstra.shortestPathTo(2, pred).size() == 3);
+        try{ dijkstra.shortestPathTo(3, pred); CPPUNIT_ASSERT(0); } catch(...){}
+    }
+
     void testPolynomialFunction(){
         CPPUNIT_ASSERT(GIMLI::PolynomialFunction< double > (GIMLI::RVector(0.0))(GIMLI::RVector3(3.14, 0.0, 0.0)) == 0.0);
         
@@ -0,0 +1,174 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <gimli.h>
+#include <dc1dmodelling.h>
+#include <inversion.h>
+#include <trans.h>
+#include <vectortemplates.h>
+
+//** counts the forward calls of a 1d dc sounding
+class CountingDC1dModelling : public GIMLI::DC1dModelling {
+public:
+    CountingDC1dModelling(size_t nlay, const GIMLI::RVector & ab2, const GIMLI::RVector & mn2)
+        : GIMLI::DC1dModelling(nlay, ab2, mn2), nResponses(0), nJacobians(0){
+    }
+
+    virtual GIMLI::RVector response(const GIMLI::RVector & model){
+        nResponses ++;
+        return GIMLI::DC1dModelling::response(model);
+    }
+
+    using GIMLI::DC1dModelling::createJacobian;
+    virtual void createJacobian(const GIMLI::RVector & model){
+        nJacobians ++;
+        GIMLI::DC1dModelling::createJacobian(model);
+    }
+
+    GIMLI::Index nResponses;
+    GIMLI::Index nJacobians;
+};
+
+//** gives access to the coefficients of the closed-form line search
+class LineSearchInversion : public GIMLI::RInversion {
+public:
+    LineSearchInversion(const GIMLI::RVector & data, GIMLI::ModellingBase & fop,
+                        GIMLI::Trans< GIMLI::RVector > & tD,
+                        GIMLI::Trans< GIMLI::RVector > & tM)
+        : GIMLI::RInversion(data, fop, tD, tM, false, false){
+    }
+
+    /*! Objective function at tau from the coefficients, as in linesearch. */
+    double phiFromCoefficients(const GIMLI::RVector & dModel,
+                               const GIMLI::RVector & dData, double tau) const {
+        double d0 = 0.0, d1 = 0.0, d2 = 0.0, m0 = 0.0, m1 = 0.0, m2 = 0.0;
+        dataTermCoefficients_(dData, d0, d1, d2);
+        modelTermCoefficients_(dModel, m0, m1, m2);
+        return d0 + tau * (d1 + tau * d2) + lambda_ * (m0 + tau * (m1 + tau * m2));
+    }
+};
+
+class InversionTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(InversionTest);
+    CPPUNIT_TEST(testLineSearch);
+    CPPUNIT_TEST(testLineSearchArmijo);
+    CPPUNIT_TEST(testBroydenUpdate);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp(){
+        ab2_ = GIMLI::RVector(20);
+        for (GIMLI::Index i = 0; i < ab2_.size(); i ++) ab2_[i] = std::pow(10.0, 0.1 * i + 0.2);
+        mn2_ = ab2_ / 3.0;
+        trueModel_ = GIMLI::RVector(5);
+        trueModel_[0] = 5.0; trueModel_[1] = 15.0;
+        trueModel_[2] = 100.0; trueModel_[3] = 20.0; trueModel_[4] = 500.0;
+    }
+
+    void testLineSearch(){
+        CountingDC1dModelling fop(3, ab2_, mn2_);
+        GIMLI::RVector data(fop.response(trueModel_));
+        GIMLI::TransLog< GIMLI::RVector > tD, tM;
+        LineSearchInversion inv(data, fop, tD, tM);
+        inv.setRelativeError(0.03);
+        inv.setLambda(20.0);
+        GIMLI::RVector startModel(fop.createDefaultStartModel());
+        inv.setModel(startModel);
+        inv.setReferenceModel(startModel * 1.5);
+        inv.setMaxIter(0);
+        inv.run();
+
+        //** both terms are quadratic in tau for interpolation in the
+        //** transformed spaces, so the coefficients are exact
+        GIMLI::RVector modelNew(trueModel_ * 0.8);
+        GIMLI::RVector responseNew(fop.response(modelNew));
+        GIMLI::RVector dModel(tM.trans(modelNew) - tM.trans(inv.model()));
+        GIMLI::RVector dData(tD.trans(responseNew) - tD.trans(inv.response()));
+        for (GIMLI::Index i = 0; i < 5; i ++){
+            double tau = 0.25 * i;
+            double phi = inv.getPhi(tM.update(inv.model(), dModel * tau),
+                                    tD.update(inv.response(), dData * tau));
+            CPPUNIT_ASSERT(std::fabs(inv.phiFromCoefficients(dModel, dData, tau) - phi) < 1e-8 * phi);
+        }
+
+        double tau = inv.linesearch(modelNew, responseNew);
+        CPPUNIT_ASSERT(tau >= 0.03 && tau <= 1.0);
+    }
+
+    void testLineSearchArmijo(){
+        CountingDC1dModelling fop(3, ab2_, mn2_);
+        GIMLI::RVector data(fop.response(trueModel_));
+        GIMLI::TransLog< GIMLI::RVector > tD, tM;
+        GIMLI::RInversion inv(data, fop, tD, tM, false, false);
+        inv.setRelativeError(0.03);
+        inv.setLambda(20.0);
+        inv.setLineSearchArmijo(true);
+        inv.setMaxIter(0);
+        inv.run();
+
+        //** the Gauss-Newton step is accepted without another forward call
+        GIMLI::RVector dModel(inv.invSubStep(tD.trans(data) - tD.trans(inv.response())));
+        GIMLI::RVector response(fop.response(tM.update(inv.model(), dModel)));
+        GIMLI::Index nResponses = fop.nResponses;
+        CPPUNIT_ASSERT(inv.linesearchArmijo(dModel, response) == 1.0);
+        CPPUNIT_ASSERT(fop.nResponses == nResponses);
+
+        //** a far too long step is reduced, response follows the step length
+        dModel *= 30.0;
+        response = fop.response(tM.update(inv.model(), dModel));
+        nResponses = fop.nResponses;
+        double tau = inv.linesearchArmijo(dModel, response);
+        CPPUNIT_ASSERT(tau < 1.0);
+        CPPUNIT_ASSERT(fop.nResponses > nResponses);
+        GIMLI::RVector responseTau(fop.response(tM.update(inv.model(), dModel * tau)));
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(response - responseTau)) < 1e-12 * GIMLI::max(responseTau));
+    }
+
+    /*! Two-layer inversion from a close start model with recalculated,
+     * Broyden updated and periodically recalculated Jacobian. */
+    void runTwoLayer(CountingDC1dModelling & fop, bool broyden, GIMLI::Index interval,
+                     double & chi2){
+        GIMLI::RVector model(3), startModel(3);
+        model[0] = 10.0; model[1] = 100.0; model[2] = 20.0;
+        startModel[0] = 6.0; startModel[1] = 60.0; startModel[2] = 40.0;
+        GIMLI::RVector data(fop.response(model));
+        GIMLI::TransLog< GIMLI::RVector > tD, tM;
+        GIMLI::RInversion inv(data, fop, tD, tM, false, false);
+        inv.setRelativeError(0.03);
+        inv.setLambda(20.0);
+        inv.setMaxIter(15);
+        if (broyden) inv.setBroydenUpdate(true);
+        inv.setBroydenRecalcInterval(interval);
+        inv.setModel(startModel);
+        inv.run();
+        chi2 = inv.chi2();
+    }
+
+    void testBroydenUpdate(){
+        double chi2 = 0.0, chi2Broyden = 0.0, chi2Interval = 0.0;
+        CountingDC1dModelling fop(2, ab2_, mn2_);
+        runTwoLayer(fop, false, 0, chi2);
+        CPPUNIT_ASSERT(chi2 < 1.0);
+        CPPUNIT_ASSERT(fop.nJacobians > 2);
+
+        //** only the start Jacobian, the updates reach the target misfit too
+        CountingDC1dModelling fopBroyden(2, ab2_, mn2_);
+        runTwoLayer(fopBroyden, true, 0, chi2Broyden);
+        CPPUNIT_ASSERT(fopBroyden.nJacobians == 1);
+        CPPUNIT_ASSERT(fopBroyden.nJacobians < fop.nJacobians);
+        CPPUNIT_ASSERT(chi2Broyden < 1.0);
+
+        //** recalculation after two updates
+        CountingDC1dModelling fopInterval(2, ab2_, mn2_);
+        runTwoLayer(fopInterval, true, 2, chi2Interval);
+        CPPUNIT_ASSERT(fopInterval.nJacobians > fopBroyden.nJacobians);
+        CPPUNIT_ASSERT(fopInterval.nJacobians < fop.nJacobians);
+        CPPUNIT_ASSERT(chi2Interval < 1.0);
+    }
+
+private:
+    GIMLI::RVector ab2_;
+    GIMLI::RVector mn2_;
+    GIMLI::RVector trueModel_;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(InversionTest);
@@ -1,9 +1,18 @@
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <gimli.h>
+#include <cellBVH.h>
+#include <elementmatrix.h>
+#include <interpolate.h>
 #include <mesh.h>
 #include <meshgenerators.h>
+#include <meshView.h>
+#include <shape.h>
+#include <sparsematrix.h>
+#include <stopwatch.h>
 
+#include <fstream>
+#include <iterator>
 #include <stdexcept>
 
 using namespace GIMLI;
@@ -13,6 +22,13 @@ class MeshTest : public CppUnit::TestFixture{
     CPPUNIT_TEST(testSimple);
     CPPUNIT_TEST(testRefine2d);
     CPPUNIT_TEST(testRefine3d);
+    CPPUNIT_TEST(testFindCells);
+    CPPUNIT_TEST(testCellBVH);
+    CPPUNIT_TEST(testNeighbourInfos);
+    CPPUNIT_TEST(testMeshView);
+    CPPUNIT_TEST(testBinaryV2);
+    CPPUNIT_TEST(testBinaryV3);
+    CPPUNIT_TEST(testExportVTU);
         
     //CPPUNIT_TEST_EXCEPTION(funct, exception);
     CPPUNIT_TEST_SUITE_END();
@@ -132,6 +148,533 @@ public:
         CPPUNIT_ASSERT(q.nodeCount() == 27);
     }
     
+    void testFindCells(){
+        Mesh mesh(createMesh2D(20u, 10u));
+        Mesh tri(2);
+        for (Index i = 0; i < mesh.nodeCount(); i ++) tri.createNode(mesh.node(i).pos());
+        for (Index i = 0; i < mesh.cellCount(); i ++){
+            const Cell & c = mesh.cell(i);
+            tri.createTriangle(tri.node(c.node(0).id()), tri.node(c.node(1).id()),
+                               tri.node(c.node(2).id()));
+            tri.createTriangle(tri.node(c.node(0).id()), tri.node(c.node(2).id()),
+                               tri.node(c.node(3).id()));
+        }
+
+        R3Vector pos;
+        for (Index i = 0; i < 2000; i ++){
+            pos.push_back(RVector3(22.0 * ((i * 7919) % 2000) / 2000.0 - 1.03,
+                                   11.0 * ((i * 104729) % 2000) / 2000.0 - 0.51));
+        }
+
+        for (Index nThreads = 1; nThreads < 4; nThreads += 2){
+            std::vector < Cell * > cells(mesh.findCells(pos, nThreads));
+            CPPUNIT_ASSERT(cells.size() == pos.size());
+            for (Index i = 0; i < pos.size(); i ++){
+                bool inside = pos[i][0] > 0.0 && pos[i][0] < 20.0 &&
+                              pos[i][1] > 0.0 && pos[i][1] < 10.0;
+                CPPUNIT_ASSERT((cells[i] != NULL) == inside);
+                if (inside) CPPUNIT_ASSERT(cells[i]->shape().isInside(pos[i]));
+            }
+        }
+
+        std::vector < Cell * > cells(tri.findCells(pos));
+        for (Index i = 0; i < pos.size(); i ++){
+            bool inside = pos[i][0] > 0.0 && pos[i][0] < 20.0 &&
+                          pos[i][1] > 0.0 && pos[i][1] < 10.0;
+            CPPUNIT_ASSERT((cells[i] != NULL) == inside);
+            if (inside) CPPUNIT_ASSERT(cells[i]->shape().isInside(pos[i]));
+        }
+
+        RVector u(x(tri.positions()) + 2.0 * y(tri.positions()));
+        RSparseMapMatrix I(tri.interpolationMatrix(pos));
+        RVector ui(I * u);
+        for (Index i = 0; i < pos.size(); i ++){
+            if (cells[i]){
+                CPPUNIT_ASSERT(std::fabs(ui[i] - (pos[i][0] + 2.0 * pos[i][1])) < 1e-12);
+            }
+        }
+    }
+
+    void testCellBVH(){
+        Mesh mesh(createMesh3D(12u, 9u, 7u));
+
+        CellBVH tree;
+        tree.build(mesh, 3);
+        CPPUNIT_ASSERT(tree.size() == mesh.cellCount());
+        CPPUNIT_ASSERT(tree.nodeCount() == 2 * ((mesh.cellCount() + 3) / 4) - 1);
+
+        for (Index i = 0; i < 1000; i ++){
+            RVector3 p(14.0 * ((i * 7919) % 1000) / 1000.0 - 1.03,
+                       11.0 * ((i * 104729) % 1000) / 1000.0 - 1.01,
+                        9.0 * ((i * 1299709) % 1000) / 1000.0 - 1.07);
+            bool inside = p[0] > 0.0 && p[0] < 12.0 &&
+                          p[1] > 0.0 && p[1] < 9.0 &&
+                          p[2] > 0.0 && p[2] < 7.0;
+
+            Cell * c = tree.find(p);
+            CPPUNIT_ASSERT((c != NULL) == inside);
+            if (inside) {
+                CPPUNIT_ASSERT(c->shape().isInside(p));
+                CPPUNIT_ASSERT(c == mesh.findCell(p, false));
+                std::vector < Cell * > cand(tree.candidates(p));
+                CPPUNIT_ASSERT(std::find(cand.begin(), cand.end(), c) != cand.end());
+            }
+        }
+
+        //** nodes are shared by up to eight cells
+        CPPUNIT_ASSERT(mesh.findCell(mesh.node(100).pos(), false) != NULL);
+
+        //** moving the mesh invalidates the cached tree
+        RVector3 p(0.5, 0.5, 0.5);
+        Cell * c = mesh.findCell(p, false);
+        mesh.translate(RVector3(1.0, 0.0, 0.0));
+        CPPUNIT_ASSERT(mesh.findCell(p, false) == NULL);
+        CPPUNIT_ASSERT(mesh.findCell(p + RVector3(1.0, 0.0, 0.0), false) == c);
+    }
+
+    void compareNeighbourInfos(Mesh & mesh, Index nBounds){
+        Stopwatch swatch(true);
+        mesh.createNeighbourInfos(true);
+        double tHash = swatch.duration(true);
+        CPPUNIT_ASSERT(mesh.boundaryCount() == nBounds);
+
+        std::vector < Cell * > neighbours;
+        for (Index i = 0; i < mesh.cellCount(); i ++){
+            Cell & c = mesh.cell(i);
+            for (Index j = 0; j < c.boundaryCount(); j ++){
+                neighbours.push_back(c.neighbourCell(j));
+            }
+        }
+
+        //** reference: intersect the boundary and cell sets of the nodes
+        swatch.restart();
+        std::vector < Boundary * > bounds;
+        for (Index i = 0; i < mesh.cellCount(); i ++){
+            Cell & c = mesh.cell(i);
+            c.cleanNeighbourInfos();
+            for (Index j = 0; j < c.boundaryCount(); j ++){
+                c.findNeighbourCell(j);
+                bounds.push_back(findBoundary(c.boundaryNodes(j)));
+            }
+        }
+        double tSet = swatch.duration(true);
+
+        if (getEnvironment("GIMLI_UNITTEST_BENCHMARK", false)){
+            std::cout << std::endl << "neighbour infos (" << mesh.dim() << "D, "
+                      << mesh.cellCount() << " cells): hash: " << tHash
+                      << "s set intersection: " << tSet << "s" << std::endl;
+        }
+
+        Index k = 0;
+        for (Index i = 0; i < mesh.cellCount(); i ++){
+            Cell & c = mesh.cell(i);
+            for (Index j = 0; j < c.boundaryCount(); j ++, k ++){
+                CPPUNIT_ASSERT(c.neighbourCell(j) == neighbours[k]);
+                CPPUNIT_ASSERT(bounds[k] != NULL);
+                CPPUNIT_ASSERT(bounds[k]->leftCell() == &c ||
+                               bounds[k]->rightCell() == &c);
+                if (neighbours[k]){
+                    CPPUNIT_ASSERT(bounds[k]->leftCell() == neighbours[k] ||
+                                   bounds[k]->rightCell() == neighbours[k]);
+                }
+            }
+        }
+        for (Index i = 0; i < mesh.boundaryCount(); i ++){
+            Boundary & b = mesh.boundary(i);
+            CPPUNIT_ASSERT(b.leftCell() != NULL);
+            if (b.rightCell() && b.nodeCount() > 2){
+                CPPUNIT_ASSERT(b.normShowsOutside(*b.leftCell()));
+            }
+        }
+    }
+
+    void testNeighbourInfos(){
+        Index nx = 60, ny = 40;
+        Mesh quads(createMesh2D(nx, ny));
+        Mesh tri(2);
+        for (Index i = 0; i < quads.nodeCount(); i ++) tri.createNode(quads.node(i).pos());
+        for (Index i = 0; i < quads.cellCount(); i ++){
+            const Cell & c = quads.cell(i);
+            tri.createTriangle(tri.node(c.node(0).id()), tri.node(c.node(1).id()),
+                               tri.node(c.node(2).id()));
+            tri.createTriangle(tri.node(c.node(0).id()), tri.node(c.node(2).id()),
+                               tri.node(c.node(3).id()));
+        }
+        compareNeighbourInfos(tri, (nx + 1) * ny + nx * (ny + 1) + nx * ny);
+
+        Index nz = 20; ny = 30; nx = 30;
+        Mesh hex(createMesh3D(nx, ny, nz));
+        compareNeighbourInfos(hex, (nx + 1) * ny * nz + nx * (ny + 1) * nz +
+                                   nx * ny * (nz + 1));
+    }
+
+    void compareMeshView(const Mesh & mesh, bool simplex){
+        const MeshView & view = mesh.view();
+        CPPUNIT_ASSERT(&view == &mesh.view());
+        CPPUNIT_ASSERT(view.nodeCount() == mesh.nodeCount());
+        CPPUNIT_ASSERT(view.cellCount() == mesh.cellCount());
+        CPPUNIT_ASSERT(view.boundaryCount() == mesh.boundaryCount());
+
+        for (Index i = 0; i < mesh.nodeCount(); i ++){
+            CPPUNIT_ASSERT(RVector3(view.nodePos(i)[0], view.nodePos(i)[1],
+                                    view.nodePos(i)[2]) == mesh.node(i).pos());
+            std::set < Index > cells;
+            for (Index j = 0; j < view.nodeCellCount(i); j ++){
+                cells.insert(view.nodeCells(i)[j]);
+            }
+            CPPUNIT_ASSERT(cells.size() == mesh.node(i).cellSet().size());
+            for (std::set < Cell * >::iterator it = mesh.node(i).cellSet().begin();
+                 it != mesh.node(i).cellSet().end(); it ++){
+                CPPUNIT_ASSERT(cells.count((*it)->id()) == 1);
+            }
+        }
+
+        ElementMatrix < double > Sx, Su;
+        std::vector < double > S(64), M(64);
+        for (Index c = 0; c < mesh.cellCount(); c ++){
+            const Cell & cell = mesh.cell(c);
+            Index n = cell.nodeCount();
+            CPPUNIT_ASSERT(view.cellNodeCount(c) == n);
+            for (Index i = 0; i < n; i ++){
+                CPPUNIT_ASSERT(view.cellNodes(c)[i] == cell.node(i).id());
+            }
+            CPPUNIT_ASSERT(view.cellRtti(c) == cell.rtti());
+            CPPUNIT_ASSERT(std::fabs(view.cellSize(c) - cell.size()) < 1e-12 * cell.size());
+            CPPUNIT_ASSERT(view.hasGradients(c) == simplex);
+            CPPUNIT_ASSERT(view.stiffness(c, &S[0]) == simplex);
+            CPPUNIT_ASSERT(view.mass(c, &M[0]) == simplex);
+            if (!simplex) continue;
+
+            Sx.ux2uy2uz2(cell);
+            Su.u2(cell);
+            for (Index i = 0; i < n; i ++){
+                for (Index j = 0; j < n; j ++){
+                    CPPUNIT_ASSERT(std::fabs(S[i * n + j] - Sx.getVal(i, j)) < 1e-10);
+                    CPPUNIT_ASSERT(std::fabs(M[i * n + j] - Su.getVal(i, j)) < 1e-12);
+                }
+            }
+        }
+
+        for (Index b = 0; b < mesh.boundaryCount(); b ++){
+            Boundary & bound = mesh.boundary(b);
+            CPPUNIT_ASSERT(view.boundaryNodeCount(b) == bound.nodeCount());
+            for (Index i = 0; i < bound.nodeCount(); i ++){
+                CPPUNIT_ASSERT(view.boundaryNodes(b)[i] == bound.node(i).id());
+            }
+            CPPUNIT_ASSERT(view.leftCell(b) ==
+                           (bound.leftCell() ? SIndex(bound.leftCell()->id()) : -1));
+            CPPUNIT_ASSERT(view.rightCell(b) ==
+                           (bound.rightCell() ? SIndex(bound.rightCell()->id()) : -1));
+        }
+
+        //** cell ids are constant on each node, the average too
+        RVector pd(cellDataToPointData(mesh, RVector(mesh.cellCount(), 2.0)));
+        CPPUNIT_ASSERT(std::fabs(min(pd) - 2.0) < 1e-12 && std::fabs(max(pd) - 2.0) < 1e-12);
+    }
+
+    void testMeshView(){
+        Mesh quads(createMesh2D(7u, 5u));
+        Mesh tri(2);
+        for (Index i = 0; i < quads.nodeCount(); i ++){
+            const RVector3 & p = quads.node(i).pos();
+            tri.createNode(RVector3(p[0] + 0.3 * p[1] * p[1], p[1] * (1.0 + 0.2 * p[0])));
+        }
+        for (Index i = 0; i < quads.cellCount(); i ++){
+            const Cell & c = quads.cell(i);
+            tri.createTriangle(tri.node(c.node(0).id()), tri.node(c.node(1).id()),
+                               tri.node(c.node(2).id()));
+            tri.createTriangle(tri.node(c.node(0).id()), tri.node(c.node(2).id()),
+                               tri.node(c.node(3).id()));
+        }
+        tri.createNeighbourInfos();
+        compareMeshView(tri, true);
+
+        Mesh tet(3);
+        tet.createNode(RVector3(0.0, 0.0, 0.0));
+        tet.createNode(RVector3(1.0, 0.1, 0.0));
+        tet.createNode(RVector3(0.2, 1.3, 0.1));
+        tet.createNode(RVector3(0.1, 0.2, 0.9));
+        tet.createNode(RVector3(1.1, 1.2, 1.4));
+        tet.createTetrahedron(tet.node(0), tet.node(1), tet.node(2), tet.node(3));
+        tet.createTetrahedron(tet.node(1), tet.node(2), tet.node(3), tet.node(4));
+        tet.createNeighbourInfos();
+        compareMeshView(tet, true);
+
+        Mesh hex(createMesh3D(3u, 2u, 2u));
+        compareMeshView(hex, false);
+
+        //** cells of lower dimension than the mesh keep the shape path
+        Mesh mixed(2);
+        mixed.createNode(RVector3(0.0, 0.0));
+        mixed.createNode(RVector3(1.0, 0.0));
+        mixed.createNode(RVector3(0.0, 1.0));
+        mixed.createNode(RVector3(3.0, 4.0));
+        mixed.createTriangle(mixed.node(0), mixed.node(1), mixed.node(2));
+        std::vector < Node * > edge;
+        edge.push_back(&mixed.node(1)); edge.push_back(&mixed.node(3));
+        mixed.createCell(edge);
+        CPPUNIT_ASSERT(mixed.cell(1).rtti() == MESH_EDGE_CELL_RTTI);
+        CPPUNIT_ASSERT(mixed.view().hasGradients(0));
+        CPPUNIT_ASSERT(!mixed.view().hasGradients(1));
+        CPPUNIT_ASSERT(std::fabs(mixed.view().cellSize(1) - mixed.cell(1).size()) < 1e-12);
+
+        //** the view follows changes of the mesh
+        Index nBounds = tri.boundaryCount();
+        tri.translate(RVector3(1.0, 2.0));
+        CPPUNIT_ASSERT(tri.view().nodePos(0)[0] == tri.node(0).pos()[0]);
+        tri.createNode(RVector3(100.0, 100.0));
+        CPPUNIT_ASSERT(tri.view().nodeCount() == tri.nodeCount());
+        tri.createNeighbourInfos(true);
+        CPPUNIT_ASSERT(tri.boundaryCount() == nBounds);
+        CPPUNIT_ASSERT(tri.view().leftCell(0) >= 0);
+    }
+
+    void testBinaryV2(){
+        Mesh quads(createMesh2D(9u, 6u));
+        Mesh mesh(2);
+        for (Index i = 0; i < quads.nodeCount(); i ++){
+            mesh.createNode(quads.node(i).pos(), i % 3);
+        }
+        for (Index i = 0; i < quads.cellCount(); i ++){
+            const Cell & c = quads.cell(i);
+            mesh.createTriangle(mesh.node(c.node(0).id()), mesh.node(c.node(1).id()),
+                                mesh.node(c.node(2).id()), i % 5);
+            mesh.createTriangle(mesh.node(c.node(0).id()), mesh.node(c.node(2).id()),
+                                mesh.node(c.node(3).id()), i % 4);
+        }
+        mesh.createNeighbourInfos();
+        for (Index i = 0; i < mesh.boundaryCount(); i ++) mesh.boundary(i).setMarker(-int(i % 3));
+        mesh.addData("cellData", RVector(mesh.cellCount(), 3.14));
+        mesh.saveBinaryV2("testV2.bms");
+
+        Mesh tmp;
+        tmp.loadBinaryV2("testV2.bms");
+        CPPUNIT_ASSERT(tmp.dim() == 2);
+        CPPUNIT_ASSERT(tmp.nodeCount() == mesh.nodeCount());
+        CPPUNIT_ASSERT(tmp.cellCount() == mesh.cellCount());
+        CPPUNIT_ASSERT(tmp.boundaryCount() == mesh.boundaryCount());
+        //** the stored left and right cells are complete
+        CPPUNIT_ASSERT(tmp.neighboursKnown());
+
+        for (Index i = 0; i < mesh.nodeCount(); i ++){
+            CPPUNIT_ASSERT(tmp.node(i).pos() == mesh.node(i).pos());
+            CPPUNIT_ASSERT(tmp.node(i).marker() == mesh.node(i).marker());
+        }
+        for (Index i = 0; i < mesh.cellCount(); i ++){
+            CPPUNIT_ASSERT(tmp.cell(i).ids() == mesh.cell(i).ids());
+            CPPUNIT_ASSERT(tmp.cell(i).marker() == mesh.cell(i).marker());
+            for (Index j = 0; j < mesh.cell(i).boundaryCount(); j ++){
+                Cell * n0 = mesh.cell(i).neighbourCell(j);
+                Cell * n1 = tmp.cell(i).neighbourCell(j);
+                CPPUNIT_ASSERT((n0 == NULL) == (n1 == NULL));
+                if (n0) CPPUNIT_ASSERT(n0->id() == n1->id());
+            }
+        }
+        for (Index i = 0; i < mesh.boundaryCount(); i ++){
+            Boundary & b0 = mesh.boundary(i);
+            Boundary & b1 = tmp.boundary(i);
+            CPPUNIT_ASSERT(b1.ids() == b0.ids());
+            CPPUNIT_ASSERT(b1.marker() == b0.marker());
+            CPPUNIT_ASSERT(b1.leftCell()->id() == b0.leftCell()->id());
+            CPPUNIT_ASSERT((b1.rightCell() == NULL) == (b0.rightCell() == NULL));
+            if (b0.rightCell()) CPPUNIT_ASSERT(b1.rightCell()->id() == b0.rightCell()->id());
+        }
+        CPPUNIT_ASSERT(tmp.exportData("cellData") == mesh.exportData("cellData"));
+
+        //** without boundaries the neighbour infos have to be created
+        Mesh cells(2);
+        for (Index i = 0; i < mesh.nodeCount(); i ++) cells.createNode(mesh.node(i).pos());
+        for (Index i = 0; i < mesh.cellCount(); i ++) cells.createCell(mesh.cell(i).ids());
+        cells.saveBinaryV2("testV2.bms");
+        tmp.loadBinaryV2("testV2.bms");
+        CPPUNIT_ASSERT(tmp.cellCount() == mesh.cellCount());
+        CPPUNIT_ASSERT(tmp.boundaryCount() == 0);
+        CPPUNIT_ASSERT(!tmp.neighboursKnown());
+
+        //** truncated files are refused
+        mesh.saveBinaryV2("testV2.bms");
+        std::ifstream in("testV2.bms", std::ios::binary);
+        std::string buf((std::istreambuf_iterator< char >(in)), std::istreambuf_iterator< char >());
+        std::ofstream out("testV2t.bms", std::ios::binary);
+        out.write(buf.c_str(), buf.size() / 2);
+        out.close();
+        CPPUNIT_ASSERT_THROW(tmp.loadBinaryV2("testV2t.bms"), std::exception);
+    }
+
+    void testBinaryV3(){
+        Mesh quads(createMesh2D(9u, 6u));
+        Mesh mesh(2);
+        for (Index i = 0; i < quads.nodeCount(); i ++){
+            const RVector3 & p = quads.node(i).pos();
+            mesh.createNode(RVector3(0.1 * p[0] - 1.0 / 3.0, 0.3 * p[1] + 1e4, 0.0), i % 3);
+        }
+        for (Index i = 0; i < quads.cellCount(); i ++){
+            const Cell & c = quads.cell(i);
+            mesh.createTriangle(mesh.node(c.node(0).id()), mesh.node(c.node(1).id()),
+                                mesh.node(c.node(2).id()), i / 7);
+            mesh.createTriangle(mesh.node(c.node(0).id()), mesh.node(c.node(2).id()),
+                                mesh.node(c.node(3).id()), i / 7);
+        }
+        mesh.createNeighbourInfos();
+        for (Index i = 0; i < mesh.boundaryCount(); i ++) mesh.boundary(i).setMarker(-int(i % 3));
+        mesh.addData("cellData", RVector(mesh.cellCount(), 3.14));
+
+        //** small chunks so every section has several of them
+        mesh.saveBinaryV3("testV3.bms", 0.0, 7, 3);
+
+        Mesh tmp;
+        tmp.loadBinaryV3("testV3.bms", 3);
+        CPPUNIT_ASSERT(tmp.dim() == 2);
+        CPPUNIT_ASSERT(tmp.nodeCount() == mesh.nodeCount());
+        CPPUNIT_ASSERT(tmp.cellCount() == mesh.cellCount());
+        CPPUNIT_ASSERT(tmp.boundaryCount() == mesh.boundaryCount());
+        CPPUNIT_ASSERT(tmp.neighboursKnown());
+
+        for (Index i = 0; i < mesh.nodeCount(); i ++){
+            CPPUNIT_ASSERT(tmp.node(i).pos() == mesh.node(i).pos());
+            CPPUNIT_ASSERT(tmp.node(i).marker() == mesh.node(i).marker());
+        }
+        for (Index i = 0; i < mesh.cellCount(); i ++){
+            CPPUNIT_ASSERT(tmp.cell(i).ids() == mesh.cell(i).ids());
+            CPPUNIT_ASSERT(tmp.cell(i).marker() == mesh.cell(i).marker());
+        }
+        for (Index i = 0; i < mesh.boundaryCount(); i ++){
+            Boundary & b0 = mesh.boundary(i);
+            Boundary & b1 = tmp.boundary(i);
+            CPPUNIT_ASSERT(b1.ids() == b0.ids());
+            CPPUNIT_ASSERT(b1.marker() == b0.marker());
+            CPPUNIT_ASSERT(b1.leftCell()->id() == b0.leftCell()->id());
+            CPPUNIT_ASSERT((b1.rightCell() == NULL) == (b0.rightCell() == NULL));
+            if (b0.rightCell()) CPPUNIT_ASSERT(b1.rightCell()->id() == b0.rightCell()->id());
+        }
+        CPPUNIT_ASSERT(tmp.exportData("cellData") == mesh.exportData("cellData"));
+
+        //** the version is detected by the generic loader
+        Mesh loaded;
+        loaded.load("testV3.bms", false);
+        CPPUNIT_ASSERT(loaded.cellCount() == mesh.cellCount());
+        CPPUNIT_ASSERT(loaded.cellMarkers() == mesh.cellMarkers());
+
+        //** partial reads
+        CPPUNIT_ASSERT(loadCellMarkersBinaryV3("testV3.bms") == mesh.cellMarkers());
+
+        Mesh part;
+        part.loadBinaryV3Cells("testV3.bms", 10, 30, 2);
+        CPPUNIT_ASSERT(part.cellCount() == 20);
+        CPPUNIT_ASSERT(part.boundaryCount() == 0);
+        for (Index i = 0; i < part.cellCount(); i ++){
+            const Cell & c0 = mesh.cell(i + 10);
+            const Cell & c1 = part.cell(i);
+            CPPUNIT_ASSERT(c1.marker() == c0.marker());
+            CPPUNIT_ASSERT(c1.nodeCount() == c0.nodeCount());
+            for (Index j = 0; j < c0.nodeCount(); j ++){
+                CPPUNIT_ASSERT(c1.node(j).pos() == c0.node(j).pos());
+                CPPUNIT_ASSERT(c1.node(j).marker() == c0.node(j).marker());
+            }
+        }
+        CPPUNIT_ASSERT_THROW(part.loadBinaryV3Cells("testV3.bms", 10, mesh.cellCount() + 1),
+                             std::exception);
+
+        //** quantized coordinates differ at most half a quantum
+        mesh.saveBinaryV3("testV3.bms", 1e-6);
+        tmp.loadBinaryV3("testV3.bms");
+        CPPUNIT_ASSERT(tmp.nodeCount() == mesh.nodeCount());
+        for (Index i = 0; i < mesh.nodeCount(); i ++){
+            CPPUNIT_ASSERT(tmp.node(i).pos().distance(mesh.node(i).pos()) < 1e-6);
+        }
+
+        //** truncated files are refused
+        mesh.saveBinaryV3("testV3.bms");
+        std::ifstream in("testV3.bms", std::ios::binary);
+        std::string buf((std::istreambuf_iterator< char >(in)), std::istreambuf_iterator< char >());
+        std::ofstream out("testV3t.bms", std::ios::binary);
+        out.write(buf.c_str(), buf.size() / 2);
+        out.close();
+        CPPUNIT_ASSERT_THROW(tmp.loadBinaryV3("testV3t.bms"), std::exception);
+
+        //** a chunk size near 2^64 would wrap the chunk count to zero
+        std::string huge(buf);
+        std::memset(&huge[28], 0xff, sizeof(uint64));
+        out.open("testV3t.bms", std::ios::binary);
+        out.write(huge.c_str(), huge.size());
+        out.close();
+        CPPUNIT_ASSERT_THROW(tmp.loadBinaryV3("testV3t.bms"), std::exception);
+    }
+
+    //** return the raw block at offset of the appended data in a vtu file
+    std::string vtuBlock(const std::string & vtu, Index offset){
+        Index start = vtu.find("<AppendedData encoding=\"raw\">");
+        start = vtu.find('_', start) + 1 + offset;
+        uint64 size; std::memcpy(&size, &vtu[start], sizeof(uint64));
+        return vtu.substr(start + sizeof(uint64), size);
+    }
+
+    std::string readFile(const std::string & fileName){
+        std::ifstream in(fileName.c_str(), std::ios::binary);
+        return std::string((std::istreambuf_iterator< char >(in)), std::istreambuf_iterator< char >());
+    }
+
+    void testExportVTU(){
+        Mesh mesh(createMesh2D(5u, 4u));
+        mesh.addData("nodeData", RVector(mesh.nodeCount(), 2.0));
+        RVector cellData(mesh.cellCount());
+        for (Index i = 0; i < cellData.size(); i ++) cellData[i] = i * 0.5;
+        mesh.addData("cellData", cellData);
+
+        mesh.exportVTU("testVTU", true);
+        std::string vtu(readFile("testVTU.vtu"));
+        CPPUNIT_ASSERT(vtu.find("format=\"appended\"") != std::string::npos);
+        CPPUNIT_ASSERT(vtu.find("format=\"ascii\"") == std::string::npos);
+
+        //** the points are the first block
+        std::string points(vtuBlock(vtu, 0));
+        CPPUNIT_ASSERT(points.size() == 3 * sizeof(double) * mesh.nodeCount());
+        for (Index i = 0; i < mesh.nodeCount(); i ++){
+            double p[3]; std::memcpy(p, &points[3 * sizeof(double) * i], sizeof(p));
+            CPPUNIT_ASSERT(RVector3(p[0], p[1], p[2]) == mesh.node(i).pos());
+        }
+
+        Index pos = vtu.find("Name=\"cellData\"");
+        CPPUNIT_ASSERT(pos != std::string::npos);
+        pos = vtu.find("offset=\"", pos) + 8;
+        std::string block(vtuBlock(vtu, toInt(vtu.substr(pos, vtu.find('"', pos) - pos))));
+        CPPUNIT_ASSERT(block.size() == sizeof(double) * mesh.cellCount());
+        CPPUNIT_ASSERT(std::memcmp(&block[0], &cellData[0], block.size()) == 0);
+
+        //** the pieces hold all cells
+        mesh.exportPVTU("testPVTU", 3, 2);
+        std::string pvtu(readFile("testPVTU.pvtu"));
+        CPPUNIT_ASSERT(pvtu.find("<PDataArray type=\"Float64\" Name=\"nodeData\"/>") != std::string::npos);
+        Index nCells = 0;
+        for (Index i = 0; i < 3; i ++){
+            CPPUNIT_ASSERT(pvtu.find("Source=\"testPVTU_" + str(i) + ".vtu\"") != std::string::npos);
+            std::string piece(readFile("testPVTU_" + str(i) + ".vtu"));
+            pos = piece.find("NumberOfCells=\"") + 15;
+            nCells += toInt(piece.substr(pos, piece.find('"', pos) - pos));
+        }
+        CPPUNIT_ASSERT(nCells == mesh.cellCount());
+
+        //** quadratic prisms and pyramids are written as such
+        Mesh quad(3);
+        IndexArray prism(15), pyramid(13);
+        for (Index i = 0; i < 15; i ++){
+            quad.createNode(RVector3(i % 3, i / 3, 0.1 * i));
+            prism[i] = i;
+        }
+        for (Index i = 0; i < 13; i ++) pyramid[i] = i;
+        quad.createCell(prism);
+        quad.createCell(pyramid);
+        CPPUNIT_ASSERT(quad.cell(0).rtti() == MESH_TRIPRISM15_RTTI);
+        CPPUNIT_ASSERT(quad.cell(1).rtti() == MESH_PYRAMID13_RTTI);
+        quad.exportVTU("testVTU", true);
+        vtu = readFile("testVTU.vtu");
+        pos = vtu.find("Name=\"types\"");
+        CPPUNIT_ASSERT(pos != std::string::npos);
+        pos = vtu.find("offset=\"", pos) + 8;
+        block = vtuBlock(vtu, toInt(vtu.substr(pos, vtu.find('"', pos) - pos)));
+        CPPUNIT_ASSERT(block.size() == 2 && block[0] == 26 && block[1] == 27);
+    }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(MeshTest);
\ No newline at end of file
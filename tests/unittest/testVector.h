@@ -30,6 +30,7 @@ class VectorTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST(testMatrix);
     CPPUNIT_TEST(testBlockMatrix);
     CPPUNIT_TEST(testSparseMapMatrix);
+    CPPUNIT_TEST(testSparseMapMatrixMult);
     CPPUNIT_TEST(testFind);
     CPPUNIT_TEST(testIO);
 
@@ -379,6 +380,44 @@ public:
         A[1].fill(2);
         CPPUNIT_ASSERT(sum(A.row(1)) == A.cols()*2);
         CPPUNIT_ASSERT(sum(A.col(1)) == A.rows()*2);
+
+        // resize keeps the overlapping block, clean keeps the size
+        A.resize(5, 6);
+        CPPUNIT_ASSERT(A[1][2] == 2.0);
+        CPPUNIT_ASSERT(A[4][5] == 0.0);
+        A.clean();
+        CPPUNIT_ASSERT(A.rows() == 5 && A.cols() == 6);
+        CPPUNIT_ASSERT(sum(A[1]) == 0.0);
+
+        // dense products vs. row wise products
+        Mat D(4, 3), E(4, 2);
+        for (Index i = 0; i < D.rows(); i ++){
+            D[i].fill(x__ + ValueType(i));
+            E[i].fill(x__ * ValueType(i) + 1.0);
+        }
+        Vec x(D.cols()); x.fill(x__ + 1.0);
+        Vec y(D.rows()); y.fill(x__ - 1.0);
+        Vec Dx(D.rows()), DTy(D.cols());
+        for (Index i = 0; i < D.rows(); i ++){
+            Dx[i] = sum(D[i] * x);
+            DTy += D[i] * y[i];
+        }
+        CPPUNIT_ASSERT(D.mult(x) == Dx);
+        CPPUNIT_ASSERT(D.transMult(y) == DTy);
+
+        Mat DTE(D.transMult(E));
+        CPPUNIT_ASSERT(DTE.rows() == 3 && DTE.cols() == 2);
+        for (Index j = 0; j < E.cols(); j ++){
+            CPPUNIT_ASSERT(DTE.col(j) == D.transMult(E.col(j)));
+        }
+        Mat DDTE(D.mult(DTE));
+        CPPUNIT_ASSERT(DDTE.rows() == 4 && DDTE.cols() == 2);
+        CPPUNIT_ASSERT(DDTE.col(1) == D.mult(DTE.col(1)));
+        try{ D.mult(E); CPPUNIT_ASSERT(0); } catch(...){}
+
+        // a row with its own memory falls back to row wise products
+        D[2].resize(2); D[2].resize(3); D[2].fill(1.0);
+        CPPUNIT_ASSERT(D.mult(x)[2] == sum(x));
     }
 
     void testFind(){
@@ -478,6 +517,49 @@ public:
         CPPUNIT_ASSERT(((C+C)*2.0).getVal(1, 1) == 8.0);
     }
 
+    void testSparseMapMatrixMult(){
+        GIMLI::RSparseMapMatrix A(3, 4);
+        A.addVal(0, 0, 1.0); A.addVal(0, 2, 3.0);
+        A.addVal(2, 1, 2.0); A.addVal(2, 3, 4.0);
+        GIMLI::RVector x(4); x.fill(x__ + 1.0);
+        GIMLI::RVector y(3); y.fill(x__ + 1.0);
+        CPPUNIT_ASSERT(A.mult(x) == GIMLI::RVector(std::vector< double >{10.0, 0.0, 20.0}));
+        CPPUNIT_ASSERT(A.transMult(y) == GIMLI::RVector(std::vector< double >{1.0, 6.0, 3.0, 12.0}));
+
+        //** the cached mirror follows changes
+        A.addVal(1, 3, -1.0);
+        A[0][0] = 2.0;
+        GIMLI::RVector ret(1, 5.0);
+        A.mult(x, ret);
+        CPPUNIT_ASSERT(ret == GIMLI::RVector(std::vector< double >{11.0, -4.0, 20.0}));
+        A.transMult(y, ret);
+        CPPUNIT_ASSERT(ret == GIMLI::RVector(std::vector< double >{2.0, 6.0, 3.0, 10.0}));
+        for (GIMLI::RSparseMapMatrix::iterator it = A.begin(); it != A.end(); it ++){
+            it->second *= 2.0;
+        }
+        CPPUNIT_ASSERT(A.mult(x) == GIMLI::RVector(std::vector< double >{22.0, -8.0, 40.0}));
+        A.resize(3, 3);
+        CPPUNIT_ASSERT(A.mult(GIMLI::RVector(3, 1.0)) == GIMLI::RVector(std::vector< double >{10.0, 0.0, 4.0}));
+
+        //** reads keep the mirror, writes through a kept element drop it
+        const GIMLI::RSparseMapMatrix & cA = A;
+        CPPUNIT_ASSERT(cA[2][1] == 4.0 && cA[1][1] == 0.0 && A.getVal(2, 1) == 4.0);
+        GIMLI::RSparseMapMatrix::MatElement e(A[1][1]);
+        CPPUNIT_ASSERT(A.mult(GIMLI::RVector(3, 1.0))[1] == 0.0);
+        e = 3.0;
+        CPPUNIT_ASSERT(A.mult(GIMLI::RVector(3, 1.0))[1] == 3.0);
+        try{ cA[3][0]; CPPUNIT_ASSERT(0); } catch(...){}
+
+        //** symmetric storage, one triangle stored
+        GIMLI::RSparseMapMatrix S(3, 3, 1);
+        S.addVal(0, 0, 2.0); S.addVal(1, 0, -1.0);
+        S.addVal(2, 1, 3.0); S.addVal(2, 2, 1.0);
+        GIMLI::RVector z(3); z.fill(x__ + 1.0);
+        GIMLI::RVector Sz(std::vector< double >{0.0, 8.0, 9.0});
+        CPPUNIT_ASSERT(S.mult(z) == Sz);
+        CPPUNIT_ASSERT(S.transMult(z) == Sz);
+    }
+
     void testIO(){
         RVector v(100);
         randn(v);
@@ -16,6 +16,8 @@
     #include "testShape.h"
     #include "testGeometry.h"
     #include "testFEM.h"
+    #include "testDCFEM.h"
+    #include "testInversion.h"
     #include "testExternals.h"
 
 #endif // HAVE_UNITTEST